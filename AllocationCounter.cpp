@@ -0,0 +1,75 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationcounter.cpp
+// ============
+// count the heap allocations made through operator new
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// declaration of the global variables and defines
+namespace
+{
+    // heap allocations made through operator new by any thread
+    std::atomic<uint64_t> g_AllocationCount(0);
+}
+
+/***********************************************************
+ *  GetAllocationCount()
+ *
+ *  This function returns the number of heap allocations made
+ *  since the program started.
+ ***********************************************************/
+uint64_t GetAllocationCount()
+{
+    return(g_AllocationCount.load(std::memory_order_relaxed));
+}
+
+/***********************************************************
+ *  operator new()
+ *
+ *  The allocation functions of the program are replaced to
+ *  count every heap allocation.  The memory comes from
+ *  malloc() and goes back with free().
+ ***********************************************************/
+void* operator new(std::size_t size)
+{
+    g_AllocationCount.fetch_add(1, std::memory_order_relaxed);
+
+    void* pMemory = malloc((size > 0) ? size : 1);
+    if (NULL == pMemory)
+    {
+        throw std::bad_alloc();
+    }
+
+    return(pMemory);
+}
+
+void* operator new[](std::size_t size)
+{
+    return(operator new(size));
+}
+
+void operator delete(void* pMemory) noexcept
+{
+    free(pMemory);
+}
+
+void operator delete[](void* pMemory) noexcept
+{
+    free(pMemory);
+}
+
+void operator delete(void* pMemory, std::size_t) noexcept
+{
+    free(pMemory);
+}
+
+void operator delete[](void* pMemory, std::size_t) noexcept
+{
+    free(pMemory);
+}
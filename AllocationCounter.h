@@ -0,0 +1,21 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationcounter.h
+// ============
+// count the heap allocations made through operator new
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+
+/***********************************************************
+ *  GetAllocationCount()
+ *
+ *  This function returns the number of heap allocations made
+ *  through operator new, on any thread, since the program
+ *  started.  The difference of two counts is the number of
+ *  allocations made in between, so a frame that allocates
+ *  nothing leaves the count where it was.
+ ***********************************************************/
+uint64_t GetAllocationCount();
@@ -0,0 +1,310 @@
+///////////////////////////////////////////////////////////////////////////////
+// assetpack.cpp
+// ============
+// read only mapping of a baked pack of scene textures and meshes
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AssetPack.h"
+
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+    // modulus of the Adler-32 sums
+    const uint32_t ADLER_MODULUS = 65521;
+    // most bytes that can be summed before the sums overflow
+    const size_t ADLER_BLOCK = 5552;
+}
+
+/***********************************************************
+ *  AssetPack()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+AssetPack::AssetPack()
+{
+    m_data = NULL;
+    m_size = 0;
+    m_header = NULL;
+    m_entries = NULL;
+}
+
+/***********************************************************
+ *  ~AssetPack()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+AssetPack::~AssetPack()
+{
+    Close();
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for mapping a pack file into memory
+ *  for reading.  Returns false when the file is missing or
+ *  does not pass the checks, and no pack is open then.
+ ***********************************************************/
+bool AssetPack::Open(const char* filename)
+{
+    Close();
+
+    if (m_file.Open(filename) == false)
+    {
+        return(false);
+    }
+
+    m_data = m_file.GetData();
+    m_size = m_file.GetSize();
+    if (Validate(filename) == false)
+    {
+        Close();
+        return(false);
+    }
+
+    return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for unmapping the pack file.  The
+ *  data of the entries must no longer be used.
+ ***********************************************************/
+void AssetPack::Close()
+{
+    m_file.Close();
+    m_data = NULL;
+    m_size = 0;
+    m_header = NULL;
+    m_entries = NULL;
+}
+
+/***********************************************************
+ *  IsOpen()
+ *
+ *  This method returns true while a pack is mapped.
+ ***********************************************************/
+bool AssetPack::IsOpen() const
+{
+    return(NULL != m_header);
+}
+
+/***********************************************************
+ *  GetGeometryVersion()
+ *
+ *  This method returns the version of the shape geometry
+ *  that the mesh entries were built with, so the caller can
+ *  ignore meshes that are out of date.
+ ***********************************************************/
+uint32_t AssetPack::GetGeometryVersion() const
+{
+    return((NULL != m_header) ? m_header->geometryVersion : 0);
+}
+
+/***********************************************************
+ *  FindEntry()
+ *
+ *  This method is used for finding the entry of a texture or
+ *  mesh.  Returns NULL when the pack does not hold it.
+ ***********************************************************/
+const AssetPack::PACK_ENTRY* AssetPack::FindEntry(ENTRY_TYPE type, uint32_t key) const
+{
+    if (NULL == m_header)
+    {
+        return(NULL);
+    }
+
+    for (uint32_t i = 0; i < m_header->entryCount; i++)
+    {
+        if ((m_entries[i].type == (uint32_t)type) && (m_entries[i].key == key))
+        {
+            return(&m_entries[i]);
+        }
+    }
+
+    return(NULL);
+}
+
+/***********************************************************
+ *  GetEntryData()
+ *
+ *  This method returns the mapped data of an entry.
+ ***********************************************************/
+const unsigned char* AssetPack::GetEntryData(const PACK_ENTRY& entry) const
+{
+    return(m_data + entry.offset);
+}
+
+/***********************************************************
+ *  MakeMeshKey()
+ *
+ *  This method returns the key of the mesh entry of a shape
+ *  at a tessellation level.
+ ***********************************************************/
+uint32_t AssetPack::MakeMeshKey(int shape, int level)
+{
+    return(((uint32_t)shape << 8) | (uint32_t)level);
+}
+
+/***********************************************************
+ *  GetPixelSize()
+ *
+ *  This method returns the bytes of one pixel of a texture
+ *  format, or 0 for an unknown format.
+ ***********************************************************/
+uint32_t AssetPack::GetPixelSize(uint32_t format)
+{
+    switch (format)
+    {
+    case FORMAT_RGB8:
+        return(3);
+    case FORMAT_RGBA8:
+        return(4);
+    default:
+        return(0);
+    }
+}
+
+/***********************************************************
+ *  BuildMipChain()
+ *
+ *  This method is used for appending the mip levels below
+ *  the full size image, which is already in the data.  Every
+ *  level averages the 2 by 2 pixels of the level above, and
+ *  repeats the last row or column of an odd size.  Returns
+ *  the number of levels including the full size one.
+ ***********************************************************/
+uint32_t AssetPack::BuildMipChain(std::vector<unsigned char>& data, int width, int height, int pixelSize)
+{
+    uint32_t levelCount = 1;
+    size_t levelStart = 0;
+
+    while ((width > 1) || (height > 1))
+    {
+        int nextWidth = (width > 1) ? (width / 2) : 1;
+        int nextHeight = (height > 1) ? (height / 2) : 1;
+        size_t nextStart = data.size();
+
+        data.resize(nextStart + (size_t)nextWidth * nextHeight * pixelSize);
+
+        for (int y = 0; y < nextHeight; y++)
+        {
+            int y0 = y * 2;
+            int y1 = (y0 + 1 < height) ? (y0 + 1) : y0;
+
+            for (int x = 0; x < nextWidth; x++)
+            {
+                int x0 = x * 2;
+                int x1 = (x0 + 1 < width) ? (x0 + 1) : x0;
+                const unsigned char* pSource = &data[levelStart];
+                unsigned char* pDestination = &data[nextStart + ((size_t)y * nextWidth + x) * pixelSize];
+
+                for (int c = 0; c < pixelSize; c++)
+                {
+                    unsigned int sum =
+                        pSource[((size_t)y0 * width + x0) * pixelSize + c] +
+                        pSource[((size_t)y0 * width + x1) * pixelSize + c] +
+                        pSource[((size_t)y1 * width + x0) * pixelSize + c] +
+                        pSource[((size_t)y1 * width + x1) * pixelSize + c];
+
+                    pDestination[c] = (unsigned char)((sum + 2) / 4);
+                }
+            }
+        }
+
+        levelStart = nextStart;
+        width = nextWidth;
+        height = nextHeight;
+        levelCount++;
+    }
+
+    return(levelCount);
+}
+
+/***********************************************************
+ *  ComputeChecksum()
+ *
+ *  This method is used for computing the Adler-32 checksum
+ *  of a block of bytes.  The sums are only reduced once per
+ *  block of bytes, which keeps the check of a large pack
+ *  fast enough to run on every start.
+ ***********************************************************/
+uint32_t AssetPack::ComputeChecksum(const unsigned char* data, size_t size)
+{
+    uint32_t sumA = 1;
+    uint32_t sumB = 0;
+
+    while (size > 0)
+    {
+        size_t blockSize = (size < ADLER_BLOCK) ? size : ADLER_BLOCK;
+
+        size -= blockSize;
+        for (size_t i = 0; i < blockSize; i++)
+        {
+            sumA += data[i];
+            sumB += sumA;
+        }
+        data += blockSize;
+
+        sumA %= ADLER_MODULUS;
+        sumB %= ADLER_MODULUS;
+    }
+
+    return((sumB << 16) | sumA);
+}
+
+/***********************************************************
+ *  Validate()
+ *
+ *  This method is used for checking that the mapped file is
+ *  a pack of the current version, that every entry lies
+ *  inside the file and that the checksum matches.
+ ***********************************************************/
+bool AssetPack::Validate(const char* filename)
+{
+    const PACK_HEADER* pHeader = (const PACK_HEADER*)m_data;
+
+    if ((m_size < sizeof(PACK_HEADER)) || (pHeader->magic != PACK_MAGIC))
+    {
+        std::cout << "Not an asset pack:" << filename << std::endl;
+        return(false);
+    }
+
+    if (pHeader->version != PACK_VERSION)
+    {
+        std::cout << "Asset pack version " << pHeader->version << " is not supported:" << filename << std::endl;
+        return(false);
+    }
+
+    size_t tableSize = (size_t)pHeader->entryCount * sizeof(PACK_ENTRY);
+    if ((pHeader->fileSize != m_size) || (tableSize > m_size - sizeof(PACK_HEADER)))
+    {
+        std::cout << "Asset pack is truncated:" << filename << std::endl;
+        return(false);
+    }
+
+    const PACK_ENTRY* pEntries = (const PACK_ENTRY*)(m_data + sizeof(PACK_HEADER));
+    for (uint32_t i = 0; i < pHeader->entryCount; i++)
+    {
+        if ((pEntries[i].offset > m_size) || (pEntries[i].size > m_size - pEntries[i].offset))
+        {
+            std::cout << "Asset pack entry is out of range:" << filename << std::endl;
+            return(false);
+        }
+    }
+
+    if (ComputeChecksum(m_data + sizeof(PACK_HEADER), m_size - sizeof(PACK_HEADER)) != pHeader->checksum)
+    {
+        std::cout << "Asset pack checksum does not match:" << filename << std::endl;
+        return(false);
+    }
+
+    m_header = pHeader;
+    m_entries = pEntries;
+
+    return(true);
+}
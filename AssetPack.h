@@ -0,0 +1,129 @@
+///////////////////////////////////////////////////////////////////////////////
+// assetpack.h
+// ============
+// read only mapping of a baked pack of scene textures and meshes
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  AssetPack
+ *
+ *  This class maps a pack file that the asset packer baked
+ *  offline into memory.  The pack holds the scene textures
+ *  with their whole mip chains and the vertex and index data
+ *  of the basic shapes in the layout that OpenGL reads, so
+ *  the application uploads straight from the mapped file
+ *  without decoding any images or building any meshes.
+ *
+ *  The file starts with a header, followed by the table of
+ *  entries and the data of the entries.  The header holds a
+ *  version and a checksum of everything after the header,
+ *  and a pack that does not match is not opened, so the
+ *  application falls back to loading the source assets.
+ *  The pack is written in the byte order of the machine.
+ ***********************************************************/
+class AssetPack
+{
+public:
+    // constructor
+    AssetPack();
+    // destructor
+    ~AssetPack();
+
+    // identifies a pack file, "SPAK" in the file
+    static const uint32_t PACK_MAGIC = 0x4B415053;
+    // changed whenever the layout of the pack changes
+    static const uint32_t PACK_VERSION = 1;
+    // alignment of the data of every entry in the file
+    static const size_t DATA_ALIGNMENT = 16;
+
+    // kinds of data in the pack
+    enum ENTRY_TYPE
+    {
+        ENTRY_TEXTURE = 1,
+        ENTRY_MESH = 2
+    };
+
+    // pixel layouts of the texture entries
+    enum TEXTURE_FORMAT
+    {
+        FORMAT_RGB8 = 1,
+        FORMAT_RGBA8 = 2
+    };
+
+    // start of the pack file
+    struct PACK_HEADER
+    {
+        uint32_t magic;
+        uint32_t version;
+        // version of the shape geometry the meshes were built with
+        uint32_t geometryVersion;
+        uint32_t entryCount;
+        uint64_t fileSize;
+        // Adler-32 of the bytes after the header
+        uint32_t checksum;
+        uint32_t reserved;
+    };
+
+    // one texture or mesh in the pack
+    struct PACK_ENTRY
+    {
+        uint32_t type;
+        // tag hash of a texture, shape key of a mesh
+        uint32_t key;
+        // position and size of the data in the file
+        uint64_t offset;
+        uint64_t size;
+        // texture entries - the mip levels follow each other
+        // from the full size down to 1 by 1, with unpadded rows
+        uint32_t width;
+        uint32_t height;
+        uint32_t format;
+        uint32_t levelCount;
+        // mesh entries - the vertices are followed by the indices
+        uint32_t vertexCount;
+        uint32_t indexCount;
+    };
+
+    // map a pack file and check its header and checksum
+    bool Open(const char* filename);
+    // unmap the pack file
+    void Close();
+    bool IsOpen() const;
+
+    // version of the shape geometry of the mesh entries
+    uint32_t GetGeometryVersion() const;
+    // find an entry by its type and key, NULL if it is missing
+    const PACK_ENTRY* FindEntry(ENTRY_TYPE type, uint32_t key) const;
+    // mapped data of an entry
+    const unsigned char* GetEntryData(const PACK_ENTRY& entry) const;
+
+    // key of the mesh of a shape at a tessellation level
+    static uint32_t MakeMeshKey(int shape, int level);
+    // bytes of one pixel of a texture format
+    static uint32_t GetPixelSize(uint32_t format);
+    // append the mip levels of an image in the pack layout
+    static uint32_t BuildMipChain(std::vector<unsigned char>& data, int width, int height, int pixelSize);
+    // Adler-32 checksum of a block of bytes
+    static uint32_t ComputeChecksum(const unsigned char* data, size_t size);
+
+private:
+    // mapped pack file, NULL when no pack is open
+    const unsigned char* m_data;
+    size_t m_size;
+    const PACK_HEADER* m_header;
+    const PACK_ENTRY* m_entries;
+
+    MappedFile m_file;
+
+    // check the header, entries and checksum of the mapping
+    bool Validate(const char* filename);
+};
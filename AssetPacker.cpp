@@ -0,0 +1,249 @@
+///////////////////////////////////////////////////////////////////////////////
+// assetpacker.cpp
+// ============
+// offline tool that bakes the scene textures and meshes into one pack
+//
+//  usage: AssetPacker <asset list> <pack file> [<scene text> <scene file>]
+//
+//  Every line of the asset list names one texture as a tag and
+//  an image file, separated by white space.  Empty lines and
+//  lines starting with # are skipped.  The meshes of all of the
+//  basic shapes are always baked.  A scene description in the
+//  text form is compiled into the binary scene file as well
+//  when both of them are passed in.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AssetPack.h"
+#include "SceneFile.h"
+#include "ShapeGeometry.h"
+#include "TagRegistry.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#endif
+
+// declaration of the global variables and defines
+namespace
+{
+    // one entry of the pack with its data
+    struct BAKED_ENTRY
+    {
+        AssetPack::PACK_ENTRY entry;
+        std::vector<unsigned char> data;
+    };
+
+    /***********************************************************
+     *  BakeTexture()
+     *
+     *  This function is used for decoding an image the way the
+     *  application does, flipped vertically, and storing it with
+     *  its whole mip chain.  Images without color are expanded
+     *  to RGB or RGBA.
+     ***********************************************************/
+    bool BakeTexture(const std::string& tag, const std::string& filename, BAKED_ENTRY& baked)
+    {
+        int width = 0;
+        int height = 0;
+        int colorChannels = 0;
+
+        if (stbi_info(filename.c_str(), &width, &height, &colorChannels) == 0)
+        {
+            std::cout << "Could not load image:" << filename << std::endl;
+            return(false);
+        }
+
+        int pixelSize = ((colorChannels == 2) || (colorChannels == 4)) ? 4 : 3;
+
+        stbi_set_flip_vertically_on_load(true);
+        unsigned char* image = stbi_load(filename.c_str(), &width, &height, &colorChannels, pixelSize);
+        if (NULL == image)
+        {
+            std::cout << "Could not load image:" << filename << std::endl;
+            return(false);
+        }
+
+        baked.data.assign(image, image + (size_t)width * height * pixelSize);
+        stbi_image_free(image);
+
+        memset(&baked.entry, 0, sizeof(baked.entry));
+        baked.entry.type = AssetPack::ENTRY_TEXTURE;
+        baked.entry.key = HashTag(tag.c_str());
+        baked.entry.width = (uint32_t)width;
+        baked.entry.height = (uint32_t)height;
+        baked.entry.format = (pixelSize == 4) ? AssetPack::FORMAT_RGBA8 : AssetPack::FORMAT_RGB8;
+        baked.entry.levelCount = AssetPack::BuildMipChain(baked.data, width, height, pixelSize);
+
+        std::cout << "Baked image:" << filename << ", width:" << width << ", height:" << height << ", levels:" << baked.entry.levelCount << std::endl;
+
+        return(true);
+    }
+
+    /***********************************************************
+     *  BakeMesh()
+     *
+     *  This function is used for building the vertex and index
+     *  data of a shape at a tessellation level with the same
+     *  builder that the application uses.
+     ***********************************************************/
+    void BakeMesh(ShapeGeometry::SHAPE shape, int level, BAKED_ENTRY& baked)
+    {
+        ShapeGeometry::MESH_DATA mesh;
+        size_t vertexBytes;
+        size_t indexBytes;
+
+        ShapeGeometry::BuildShapeMesh(shape, level, mesh);
+        vertexBytes = mesh.vertices.size() * sizeof(ShapeGeometry::MESH_VERTEX);
+        indexBytes = mesh.indices.size() * sizeof(uint32_t);
+
+        baked.data.resize(vertexBytes + indexBytes);
+        memcpy(baked.data.data(), mesh.vertices.data(), vertexBytes);
+        memcpy(baked.data.data() + vertexBytes, mesh.indices.data(), indexBytes);
+
+        memset(&baked.entry, 0, sizeof(baked.entry));
+        baked.entry.type = AssetPack::ENTRY_MESH;
+        baked.entry.key = AssetPack::MakeMeshKey(shape, level);
+        baked.entry.vertexCount = (uint32_t)mesh.vertices.size();
+        baked.entry.indexCount = (uint32_t)mesh.indices.size();
+    }
+
+    /***********************************************************
+     *  WritePack()
+     *
+     *  This function is used for laying out the header, the
+     *  entry table and the aligned entry data, and writing them
+     *  to the pack file with the checksum of the contents.
+     ***********************************************************/
+    bool WritePack(const char* filename, std::vector<BAKED_ENTRY>& entries)
+    {
+        size_t tableSize = entries.size() * sizeof(AssetPack::PACK_ENTRY);
+        size_t fileSize = sizeof(AssetPack::PACK_HEADER) + tableSize;
+
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            fileSize = (fileSize + AssetPack::DATA_ALIGNMENT - 1) & ~(AssetPack::DATA_ALIGNMENT - 1);
+            entries[i].entry.offset = fileSize;
+            entries[i].entry.size = entries[i].data.size();
+            fileSize += entries[i].data.size();
+        }
+
+        std::vector<unsigned char> file(fileSize, 0);
+        AssetPack::PACK_ENTRY* pTable = (AssetPack::PACK_ENTRY*)(file.data() + sizeof(AssetPack::PACK_HEADER));
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            pTable[i] = entries[i].entry;
+            if (entries[i].data.empty() == false)
+            {
+                memcpy(file.data() + entries[i].entry.offset, entries[i].data.data(), entries[i].data.size());
+            }
+        }
+
+        AssetPack::PACK_HEADER header;
+        memset(&header, 0, sizeof(header));
+        header.magic = AssetPack::PACK_MAGIC;
+        header.version = AssetPack::PACK_VERSION;
+        header.geometryVersion = ShapeGeometry::GEOMETRY_VERSION;
+        header.entryCount = (uint32_t)entries.size();
+        header.fileSize = fileSize;
+        header.checksum = AssetPack::ComputeChecksum(
+            file.data() + sizeof(AssetPack::PACK_HEADER),
+            fileSize - sizeof(AssetPack::PACK_HEADER));
+        memcpy(file.data(), &header, sizeof(header));
+
+        std::ofstream output(filename, std::ios::binary | std::ios::trunc);
+        output.write((const char*)file.data(), (std::streamsize)file.size());
+        if (!output)
+        {
+            std::cout << "Could not write asset pack:" << filename << std::endl;
+            return(false);
+        }
+
+        std::cout << "Wrote asset pack:" << filename << ", entries:" << entries.size() << ", bytes:" << fileSize << std::endl;
+
+        return(true);
+    }
+}
+
+/***********************************************************
+ *  main()
+ *
+ *  This function is used for baking the textures of the
+ *  asset list and the meshes of the basic shapes into the
+ *  pack file, and compiling the scene description.  Returns
+ *  0 when the pack and the scene file were written.
+ ***********************************************************/
+int main(int argc, char* argv[])
+{
+    if ((argc != 3) && (argc != 5))
+    {
+        std::cout << "usage: AssetPacker <asset list> <pack file> [<scene text> <scene file>]" << std::endl;
+        return(1);
+    }
+
+    if (argc == 5)
+    {
+        SceneFile scene;
+
+        if (scene.LoadText(argv[3]) == false)
+        {
+            std::cout << "Could not load scene description:" << argv[3] << std::endl;
+            return(1);
+        }
+        if (scene.SaveBinary(argv[4]) == false)
+        {
+            return(1);
+        }
+    }
+
+    std::ifstream assetList(argv[1]);
+    if (!assetList)
+    {
+        std::cout << "Could not open asset list:" << argv[1] << std::endl;
+        return(1);
+    }
+
+    std::vector<BAKED_ENTRY> entries;
+    std::string line;
+    while (std::getline(assetList, line))
+    {
+        std::istringstream fields(line);
+        std::string tag;
+        std::string filename;
+
+        if (!(fields >> tag) || (tag[0] == '#'))
+        {
+            continue;
+        }
+        if (!(fields >> filename))
+        {
+            std::cout << "Texture has no image file:" << tag << std::endl;
+            return(1);
+        }
+
+        entries.push_back(BAKED_ENTRY());
+        if (BakeTexture(tag, filename, entries.back()) == false)
+        {
+            return(1);
+        }
+    }
+
+    for (int shape = 0; shape < ShapeGeometry::SHAPE_COUNT; shape++)
+    {
+        int levelCount = ShapeGeometry::HasLevels((ShapeGeometry::SHAPE)shape) ? ShapeGeometry::LEVEL_COUNT : 1;
+
+        for (int level = 0; level < levelCount; level++)
+        {
+            entries.push_back(BAKED_ENTRY());
+            BakeMesh((ShapeGeometry::SHAPE)shape, level, entries.back());
+        }
+    }
+
+    return(WritePack(argv[2], entries) ? 0 : 1);
+}
@@ -89,6 +89,14 @@ public:
             Zoom = 45.0f;
     }
 
+    void SetPose(glm::vec3 position, float yaw, float pitch)
+    {
+        Position = position;
+        Yaw = yaw;
+        Pitch = pitch;
+        updateCameraVectors();
+    }
+
 private:
     void updateCameraVectors()
     {
@@ -0,0 +1,535 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameprofiler.cpp
+// ============
+// measure the CPU and GPU time of named scopes of every frame
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameProfiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+
+// declaration of the global variables and defines
+namespace
+{
+    // frames whose times are kept for the percentiles
+    const size_t HISTORY_FRAMES = 240;
+    // events kept for the trace, the oldest are dropped first
+    const size_t MAX_TRACE_EVENTS = 200000;
+    // frames between lining up the GPU clock with the CPU clock
+    const uint64_t CLOCK_SYNC_FRAMES = 600;
+    // name of the scope around a whole frame
+    const char* const FRAME_SCOPE_NAME = "Frame";
+}
+
+/***********************************************************
+ *  FrameProfiler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameProfiler::FrameProfiler()
+{
+    m_startTime = std::chrono::steady_clock::now();
+    m_frameNumber = 0;
+    m_bFrameActive = false;
+    m_gpuClockOffset = 0;
+    m_droppedGpuFrames = 0;
+    m_nextCpuFrameTime = 0;
+    m_nextGpuFrameTime = 0;
+    m_bFrameLogging = false;
+
+    for (int i = 0; i < FRAME_LATENCY; i++)
+    {
+        glGenQueries(MAX_GPU_SCOPES * 2, m_frames[i].queries);
+        m_frames[i].frameNumber = 0;
+        m_frames[i].queryCount = 0;
+        m_frames[i].bPending = false;
+    }
+
+    SyncGpuClock();
+}
+
+/***********************************************************
+ *  ~FrameProfiler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameProfiler::~FrameProfiler()
+{
+    for (int i = 0; i < FRAME_LATENCY; i++)
+    {
+        glDeleteQueries(MAX_GPU_SCOPES * 2, m_frames[i].queries);
+    }
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting the scope around a new
+ *  frame.  The queries of the older frames that are done are
+ *  read back first, and the set of queries that the new frame
+ *  reuses is given up when it is still not done.
+ ***********************************************************/
+void FrameProfiler::BeginFrame()
+{
+    if (m_bFrameActive)
+    {
+        EndFrame();
+    }
+
+    m_frameNumber++;
+
+    // the slot of the new frame is the oldest one in flight
+    for (int i = 0; i < FRAME_LATENCY; i++)
+    {
+        FRAME_SLOT& frame = m_frames[(m_frameNumber + i) % FRAME_LATENCY];
+
+        if (frame.bPending == false)
+        {
+            continue;
+        }
+
+        CollectFrame(frame);
+        if ((0 == i) && frame.bPending)
+        {
+            frame.bPending = false;
+            m_droppedGpuFrames++;
+        }
+    }
+
+    if (0 == (m_frameNumber % CLOCK_SYNC_FRAMES))
+    {
+        SyncGpuClock();
+    }
+
+    FRAME_SLOT& frame = m_frames[m_frameNumber % FRAME_LATENCY];
+    frame.frameNumber = m_frameNumber;
+    frame.scopes.clear();
+    frame.queryCount = 0;
+
+    m_bFrameActive = true;
+    m_openScopes.clear();
+    BeginScope(FRAME_SCOPE_NAME);
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for closing the scopes of the current
+ *  frame and keeping their CPU times.  The GPU times are read
+ *  back by a later frame.
+ ***********************************************************/
+void FrameProfiler::EndFrame()
+{
+    if (m_bFrameActive == false)
+    {
+        return;
+    }
+
+    while (!m_openScopes.empty())
+    {
+        EndScope();
+    }
+    m_bFrameActive = false;
+
+    FRAME_SLOT& frame = m_frames[m_frameNumber % FRAME_LATENCY];
+    for (size_t i = 0; i < frame.scopes.size(); i++)
+    {
+        const SCOPE_RECORD& scope = frame.scopes[i];
+        TRACE_EVENT event;
+
+        event.name = scope.name;
+        event.bGPU = false;
+        event.depth = scope.depth;
+        event.frameNumber = frame.frameNumber;
+        event.begin = scope.cpuBegin;
+        event.duration = scope.cpuEnd - scope.cpuBegin;
+        AddTraceEvent(event);
+    }
+
+    // the frame scope is always the first one
+    double cpuMilliseconds = (frame.scopes[0].cpuEnd - frame.scopes[0].cpuBegin) / 1000000.0;
+    AddFrameTime(m_cpuFrameTimes, m_nextCpuFrameTime, cpuMilliseconds);
+    if (m_bFrameLogging)
+    {
+        FRAME_TIMES times;
+
+        times.frameNumber = frame.frameNumber;
+        times.cpuMilliseconds = cpuMilliseconds;
+        times.gpuMilliseconds = -1.0;
+        m_frameLog.push_back(times);
+    }
+
+    frame.bPending = (frame.queryCount > 0);
+}
+
+/***********************************************************
+ *  BeginScope()
+ *
+ *  This method is used for opening a named scope inside of
+ *  the current frame.  A timestamp is written on the GPU
+ *  while the frame has queries left, and the scopes after
+ *  that are only timed on the CPU.
+ ***********************************************************/
+void FrameProfiler::BeginScope(const char* name)
+{
+    if (m_bFrameActive == false)
+    {
+        return;
+    }
+
+    FRAME_SLOT& frame = m_frames[m_frameNumber % FRAME_LATENCY];
+    SCOPE_RECORD scope;
+
+    scope.name = name;
+    scope.depth = (int)m_openScopes.size();
+    scope.query = -1;
+    if (frame.queryCount + 2 <= MAX_GPU_SCOPES * 2)
+    {
+        scope.query = frame.queryCount;
+        frame.queryCount += 2;
+        glQueryCounter(frame.queries[scope.query], GL_TIMESTAMP);
+    }
+    scope.cpuBegin = GetCpuTime();
+    scope.cpuEnd = scope.cpuBegin;
+
+    m_openScopes.push_back((int)frame.scopes.size());
+    frame.scopes.push_back(scope);
+}
+
+/***********************************************************
+ *  EndScope()
+ *
+ *  This method is used for closing the scope opened last.
+ ***********************************************************/
+void FrameProfiler::EndScope()
+{
+    if ((m_bFrameActive == false) || m_openScopes.empty())
+    {
+        return;
+    }
+
+    FRAME_SLOT& frame = m_frames[m_frameNumber % FRAME_LATENCY];
+    SCOPE_RECORD& scope = frame.scopes[m_openScopes.back()];
+
+    m_openScopes.pop_back();
+    scope.cpuEnd = GetCpuTime();
+    if (scope.query >= 0)
+    {
+        glQueryCounter(frame.queries[scope.query + 1], GL_TIMESTAMP);
+    }
+}
+
+/***********************************************************
+ *  GetCpuPercentiles()
+ *
+ *  This method returns the percentiles of the CPU time of
+ *  the last frames.
+ ***********************************************************/
+FrameProfiler::FRAME_PERCENTILES FrameProfiler::GetCpuPercentiles() const
+{
+    return(GetPercentiles(m_cpuFrameTimes));
+}
+
+/***********************************************************
+ *  GetGpuPercentiles()
+ *
+ *  This method returns the percentiles of the GPU time of
+ *  the last frames whose queries have been read back.
+ ***********************************************************/
+FrameProfiler::FRAME_PERCENTILES FrameProfiler::GetGpuPercentiles() const
+{
+    return(GetPercentiles(m_gpuFrameTimes));
+}
+
+/***********************************************************
+ *  GetDroppedGpuFrames()
+ *
+ *  This method returns the number of frames whose GPU times
+ *  were not done when their queries were needed again.
+ ***********************************************************/
+uint64_t FrameProfiler::GetDroppedGpuFrames() const
+{
+    return(m_droppedGpuFrames);
+}
+
+/***********************************************************
+ *  CollectPending()
+ *
+ *  This method is used for reading back the GPU times of all
+ *  of the frames in flight, waiting for the GPU to finish
+ *  them.  It is meant for the end of a measurement, since it
+ *  stalls the CPU.
+ ***********************************************************/
+void FrameProfiler::CollectPending()
+{
+    glFinish();
+    for (int i = 1; i <= FRAME_LATENCY; i++)
+    {
+        // oldest frame first
+        FRAME_SLOT& frame = m_frames[(m_frameNumber + i) % FRAME_LATENCY];
+
+        if (frame.bPending)
+        {
+            CollectFrame(frame);
+        }
+    }
+}
+
+/***********************************************************
+ *  SetFrameLogging()
+ *
+ *  This method is used for starting to keep the times of
+ *  every frame, such as after the warm up frames of a
+ *  benchmark, or for stopping.  Starting clears the log.
+ ***********************************************************/
+void FrameProfiler::SetFrameLogging(bool bEnabled)
+{
+    if (bEnabled && (m_bFrameLogging == false))
+    {
+        m_frameLog.clear();
+    }
+    m_bFrameLogging = bEnabled;
+}
+
+/***********************************************************
+ *  GetFrameLog()
+ *
+ *  This method returns the times of the frames since the
+ *  logging was enabled, in the order they were rendered.
+ ***********************************************************/
+const std::vector<FrameProfiler::FRAME_TIMES>& FrameProfiler::GetFrameLog() const
+{
+    return(m_frameLog);
+}
+
+/***********************************************************
+ *  WriteTrace()
+ *
+ *  This method is used for writing the kept events to a file
+ *  in the Chrome trace event format, which can be opened in
+ *  chrome://tracing or Perfetto.  The CPU and GPU scopes are
+ *  shown as two threads on the same time line.
+ ***********************************************************/
+bool FrameProfiler::WriteTrace(const char* filename) const
+{
+    std::ofstream file(filename);
+
+    if (!file.is_open())
+    {
+        return(false);
+    }
+
+    file << std::fixed << std::setprecision(3);
+    file << "{\"traceEvents\":[\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+    for (size_t i = 0; i < m_traceEvents.size(); i++)
+    {
+        const TRACE_EVENT& event = m_traceEvents[i];
+
+        // the times of the trace format are in microseconds
+        file << ",\n{\"name\":\"" << event.name << "\""
+            << ",\"cat\":\"" << (event.bGPU ? "gpu" : "cpu") << "\""
+            << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << (event.bGPU ? 2 : 1)
+            << ",\"ts\":" << (event.begin / 1000.0)
+            << ",\"dur\":" << (event.duration / 1000.0)
+            << ",\"args\":{\"frame\":" << event.frameNumber << ",\"depth\":" << event.depth << "}}";
+    }
+
+    file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    return(file.good());
+}
+
+/***********************************************************
+ *  GetCpuTime()
+ *
+ *  This method returns the nanoseconds of the CPU clock since
+ *  the profiler was created.
+ ***********************************************************/
+int64_t FrameProfiler::GetCpuTime() const
+{
+    return((int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - m_startTime).count());
+}
+
+/***********************************************************
+ *  SyncGpuClock()
+ *
+ *  This method is used for finding the offset between the
+ *  GPU timestamps and the CPU clock, so the GPU scopes are
+ *  placed under the CPU scopes that issued them.
+ ***********************************************************/
+void FrameProfiler::SyncGpuClock()
+{
+    GLint64 gpuTime = 0;
+
+    glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+    m_gpuClockOffset = (int64_t)gpuTime - GetCpuTime();
+}
+
+/***********************************************************
+ *  CollectFrame()
+ *
+ *  This method is used for reading back the GPU times of a
+ *  frame once its queries are done.  The end of the frame
+ *  scope is written last, and the GPU writes the timestamps
+ *  in order, so all of the queries are done when it is.  The
+ *  frame stays pending when it is not done.
+ ***********************************************************/
+void FrameProfiler::CollectFrame(FRAME_SLOT& frame)
+{
+    GLint available = 0;
+
+    glGetQueryObjectiv(frame.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (0 == available)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < frame.scopes.size(); i++)
+    {
+        const SCOPE_RECORD& scope = frame.scopes[i];
+        GLuint64 begin = 0;
+        GLuint64 end = 0;
+        TRACE_EVENT event;
+
+        if (scope.query < 0)
+        {
+            continue;
+        }
+
+        glGetQueryObjectui64v(frame.queries[scope.query], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(frame.queries[scope.query + 1], GL_QUERY_RESULT, &end);
+
+        event.name = scope.name;
+        event.bGPU = true;
+        event.depth = scope.depth;
+        event.frameNumber = frame.frameNumber;
+        event.begin = (int64_t)begin - m_gpuClockOffset;
+        event.duration = (end > begin) ? (int64_t)(end - begin) : 0;
+        AddTraceEvent(event);
+
+        if (0 == i)
+        {
+            AddFrameTime(m_gpuFrameTimes, m_nextGpuFrameTime, event.duration / 1000000.0);
+            LogGpuTime(frame.frameNumber, event.duration / 1000000.0);
+        }
+    }
+
+    frame.bPending = false;
+}
+
+/***********************************************************
+ *  LogGpuTime()
+ *
+ *  This method is used for filling in the GPU time of a
+ *  logged frame once its queries are read back.  The log is
+ *  in frame order, so the frame is found from the first one.
+ ***********************************************************/
+void FrameProfiler::LogGpuTime(uint64_t frameNumber, double milliseconds)
+{
+    if (m_frameLog.empty() || (frameNumber < m_frameLog[0].frameNumber))
+    {
+        return;
+    }
+
+    size_t index = (size_t)(frameNumber - m_frameLog[0].frameNumber);
+    if ((index < m_frameLog.size()) && (m_frameLog[index].frameNumber == frameNumber))
+    {
+        m_frameLog[index].gpuMilliseconds = milliseconds;
+    }
+}
+
+/***********************************************************
+ *  AddTraceEvent()
+ *
+ *  This method is used for keeping an event for the trace,
+ *  dropping the oldest event when too many are kept.
+ ***********************************************************/
+void FrameProfiler::AddTraceEvent(const TRACE_EVENT& event)
+{
+    m_traceEvents.push_back(event);
+    if (m_traceEvents.size() > MAX_TRACE_EVENTS)
+    {
+        m_traceEvents.pop_front();
+    }
+}
+
+/***********************************************************
+ *  AddFrameTime()
+ *
+ *  This method is used for keeping the time of a frame in a
+ *  ring of the times of the last frames.
+ ***********************************************************/
+void FrameProfiler::AddFrameTime(std::vector<double>& times, size_t& next, double milliseconds)
+{
+    if (times.size() < HISTORY_FRAMES)
+    {
+        times.push_back(milliseconds);
+        return;
+    }
+
+    times[next] = milliseconds;
+    next = (next + 1) % HISTORY_FRAMES;
+}
+
+/***********************************************************
+ *  GetPercentiles()
+ *
+ *  This method returns the nearest rank percentiles of a list
+ *  of frame times, such as the ring of the last frames.
+ ***********************************************************/
+FrameProfiler::FRAME_PERCENTILES FrameProfiler::GetPercentiles(const std::vector<double>& times)
+{
+    FRAME_PERCENTILES percentiles;
+    std::vector<double> sorted(times);
+
+    percentiles.p50 = 0.0;
+    percentiles.p95 = 0.0;
+    percentiles.p99 = 0.0;
+    percentiles.frameCount = (uint32_t)sorted.size();
+    if (sorted.empty())
+    {
+        return(percentiles);
+    }
+
+    std::sort(sorted.begin(), sorted.end());
+    percentiles.p50 = sorted[(size_t)std::ceil(0.50 * sorted.size()) - 1];
+    percentiles.p95 = sorted[(size_t)std::ceil(0.95 * sorted.size()) - 1];
+    percentiles.p99 = sorted[(size_t)std::ceil(0.99 * sorted.size()) - 1];
+
+    return(percentiles);
+}
+
+/***********************************************************
+ *  ProfileScope()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ProfileScope::ProfileScope(FrameProfiler* pProfiler, const char* name)
+{
+    m_pProfiler = pProfiler;
+    if (NULL != m_pProfiler)
+    {
+        m_pProfiler->BeginScope(name);
+    }
+}
+
+/***********************************************************
+ *  ~ProfileScope()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ProfileScope::~ProfileScope()
+{
+    if (NULL != m_pProfiler)
+    {
+        m_pProfiler->EndScope();
+    }
+}
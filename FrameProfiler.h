@@ -0,0 +1,184 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameprofiler.h
+// ============
+// measure the CPU and GPU time of named scopes of every frame
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+/***********************************************************
+ *  FrameProfiler
+ *
+ *  This class measures named scopes of the frames, such as
+ *  the scene rendering or one multi-draw call.  The CPU time
+ *  of a scope is taken from a steady high resolution clock,
+ *  and its GPU time from timestamp queries written at its
+ *  begin and end.  The queries of a frame are read back a
+ *  few frames later from a ring of query sets, and only when
+ *  they are available, so the profiler never waits for the
+ *  GPU.  A frame whose queries are not done when its set is
+ *  needed again only keeps its CPU times.
+ *
+ *  The scopes are kept as events that can be written to a
+ *  Chrome trace file, and the frame times of the last frames
+ *  are kept for their percentiles.
+ ***********************************************************/
+class FrameProfiler
+{
+public:
+    // constructor
+    FrameProfiler();
+    // destructor
+    ~FrameProfiler();
+
+    // frames whose queries can be in flight
+    static const int FRAME_LATENCY = 4;
+    // scopes of one frame that are timed on the GPU
+    static const int MAX_GPU_SCOPES = 64;
+
+    // rolling percentiles of the frame times in milliseconds
+    struct FRAME_PERCENTILES
+    {
+        double p50;
+        double p95;
+        double p99;
+        // number of frames the percentiles are taken from
+        uint32_t frameCount;
+    };
+
+    // times of one logged frame in milliseconds
+    struct FRAME_TIMES
+    {
+        uint64_t frameNumber;
+        double cpuMilliseconds;
+        // negative until the queries are read back, and when
+        // they were dropped
+        double gpuMilliseconds;
+    };
+
+    // start a frame, reading back the queries of older frames
+    void BeginFrame();
+    // end the frame started last
+    void EndFrame();
+    // time a named scope inside of the frame, scopes nest and the
+    // name must stay valid, such as a string literal
+    void BeginScope(const char* name);
+    void EndScope();
+
+    // percentiles of the CPU or GPU time of the last frames
+    FRAME_PERCENTILES GetCpuPercentiles() const;
+    FRAME_PERCENTILES GetGpuPercentiles() const;
+    // frames whose GPU times were dropped because the queries
+    // were not done in time
+    uint64_t GetDroppedGpuFrames() const;
+    // wait for the GPU and read back the queries of all frames
+    void CollectPending();
+
+    // keep the times of every frame from now on, or stop
+    void SetFrameLogging(bool bEnabled);
+    // times of the frames since the logging was enabled
+    const std::vector<FRAME_TIMES>& GetFrameLog() const;
+    // nearest rank percentiles of a list of frame times
+    static FRAME_PERCENTILES GetPercentiles(const std::vector<double>& times);
+
+    // write the kept events as a Chrome trace JSON file
+    bool WriteTrace(const char* filename) const;
+
+private:
+    // one timed scope of a frame
+    struct SCOPE_RECORD
+    {
+        const char* name;
+        int depth;
+        // nanoseconds since the profiler was created
+        int64_t cpuBegin;
+        int64_t cpuEnd;
+        // first of the two timestamp queries, -1 when the scope
+        // is not timed on the GPU
+        int query;
+    };
+
+    // the scopes and queries of one frame in flight
+    struct FRAME_SLOT
+    {
+        uint64_t frameNumber;
+        std::vector<SCOPE_RECORD> scopes;
+        GLuint queries[MAX_GPU_SCOPES * 2];
+        int queryCount;
+        // set while the queries have not been read back
+        bool bPending;
+    };
+
+    // one event of the trace file
+    struct TRACE_EVENT
+    {
+        const char* name;
+        bool bGPU;
+        int depth;
+        uint64_t frameNumber;
+        int64_t begin;
+        int64_t duration;
+    };
+
+    std::chrono::steady_clock::time_point m_startTime;
+    FRAME_SLOT m_frames[FRAME_LATENCY];
+    uint64_t m_frameNumber;
+    bool m_bFrameActive;
+    // indices of the open scopes of the current frame
+    std::vector<int> m_openScopes;
+    // GPU clock minus CPU clock, in nanoseconds
+    int64_t m_gpuClockOffset;
+    uint64_t m_droppedGpuFrames;
+
+    // times of the last frames in milliseconds, as rings
+    std::vector<double> m_cpuFrameTimes;
+    std::vector<double> m_gpuFrameTimes;
+    size_t m_nextCpuFrameTime;
+    size_t m_nextGpuFrameTime;
+
+    // events kept for the trace, oldest first
+    std::deque<TRACE_EVENT> m_traceEvents;
+
+    // times of every frame since the logging was enabled
+    bool m_bFrameLogging;
+    std::vector<FRAME_TIMES> m_frameLog;
+
+    // nanoseconds of the CPU clock since the profiler was created
+    int64_t GetCpuTime() const;
+    // line up the GPU clock with the CPU clock
+    void SyncGpuClock();
+    // read back the GPU times of a frame slot when they are done
+    void CollectFrame(FRAME_SLOT& frame);
+    // fill in the GPU time of a logged frame
+    void LogGpuTime(uint64_t frameNumber, double milliseconds);
+    // keep an event for the trace and drop the oldest events
+    void AddTraceEvent(const TRACE_EVENT& event);
+    // keep a frame time in a ring of the last frame times
+    static void AddFrameTime(std::vector<double>& times, size_t& next, double milliseconds);
+};
+
+/***********************************************************
+ *  ProfileScope
+ *
+ *  This class times a named scope of a frame profiler from
+ *  its construction to the end of the enclosing block.  No
+ *  scope is timed when the profiler is NULL.
+ ***********************************************************/
+class ProfileScope
+{
+public:
+    // constructor
+    ProfileScope(FrameProfiler* pProfiler, const char* name);
+    // destructor
+    ~ProfileScope();
+
+private:
+    FrameProfiler* m_pProfiler;
+};
@@ -0,0 +1,433 @@
+///////////////////////////////////////////////////////////////////////////////
+// glstatecache.cpp
+// ============
+// shadow copy of the OpenGL state that drops the redundant state changes
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GLStateCache.h"
+
+#include <cstring>
+
+#include <glm/gtc/type_ptr.hpp>
+
+// declaration of the global variables and defines
+namespace
+{
+    // the cache of the one OpenGL context
+    GLStateCache g_GLStateCache;
+
+    // key of a pair of 32 bit values in the shadow maps
+    uint64_t MakeStateKey(uint32_t high, uint32_t low)
+    {
+        return(((uint64_t)high << 32) | low);
+    }
+}
+
+/***********************************************************
+ *  GetGLStateCache()
+ *
+ *  This function returns the state cache of the OpenGL
+ *  context, which is used by every class that sets state.
+ ***********************************************************/
+GLStateCache& GetGLStateCache()
+{
+    return(g_GLStateCache);
+}
+
+/***********************************************************
+ *  GLStateCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GLStateCache::GLStateCache()
+{
+    Invalidate();
+    ResetStats();
+}
+
+/***********************************************************
+ *  Invalidate()
+ *
+ *  This method is used for forgetting all of the shadowed
+ *  state, after the state was changed around the cache.  The
+ *  next call of every state goes through.
+ ***********************************************************/
+void GLStateCache::Invalidate()
+{
+    m_programID = UNKNOWN_STATE;
+    m_vertexArray = UNKNOWN_STATE;
+    m_activeTexture = UNKNOWN_STATE;
+    m_textures.clear();
+    m_capabilities.clear();
+    m_bClearColorKnown = false;
+    m_clearColor = glm::vec4(0.0f);
+    m_blendSource = UNKNOWN_STATE;
+    m_blendDestination = UNKNOWN_STATE;
+    m_bViewportKnown = false;
+    memset(m_viewport, 0, sizeof(m_viewport));
+    m_uniforms.clear();
+}
+
+/***********************************************************
+ *  UseProgram()
+ *
+ *  This method is used for making a shader program current
+ *  when it is not already.
+ ***********************************************************/
+void GLStateCache::UseProgram(GLuint programID)
+{
+    if (CountCall(programID != m_programID))
+    {
+        glUseProgram(programID);
+        m_programID = programID;
+    }
+}
+
+/***********************************************************
+ *  BindVertexArray()
+ *
+ *  This method is used for binding a vertex array object
+ *  when it is not already bound.
+ ***********************************************************/
+void GLStateCache::BindVertexArray(GLuint vertexArray)
+{
+    if (CountCall(vertexArray != m_vertexArray))
+    {
+        glBindVertexArray(vertexArray);
+        m_vertexArray = vertexArray;
+    }
+}
+
+/***********************************************************
+ *  ActiveTexture()
+ *
+ *  This method is used for selecting the texture unit the
+ *  next texture binds go to.
+ ***********************************************************/
+void GLStateCache::ActiveTexture(GLuint textureUnit)
+{
+    if (CountCall(textureUnit != m_activeTexture))
+    {
+        glActiveTexture(GL_TEXTURE0 + textureUnit);
+        m_activeTexture = textureUnit;
+    }
+}
+
+/***********************************************************
+ *  BindTexture()
+ *
+ *  This method is used for binding a texture to the selected
+ *  texture unit when it is not already bound there.  While
+ *  the selected unit is unknown the bind goes through, and
+ *  the textures of every unit are forgotten, since any one of
+ *  them may have changed.
+ ***********************************************************/
+void GLStateCache::BindTexture(GLenum target, GLuint texture)
+{
+    if (UNKNOWN_STATE == m_activeTexture)
+    {
+        CountCall(true);
+        glBindTexture(target, texture);
+        m_textures.clear();
+        return;
+    }
+
+    uint64_t key = MakeStateKey(m_activeTexture, target);
+    std::unordered_map<uint64_t, GLuint>::iterator bound = m_textures.find(key);
+
+    if (CountCall((bound == m_textures.end()) || (bound->second != texture)))
+    {
+        glBindTexture(target, texture);
+        m_textures[key] = texture;
+    }
+}
+
+/***********************************************************
+ *  BindTexture()
+ *
+ *  This method is used for binding a texture to a texture
+ *  unit, which only selects the unit when the texture is not
+ *  already bound to it.
+ ***********************************************************/
+void GLStateCache::BindTexture(GLuint textureUnit, GLenum target, GLuint texture)
+{
+    std::unordered_map<uint64_t, GLuint>::iterator bound = m_textures.find(MakeStateKey(textureUnit, target));
+
+    if ((bound != m_textures.end()) && (bound->second == texture))
+    {
+        CountCall(false);
+        return;
+    }
+
+    ActiveTexture(textureUnit);
+    BindTexture(target, texture);
+}
+
+/***********************************************************
+ *  Enable()
+ *
+ *  This method is used for enabling a capability when it is
+ *  not already enabled.
+ ***********************************************************/
+void GLStateCache::Enable(GLenum capability)
+{
+    SetCapability(capability, true);
+}
+
+/***********************************************************
+ *  Disable()
+ *
+ *  This method is used for disabling a capability when it
+ *  is not already disabled.
+ ***********************************************************/
+void GLStateCache::Disable(GLenum capability)
+{
+    SetCapability(capability, false);
+}
+
+/***********************************************************
+ *  ClearColor()
+ *
+ *  This method is used for setting the clear color when it
+ *  changes.
+ ***********************************************************/
+void GLStateCache::ClearColor(float red, float green, float blue, float alpha)
+{
+    glm::vec4 color(red, green, blue, alpha);
+
+    if (CountCall((m_bClearColorKnown == false) || (color != m_clearColor)))
+    {
+        glClearColor(red, green, blue, alpha);
+        m_clearColor = color;
+        m_bClearColorKnown = true;
+    }
+}
+
+/***********************************************************
+ *  BlendFunc()
+ *
+ *  This method is used for setting the blend factors when
+ *  they change.
+ ***********************************************************/
+void GLStateCache::BlendFunc(GLenum sourceFactor, GLenum destinationFactor)
+{
+    if (CountCall((sourceFactor != m_blendSource) || (destinationFactor != m_blendDestination)))
+    {
+        glBlendFunc(sourceFactor, destinationFactor);
+        m_blendSource = sourceFactor;
+        m_blendDestination = destinationFactor;
+    }
+}
+
+/***********************************************************
+ *  Viewport()
+ *
+ *  This method is used for setting the viewport when its
+ *  rectangle changes.
+ ***********************************************************/
+void GLStateCache::Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    GLint viewport[4] = { x, y, width, height };
+
+    if (CountCall((m_bViewportKnown == false) || (memcmp(viewport, m_viewport, sizeof(viewport)) != 0)))
+    {
+        glViewport(x, y, width, height);
+        memcpy(m_viewport, viewport, sizeof(viewport));
+        m_bViewportKnown = true;
+    }
+}
+
+/***********************************************************
+ *  SetUniform()
+ *
+ *  These methods are used for writing a uniform of a shader
+ *  program when the value differs from the last one written
+ *  to it.  The program must be the one in use.  A uniform
+ *  that was not found in the program is never written.
+ ***********************************************************/
+void GLStateCache::SetUniform(GLuint programID, GLint location, int value)
+{
+    if (UpdateUniform(programID, location, &value, sizeof(value)))
+    {
+        glUniform1i(location, value);
+    }
+}
+
+void GLStateCache::SetUniform(GLuint programID, GLint location, float value)
+{
+    if (UpdateUniform(programID, location, &value, sizeof(value)))
+    {
+        glUniform1f(location, value);
+    }
+}
+
+void GLStateCache::SetUniform(GLuint programID, GLint location, const glm::vec2& value)
+{
+    if (UpdateUniform(programID, location, glm::value_ptr(value), sizeof(value)))
+    {
+        glUniform2fv(location, 1, glm::value_ptr(value));
+    }
+}
+
+void GLStateCache::SetUniform(GLuint programID, GLint location, const glm::vec3& value)
+{
+    if (UpdateUniform(programID, location, glm::value_ptr(value), sizeof(value)))
+    {
+        glUniform3fv(location, 1, glm::value_ptr(value));
+    }
+}
+
+void GLStateCache::SetUniform(GLuint programID, GLint location, const glm::vec4& value)
+{
+    if (UpdateUniform(programID, location, glm::value_ptr(value), sizeof(value)))
+    {
+        glUniform4fv(location, 1, glm::value_ptr(value));
+    }
+}
+
+void GLStateCache::SetUniform(GLuint programID, GLint location, const glm::mat4& value)
+{
+    if (UpdateUniform(programID, location, glm::value_ptr(value), sizeof(value)))
+    {
+        glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+    }
+}
+
+/***********************************************************
+ *  DeleteTexture()
+ *
+ *  This method is used for deleting a texture.  OpenGL binds
+ *  zero in place of a deleted texture, which the shadowed
+ *  binds follow, so a new texture that gets the same name
+ *  is never taken as already bound.
+ ***********************************************************/
+void GLStateCache::DeleteTexture(GLuint texture)
+{
+    if (0 == texture)
+    {
+        return;
+    }
+
+    glDeleteTextures(1, &texture);
+    for (std::unordered_map<uint64_t, GLuint>::iterator bound = m_textures.begin(); bound != m_textures.end(); ++bound)
+    {
+        if (bound->second == texture)
+        {
+            bound->second = 0;
+        }
+    }
+}
+
+/***********************************************************
+ *  DeleteVertexArray()
+ *
+ *  This method is used for deleting a vertex array object,
+ *  which leaves zero bound when it was the bound one.
+ ***********************************************************/
+void GLStateCache::DeleteVertexArray(GLuint vertexArray)
+{
+    if (0 == vertexArray)
+    {
+        return;
+    }
+
+    glDeleteVertexArrays(1, &vertexArray);
+    if (vertexArray == m_vertexArray)
+    {
+        m_vertexArray = 0;
+    }
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method returns the number of state calls that were
+ *  passed to OpenGL and dropped since the last reset.
+ ***********************************************************/
+GLStateCache::GL_STATE_STATS GLStateCache::GetStats() const
+{
+    return(m_stats);
+}
+
+/***********************************************************
+ *  ResetStats()
+ *
+ *  This method is used for starting the call counts over.
+ ***********************************************************/
+void GLStateCache::ResetStats()
+{
+    m_stats.callsIssued = 0;
+    m_stats.callsFiltered = 0;
+}
+
+/***********************************************************
+ *  SetCapability()
+ *
+ *  This method is used for enabling or disabling a capability
+ *  when its shadowed state differs.
+ ***********************************************************/
+void GLStateCache::SetCapability(GLenum capability, bool bEnabled)
+{
+    std::unordered_map<GLenum, bool>::iterator state = m_capabilities.find(capability);
+
+    if (CountCall((state == m_capabilities.end()) || (state->second != bEnabled)))
+    {
+        if (bEnabled)
+        {
+            glEnable(capability);
+        }
+        else
+        {
+            glDisable(capability);
+        }
+        m_capabilities[capability] = bEnabled;
+    }
+}
+
+/***********************************************************
+ *  UpdateUniform()
+ *
+ *  This method is used for comparing a uniform value with the
+ *  last value written to the uniform and storing it.  Returns
+ *  false when the value would not change the uniform.
+ ***********************************************************/
+bool GLStateCache::UpdateUniform(GLuint programID, GLint location, const void* pValue, size_t size)
+{
+    if (-1 == location)
+    {
+        return(CountCall(false));
+    }
+
+    UNIFORM_VALUE& uniform = m_uniforms[MakeStateKey(programID, (uint32_t)location)];
+    bool bChanged = (uniform.size != size) || (memcmp(uniform.data, pValue, size) != 0);
+
+    if (bChanged)
+    {
+        memcpy(uniform.data, pValue, size);
+        uniform.size = size;
+    }
+
+    return(CountCall(bChanged));
+}
+
+/***********************************************************
+ *  CountCall()
+ *
+ *  This method is used for counting a state call as issued
+ *  when it changes the state, or as filtered when it does
+ *  not.  Returns whether the call must be issued.
+ ***********************************************************/
+bool GLStateCache::CountCall(bool bChanged)
+{
+    if (bChanged)
+    {
+        m_stats.callsIssued++;
+    }
+    else
+    {
+        m_stats.callsFiltered++;
+    }
+
+    return(bChanged);
+}
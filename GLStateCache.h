@@ -0,0 +1,126 @@
+///////////////////////////////////////////////////////////////////////////////
+// glstatecache.h
+// ============
+// shadow copy of the OpenGL state that drops the redundant state changes
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+/***********************************************************
+ *  GLStateCache
+ *
+ *  This class sits between the managers and OpenGL for the
+ *  state that is set again and again - the shader program in
+ *  use, the textures bound to the texture units, the vertex
+ *  array object, the enabled capabilities, the clear color,
+ *  the blend function, the viewport and the uniform values.
+ *  It keeps a copy of what was last set on the context, and
+ *  a call that would not change anything is dropped before
+ *  it reaches the driver.
+ *
+ *  A state that was never set through the cache is unknown,
+ *  so its first call always goes through.  State changed
+ *  around the cache must be forgotten with Invalidate().
+ *  There is one cache for the one context, and it must only
+ *  be used by the thread the context is current on.
+ ***********************************************************/
+class GLStateCache
+{
+public:
+    // constructor
+    GLStateCache();
+
+    // number of state calls passed to OpenGL and dropped
+    struct GL_STATE_STATS
+    {
+        uint64_t callsIssued;
+        uint64_t callsFiltered;
+    };
+
+    // forget all of the state, which is unknown afterwards
+    void Invalidate();
+
+    // make a shader program current
+    void UseProgram(GLuint programID);
+    // bind a vertex array object
+    void BindVertexArray(GLuint vertexArray);
+    // select the texture unit for the texture binds
+    void ActiveTexture(GLuint textureUnit);
+    // bind a texture to the selected texture unit
+    void BindTexture(GLenum target, GLuint texture);
+    // bind a texture to a texture unit
+    void BindTexture(GLuint textureUnit, GLenum target, GLuint texture);
+    // enable or disable a capability such as GL_DEPTH_TEST
+    void Enable(GLenum capability);
+    void Disable(GLenum capability);
+    // set the color the color buffer is cleared with
+    void ClearColor(float red, float green, float blue, float alpha);
+    // set the blend factors of the source and destination
+    void BlendFunc(GLenum sourceFactor, GLenum destinationFactor);
+    // set the viewport rectangle
+    void Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+    // write a uniform of a program, which must be in use
+    void SetUniform(GLuint programID, GLint location, int value);
+    void SetUniform(GLuint programID, GLint location, float value);
+    void SetUniform(GLuint programID, GLint location, const glm::vec2& value);
+    void SetUniform(GLuint programID, GLint location, const glm::vec3& value);
+    void SetUniform(GLuint programID, GLint location, const glm::vec4& value);
+    void SetUniform(GLuint programID, GLint location, const glm::mat4& value);
+
+    // delete objects that may be bound, which unbinds them
+    void DeleteTexture(GLuint texture);
+    void DeleteVertexArray(GLuint vertexArray);
+
+    // calls issued and filtered since the last reset
+    GL_STATE_STATS GetStats() const;
+    void ResetStats();
+
+private:
+    // shadowed name of a state that was never set
+    static const GLuint UNKNOWN_STATE = 0xFFFFFFFF;
+
+    // last value written to one uniform
+    struct UNIFORM_VALUE
+    {
+        size_t size;
+        unsigned char data[sizeof(glm::mat4)];
+    };
+
+    GLuint m_programID;
+    GLuint m_vertexArray;
+    GLuint m_activeTexture;
+    // bound textures by texture unit and target
+    std::unordered_map<uint64_t, GLuint> m_textures;
+    // enabled state by capability
+    std::unordered_map<GLenum, bool> m_capabilities;
+    bool m_bClearColorKnown;
+    glm::vec4 m_clearColor;
+    GLenum m_blendSource;
+    GLenum m_blendDestination;
+    bool m_bViewportKnown;
+    GLint m_viewport[4];
+    // uniform values by program and location
+    std::unordered_map<uint64_t, UNIFORM_VALUE> m_uniforms;
+    GL_STATE_STATS m_stats;
+
+    // enable or disable a capability when it changes
+    void SetCapability(GLenum capability, bool bEnabled);
+    // store a uniform value, returns false when it is the
+    // value the uniform already has
+    bool UpdateUniform(GLuint programID, GLint location, const void* pValue, size_t size);
+    // count a call as issued or filtered
+    bool CountCall(bool bChanged);
+};
+
+// the state cache of the OpenGL context
+GLStateCache& GetGLStateCache();
@@ -0,0 +1,228 @@
+///////////////////////////////////////////////////////////////////////////////
+// inputrecorder.cpp
+// ============
+// record the camera input to a file and replay it at a fixed timestep
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "InputRecorder.h"
+
+#include <fstream>
+#include <iostream>
+
+/***********************************************************
+ *  InputRecorder()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+InputRecorder::InputRecorder()
+{
+    m_mode = MODE_OFF;
+    m_startTime = 0.0;
+    m_replayStep = 0;
+    m_nextEvent = 0;
+}
+
+/***********************************************************
+ *  StartRecording()
+ *
+ *  This method is used for starting a new recording.  The
+ *  times of the events are kept from the passed in clock time.
+ ***********************************************************/
+void InputRecorder::StartRecording(double clockTime)
+{
+    m_mode = MODE_RECORD;
+    m_events.clear();
+    m_startTime = clockTime;
+}
+
+/***********************************************************
+ *  StartReplay()
+ *
+ *  This method is used for loading the events of a recording
+ *  file and starting to replay them from the first step.  A
+ *  file that is not a recording of this version is rejected.
+ ***********************************************************/
+bool InputRecorder::StartReplay(const char* filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    RECORDING_HEADER header;
+
+    if (!file.read((char*)&header, sizeof(header)) ||
+        (header.magic != RECORDING_MAGIC) ||
+        (header.version != RECORDING_VERSION))
+    {
+        std::cout << "Not a valid input recording:" << filename << std::endl;
+        return(false);
+    }
+
+    std::vector<INPUT_EVENT> events(header.eventCount);
+    if ((header.eventCount > 0) &&
+        !file.read((char*)events.data(), (std::streamsize)(events.size() * sizeof(INPUT_EVENT))))
+    {
+        std::cout << "Input recording is truncated:" << filename << std::endl;
+        return(false);
+    }
+
+    m_mode = MODE_REPLAY;
+    m_events.swap(events);
+    m_replayStep = 0;
+    m_nextEvent = 0;
+
+    return(true);
+}
+
+/***********************************************************
+ *  SaveRecording()
+ *
+ *  This method is used for writing the recorded events to a
+ *  file, after a header with their number.
+ ***********************************************************/
+bool InputRecorder::SaveRecording(const char* filename) const
+{
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    RECORDING_HEADER header;
+
+    header.magic = RECORDING_MAGIC;
+    header.version = RECORDING_VERSION;
+    header.eventCount = (uint32_t)m_events.size();
+    header.reserved = 0;
+
+    file.write((const char*)&header, sizeof(header));
+    if (!m_events.empty())
+    {
+        file.write((const char*)m_events.data(), (std::streamsize)(m_events.size() * sizeof(INPUT_EVENT)));
+    }
+
+    return(file.good());
+}
+
+/***********************************************************
+ *  GetMode()
+ *
+ *  This method returns whether the recorder is recording,
+ *  replaying or doing neither.
+ ***********************************************************/
+InputRecorder::RECORDER_MODE InputRecorder::GetMode() const
+{
+    return(m_mode);
+}
+
+/***********************************************************
+ *  RecordKey()
+ *
+ *  This method is used for keeping a key press or release.
+ ***********************************************************/
+void InputRecorder::RecordKey(double clockTime, int key, int action)
+{
+    INPUT_EVENT event;
+
+    event.type = EVENT_KEY;
+    event.action = (uint8_t)action;
+    event.key = (uint16_t)key;
+    event.x = 0.0f;
+    event.y = 0.0f;
+    AddEvent(clockTime, event);
+}
+
+/***********************************************************
+ *  RecordCursor()
+ *
+ *  This method is used for keeping a new cursor position.
+ ***********************************************************/
+void InputRecorder::RecordCursor(double clockTime, double x, double y)
+{
+    INPUT_EVENT event;
+
+    event.type = EVENT_CURSOR;
+    event.action = 0;
+    event.key = 0;
+    event.x = (float)x;
+    event.y = (float)y;
+    AddEvent(clockTime, event);
+}
+
+/***********************************************************
+ *  RecordScroll()
+ *
+ *  This method is used for keeping a scroll of the mouse
+ *  wheel.
+ ***********************************************************/
+void InputRecorder::RecordScroll(double clockTime, double xOffset, double yOffset)
+{
+    INPUT_EVENT event;
+
+    event.type = EVENT_SCROLL;
+    event.action = 0;
+    event.key = 0;
+    event.x = (float)xOffset;
+    event.y = (float)yOffset;
+    AddEvent(clockTime, event);
+}
+
+/***********************************************************
+ *  AdvanceReplay()
+ *
+ *  This method is used for advancing the simulated time of
+ *  the replay by one step and returning the events up to the
+ *  new time, in the order they were recorded.  The time is
+ *  counted in whole steps, so no rounding builds up.
+ ***********************************************************/
+void InputRecorder::AdvanceReplay(std::vector<INPUT_EVENT>& events)
+{
+    events.clear();
+    if (m_mode != MODE_REPLAY)
+    {
+        return;
+    }
+
+    m_replayStep++;
+    uint64_t replayTime = (m_replayStep * 1000000) / REPLAY_RATE;
+
+    while ((m_nextEvent < m_events.size()) && (m_events[m_nextEvent].time <= replayTime))
+    {
+        events.push_back(m_events[m_nextEvent]);
+        m_nextEvent++;
+    }
+}
+
+/***********************************************************
+ *  IsReplayFinished()
+ *
+ *  This method returns whether every event of the replay has
+ *  been returned.
+ ***********************************************************/
+bool InputRecorder::IsReplayFinished() const
+{
+    return((m_mode == MODE_REPLAY) && (m_nextEvent >= m_events.size()));
+}
+
+/***********************************************************
+ *  GetEventCount()
+ *
+ *  This method returns the number of recorded or loaded
+ *  events.
+ ***********************************************************/
+size_t InputRecorder::GetEventCount() const
+{
+    return(m_events.size());
+}
+
+/***********************************************************
+ *  AddEvent()
+ *
+ *  This method is used for keeping an event while recording,
+ *  with its time in microseconds since the recording started.
+ ***********************************************************/
+void InputRecorder::AddEvent(double clockTime, INPUT_EVENT& event)
+{
+    if (m_mode != MODE_RECORD)
+    {
+        return;
+    }
+
+    double elapsed = (clockTime - m_startTime) * 1000000.0;
+    event.time = (elapsed > 0.0) ? (uint64_t)elapsed : 0;
+    event.reserved = 0;
+    m_events.push_back(event);
+}
@@ -0,0 +1,118 @@
+///////////////////////////////////////////////////////////////////////////////
+// inputrecorder.h
+// ============
+// record the camera input to a file and replay it at a fixed timestep
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  InputRecorder
+ *
+ *  This class keeps the stream of keyboard, mouse movement
+ *  and mouse scroll events that drive the camera, with the
+ *  time of every event since the recording started.  A
+ *  recording is saved as a small binary file of fixed size
+ *  events, written in the byte order of the machine.
+ *
+ *  A replay hands the events back by simulated time instead
+ *  of the clock.  Every frame of a replay advances the time
+ *  by the same fixed step, so the same recording always moves
+ *  the camera the same way in the same frames, no matter how
+ *  long the frames take to render.
+ ***********************************************************/
+class InputRecorder
+{
+public:
+    // constructor
+    InputRecorder();
+
+    // identifies a recording file, "SREC" in the file
+    static const uint32_t RECORDING_MAGIC = 0x43455253;
+    // changed whenever the layout of the file changes
+    static const uint32_t RECORDING_VERSION = 1;
+    // replayed frames in one simulated second
+    static const uint32_t REPLAY_RATE = 60;
+
+    // what the recorder is doing
+    enum RECORDER_MODE
+    {
+        MODE_OFF,
+        MODE_RECORD,
+        MODE_REPLAY
+    };
+
+    // kinds of input events
+    enum EVENT_TYPE
+    {
+        EVENT_KEY = 1,
+        EVENT_CURSOR = 2,
+        EVENT_SCROLL = 3
+    };
+
+    // one input event as it is stored in the file
+    struct INPUT_EVENT
+    {
+        // microseconds since the recording started, in 64 bits
+        // so a long recording never wraps around
+        uint64_t time;
+        uint8_t type;
+        // GLFW action of a key event
+        uint8_t action;
+        // GLFW key of a key event
+        uint16_t key;
+        // cursor position, or the scroll offsets
+        float x;
+        float y;
+        // always zero, fills the end of the event to 24 bytes
+        uint32_t reserved;
+    };
+
+    // start of the recording file
+    struct RECORDING_HEADER
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t eventCount;
+        uint32_t reserved;
+    };
+
+    // start recording, with the clock time in seconds
+    void StartRecording(double clockTime);
+    // load a recording and start replaying it
+    bool StartReplay(const char* filename);
+    // write the recorded events to a file
+    bool SaveRecording(const char* filename) const;
+    RECORDER_MODE GetMode() const;
+
+    // keep an input event at the clock time in seconds
+    void RecordKey(double clockTime, int key, int action);
+    void RecordCursor(double clockTime, double x, double y);
+    void RecordScroll(double clockTime, double xOffset, double yOffset);
+
+    // advance the replay by one fixed step and return the
+    // events of that step
+    void AdvanceReplay(std::vector<INPUT_EVENT>& events);
+    // set once all of the replayed events have been returned
+    bool IsReplayFinished() const;
+
+    // number of recorded or loaded events
+    size_t GetEventCount() const;
+
+private:
+    RECORDER_MODE m_mode;
+    std::vector<INPUT_EVENT> m_events;
+    // clock time of the start of the recording
+    double m_startTime;
+    // simulated time and next event of the replay
+    uint64_t m_replayStep;
+    size_t m_nextEvent;
+
+    // keep an event at the clock time in seconds
+    void AddEvent(double clockTime, INPUT_EVENT& event);
+};
@@ -0,0 +1,275 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.cpp
+// ============
+// work stealing threads that split the CPU work of a frame
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "JobSystem.h"
+
+// declaration of the global variables and defines
+namespace
+{
+    // system and queue of the running thread, the threads that
+    // are not part of a system use its first queue
+    thread_local const JobSystem* t_pJobSystem = NULL;
+    thread_local size_t t_queueIndex = 0;
+}
+
+/***********************************************************
+ *  JobSystem()
+ *
+ *  The constructor for the class.  The thread count includes
+ *  the thread that starts a loop, which runs jobs while it
+ *  waits, so one thread less is started.  Without a thread
+ *  count there is one thread for every core.
+ ***********************************************************/
+JobSystem::JobSystem(unsigned int threadCount)
+{
+    m_queuedJobs = 0;
+    m_sleepingThreads = 0;
+    m_bStopping = false;
+
+    if (threadCount == 0)
+    {
+        unsigned int cores = std::thread::hardware_concurrency();
+        threadCount = (cores > 1) ? cores : 1;
+    }
+
+    // the queues are all made before any thread can steal
+    for (unsigned int i = 0; i < threadCount; i++)
+    {
+        m_queues.push_back(std::unique_ptr<JOB_QUEUE>(new JOB_QUEUE()));
+    }
+    for (unsigned int i = 1; i < threadCount; i++)
+    {
+        m_threads.push_back(std::thread(&JobSystem::WorkerLoop, this, (size_t)i));
+    }
+}
+
+/***********************************************************
+ *  ~JobSystem()
+ *
+ *  The destructor for the class.  No loop can be running,
+ *  so the queues are empty when the threads exit.
+ ***********************************************************/
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_bStopping = true;
+    }
+    m_jobQueued.notify_all();
+
+    for (size_t i = 0; i < m_threads.size(); i++)
+    {
+        m_threads[i].join();
+    }
+}
+
+/***********************************************************
+ *  ParallelFor()
+ *
+ *  This method is used for running a body over a range of
+ *  indices on all of the threads.  The whole range starts as
+ *  one job of the calling thread, which splits it while the
+ *  other threads steal the halves, and the calling thread
+ *  keeps running jobs until every index is done.  A range no
+ *  larger than the grain size is run directly.
+ ***********************************************************/
+void JobSystem::ParallelFor(size_t count, size_t grainSize, const RANGE_FUNCTION& body)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    if (grainSize == 0)
+    {
+        grainSize = 1;
+    }
+    if ((count <= grainSize) || m_threads.empty())
+    {
+        body(0, count);
+        return;
+    }
+
+    std::atomic<size_t> remaining(count);
+    size_t queueIndex = GetQueueIndex();
+    JOB job;
+
+    job.pBody = &body;
+    job.first = 0;
+    job.end = count;
+    job.grainSize = grainSize;
+    job.pRemaining = &remaining;
+    RunJob(queueIndex, job);
+
+    // help with the stolen pieces, which can also be pieces of
+    // other loops, until the last piece of this loop is done
+    while (remaining.load() > 0)
+    {
+        if (TakeJob(queueIndex, job))
+        {
+            RunJob(queueIndex, job);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+/***********************************************************
+ *  GetThreadCount()
+ *
+ *  This method returns the number of threads that run the
+ *  jobs of a loop, which includes the thread that starts it.
+ ***********************************************************/
+unsigned int JobSystem::GetThreadCount() const
+{
+    return((unsigned int)m_threads.size() + 1);
+}
+
+/***********************************************************
+ *  PushJob()
+ *
+ *  This method is used for queueing a job at the back of a
+ *  queue.  A sleeping thread is woken through the mutex it
+ *  checks the job count under, so a job queued while it goes
+ *  to sleep is never missed.
+ ***********************************************************/
+void JobSystem::PushJob(size_t queueIndex, const JOB& job)
+{
+    JOB_QUEUE& queue = *m_queues[queueIndex];
+
+    // counted first, so the count is never below the jobs
+    m_queuedJobs++;
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(job);
+    }
+
+    if (m_sleepingThreads.load() > 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+        }
+        m_jobQueued.notify_one();
+    }
+}
+
+/***********************************************************
+ *  TakeJob()
+ *
+ *  This method is used for taking the newest job of the queue
+ *  of a thread, and otherwise stealing the oldest job of the
+ *  other queues, starting after its own queue so the threads
+ *  do not all steal from the same one.  Returns false when
+ *  every queue is empty.
+ ***********************************************************/
+bool JobSystem::TakeJob(size_t queueIndex, JOB& job)
+{
+    if (m_queuedJobs.load() == 0)
+    {
+        return(false);
+    }
+
+    {
+        JOB_QUEUE& queue = *m_queues[queueIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (queue.jobs.empty() == false)
+        {
+            job = queue.jobs.back();
+            queue.jobs.pop_back();
+            m_queuedJobs--;
+            return(true);
+        }
+    }
+
+    for (size_t i = 1; i < m_queues.size(); i++)
+    {
+        JOB_QUEUE& queue = *m_queues[(queueIndex + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (queue.jobs.empty() == false)
+        {
+            job = queue.jobs.front();
+            queue.jobs.pop_front();
+            m_queuedJobs--;
+            return(true);
+        }
+    }
+
+    return(false);
+}
+
+/***********************************************************
+ *  RunJob()
+ *
+ *  This method is used for running a job.  The upper half of
+ *  the job is queued for as long as the job is larger than
+ *  the grain size, then the lower piece that is left is run
+ *  and counted as done.
+ ***********************************************************/
+void JobSystem::RunJob(size_t queueIndex, JOB job)
+{
+    while (job.end - job.first > job.grainSize)
+    {
+        JOB upperHalf = job;
+        size_t middle = job.first + (job.end - job.first) / 2;
+
+        upperHalf.first = middle;
+        job.end = middle;
+        PushJob(queueIndex, upperHalf);
+    }
+
+    (*job.pBody)(job.first, job.end);
+    job.pRemaining->fetch_sub(job.end - job.first);
+}
+
+/***********************************************************
+ *  GetQueueIndex()
+ *
+ *  This method returns the queue of the calling thread, its
+ *  own queue for a thread of the system and the shared first
+ *  queue for any other thread.
+ ***********************************************************/
+size_t JobSystem::GetQueueIndex() const
+{
+    return((t_pJobSystem == this) ? t_queueIndex : 0);
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is run by every thread of the system.  It runs
+ *  jobs while there are any and sleeps when every queue is
+ *  empty, until the system stops.
+ ***********************************************************/
+void JobSystem::WorkerLoop(size_t queueIndex)
+{
+    t_pJobSystem = this;
+    t_queueIndex = queueIndex;
+
+    for (;;)
+    {
+        JOB job;
+
+        if (TakeJob(queueIndex, job))
+        {
+            RunJob(queueIndex, job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+
+        m_sleepingThreads++;
+        m_jobQueued.wait(lock, [this]() { return(m_bStopping.load() || (m_queuedJobs.load() > 0)); });
+        m_sleepingThreads--;
+        if (m_bStopping.load())
+        {
+            return;
+        }
+    }
+}
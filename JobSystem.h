@@ -0,0 +1,105 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.h
+// ============
+// work stealing threads that split the CPU work of a frame
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  JobSystem
+ *
+ *  This class keeps a fixed number of threads that share the
+ *  CPU stages of a frame.  Every thread has its own queue of
+ *  jobs.  A thread takes the newest job of its own queue, which
+ *  is the one whose data is still in its cache, and when its
+ *  queue is empty it steals the oldest job of another queue,
+ *  which is the largest piece of work left there.
+ *
+ *  The work is given as a parallel loop over a range of
+ *  indices.  A job that is larger than the grain size splits
+ *  off its upper half into the queue of its thread before it
+ *  runs, so an idle thread always finds a large piece to
+ *  steal and the range spreads over the threads in a few
+ *  steps.  The thread that starts a loop runs jobs too, until
+ *  the whole range is done.  The jobs must not make OpenGL
+ *  calls, which stay on the thread of the context.
+ ***********************************************************/
+class JobSystem
+{
+public:
+    // constructor, the thread count includes the calling
+    // thread and zero threads uses one for each core
+    JobSystem(unsigned int threadCount = 0);
+    // destructor
+    ~JobSystem();
+
+    // body of a parallel loop, run for the indices from the
+    // first index up to but not including the end index
+    typedef std::function<void(size_t first, size_t end)> RANGE_FUNCTION;
+
+    // run a body over the indices from zero to a count, in
+    // pieces of at least the grain size, and return when all
+    // of the pieces are done
+    void ParallelFor(size_t count, size_t grainSize, const RANGE_FUNCTION& body);
+    // number of threads that run jobs, with the calling thread
+    unsigned int GetThreadCount() const;
+
+private:
+    // one piece of a parallel loop
+    struct JOB
+    {
+        const RANGE_FUNCTION* pBody;
+        size_t first;
+        size_t end;
+        size_t grainSize;
+        // indices of the loop that are not done yet
+        std::atomic<size_t>* pRemaining;
+    };
+
+    // the jobs of one thread, the owner uses the back and the
+    // other threads steal from the front
+    struct JOB_QUEUE
+    {
+        std::mutex mutex;
+        std::deque<JOB> jobs;
+    };
+
+    std::vector<std::thread> m_threads;
+    // one queue for each thread, the first one is shared by the
+    // threads that are not part of the system
+    std::vector<std::unique_ptr<JOB_QUEUE>> m_queues;
+    // jobs in all of the queues
+    std::atomic<size_t> m_queuedJobs;
+    // threads waiting for a job to be queued
+    std::atomic<unsigned int> m_sleepingThreads;
+    // set when the threads must exit
+    std::atomic<bool> m_bStopping;
+
+    std::mutex m_sleepMutex;
+    // signaled when a job is queued or the system stops
+    std::condition_variable m_jobQueued;
+
+    // queue a job on a queue and wake a sleeping thread
+    void PushJob(size_t queueIndex, const JOB& job);
+    // take the newest job of a queue, or the oldest job of any
+    // other queue
+    bool TakeJob(size_t queueIndex, JOB& job);
+    // split a job down to its grain size and run it
+    void RunJob(size_t queueIndex, JOB job);
+    // queue of the calling thread
+    size_t GetQueueIndex() const;
+    // take and run jobs until the system stops
+    void WorkerLoop(size_t queueIndex);
+};
@@ -0,0 +1,370 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightclusters.cpp
+// ============
+// assign scene lights to view-space clusters for forward+ shading
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LightClusters.h"
+
+#include <cmath>
+#include <algorithm>
+
+// declaration of the global variables and defines
+namespace
+{
+    const char* g_ClusterBlockName = "ClusterBlock";
+
+    // storage buffer binding points used by the fragment shader
+    const GLuint LIGHT_BUFFER_BINDING = 0;
+    const GLuint CLUSTER_BUFFER_BINDING = 1;
+    const GLuint LIGHT_INDEX_BUFFER_BINDING = 2;
+    // uniform buffer binding point of the cluster settings,
+    // binding point 0 is used by the camera block
+    const GLuint CLUSTER_BLOCK_BINDING = 1;
+}
+
+/***********************************************************
+ *  LightClusters()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LightClusters::LightClusters()
+{
+    m_lightIndexCapacity = sizeof(GLuint);
+    m_bLightsDirty = true;
+    m_clusterRecords.resize(CLUSTER_COUNT * 2);
+
+    glGenBuffers(1, &m_lightSSBO);
+    glGenBuffers(1, &m_clusterSSBO);
+    glGenBuffers(1, &m_lightIndexSSBO);
+    glGenBuffers(1, &m_clusterUBO);
+
+    // one offset and one count for every cluster
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_clusterSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, CLUSTER_COUNT * 2 * sizeof(GLuint), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightIndexSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, m_lightIndexCapacity, NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, m_clusterUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(CLUSTER_BLOCK), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // the buffers stay bound to their binding points for the
+    // lifetime of the object
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_BUFFER_BINDING, m_clusterSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_INDEX_BUFFER_BINDING, m_lightIndexSSBO);
+    glBindBufferBase(GL_UNIFORM_BUFFER, CLUSTER_BLOCK_BINDING, m_clusterUBO);
+}
+
+/***********************************************************
+ *  ~LightClusters()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+LightClusters::~LightClusters()
+{
+    glDeleteBuffers(1, &m_lightSSBO);
+    glDeleteBuffers(1, &m_clusterSSBO);
+    glDeleteBuffers(1, &m_lightIndexSSBO);
+    glDeleteBuffers(1, &m_clusterUBO);
+}
+
+/***********************************************************
+ *  AddLight()
+ *
+ *  This method is used for adding a light source to the
+ *  scene lights.  There is no limit on the number of lights.
+ ***********************************************************/
+void LightClusters::AddLight(const LIGHT_SOURCE& light)
+{
+    GPU_LIGHT gpuLight;
+
+    gpuLight.positionRange = glm::vec4(light.position, light.range);
+    gpuLight.ambientFocal = glm::vec4(light.ambientColor, light.focalStrength);
+    gpuLight.diffuseIntensity = glm::vec4(light.diffuseColor, light.specularIntensity);
+    gpuLight.specularColor = glm::vec4(light.specularColor, 0.0f);
+
+    m_lights.push_back(gpuLight);
+    m_bLightsDirty = true;
+}
+
+/***********************************************************
+ *  ClearLights()
+ *
+ *  This method is used for removing all of the scene lights.
+ ***********************************************************/
+void LightClusters::ClearLights()
+{
+    m_lights.clear();
+    m_bLightsDirty = true;
+}
+
+/***********************************************************
+ *  GetLightCount()
+ *
+ *  This method returns the number of scene lights.
+ ***********************************************************/
+int LightClusters::GetLightCount() const
+{
+    return((int)m_lights.size());
+}
+
+/***********************************************************
+ *  BindClusterBlock()
+ *
+ *  This method is used for attaching the ClusterBlock uniform
+ *  block of the passed in shader program to the cluster block
+ *  binding point.
+ ***********************************************************/
+void LightClusters::BindClusterBlock(GLuint programID)
+{
+    GLuint blockIndex = glGetUniformBlockIndex(programID, g_ClusterBlockName);
+
+    if (GL_INVALID_INDEX != blockIndex)
+    {
+        glUniformBlockBinding(programID, blockIndex, CLUSTER_BLOCK_BINDING);
+    }
+}
+
+/***********************************************************
+ *  FindClusterRange()
+ *
+ *  This method is used for finding the block of clusters
+ *  that the sphere of influence of a light overlaps.  The
+ *  view-space box around the sphere is projected to find the
+ *  screen tiles, and its depth span gives the depth slices.
+ *  Returns false when the light is outside of the view.
+ ***********************************************************/
+bool LightClusters::FindClusterRange(
+    const GPU_LIGHT& light,
+    const glm::mat4& view,
+    const glm::mat4& projection,
+    float zNear,
+    float zFar,
+    float sliceScale,
+    float sliceBias,
+    CLUSTER_RANGE& range) const
+{
+    glm::vec4 center = view * glm::vec4(glm::vec3(light.positionRange), 1.0f);
+    float radius = light.positionRange.w;
+
+    // view space looks down the negative z axis
+    float minDepth = std::max(-center.z - radius, zNear);
+    float maxDepth = std::min(-center.z + radius, zFar);
+    if (minDepth > maxDepth)
+    {
+        return(false);
+    }
+
+    // project the corners of the view-space box around the
+    // light, clamped to the depth span inside the view
+    float minX = 1.0f;
+    float maxX = -1.0f;
+    float minY = 1.0f;
+    float maxY = -1.0f;
+    for (int corner = 0; corner < 8; corner++)
+    {
+        glm::vec4 viewPoint(
+            center.x + ((corner & 1) ? radius : -radius),
+            center.y + ((corner & 2) ? radius : -radius),
+            (corner & 4) ? -minDepth : -maxDepth,
+            1.0f);
+        glm::vec4 clipPoint = projection * viewPoint;
+        float ndcX = clipPoint.x / clipPoint.w;
+        float ndcY = clipPoint.y / clipPoint.w;
+
+        if (corner == 0)
+        {
+            minX = maxX = ndcX;
+            minY = maxY = ndcY;
+        }
+        else
+        {
+            minX = std::min(minX, ndcX);
+            maxX = std::max(maxX, ndcX);
+            minY = std::min(minY, ndcY);
+            maxY = std::max(maxY, ndcY);
+        }
+    }
+
+    if ((maxX < -1.0f) || (minX > 1.0f) || (maxY < -1.0f) || (minY > 1.0f))
+    {
+        return(false);
+    }
+
+    // convert from normalized device coordinates to tiles
+    range.minX = std::max((int)std::floor((minX * 0.5f + 0.5f) * GRID_X), 0);
+    range.maxX = std::min((int)std::floor((maxX * 0.5f + 0.5f) * GRID_X), GRID_X - 1);
+    range.minY = std::max((int)std::floor((minY * 0.5f + 0.5f) * GRID_Y), 0);
+    range.maxY = std::min((int)std::floor((maxY * 0.5f + 0.5f) * GRID_Y), GRID_Y - 1);
+
+    // the depth slices are spaced exponentially, so a slice
+    // covers the same relative depth near and far away
+    range.minZ = std::max((int)std::floor(std::log(minDepth) * sliceScale + sliceBias), 0);
+    range.maxZ = std::min((int)std::floor(std::log(maxDepth) * sliceScale + sliceBias), GRID_Z - 1);
+
+    return(true);
+}
+
+/***********************************************************
+ *  BuildClusters()
+ *
+ *  This method is used for binning the scene lights into the
+ *  clusters of the passed in view.  The lights are counted
+ *  per cluster first, the counts are turned into offsets,
+ *  and then the light indices are written into one compact
+ *  list that the fragment shader walks for each pixel.
+ ***********************************************************/
+void LightClusters::BuildClusters(
+    const glm::mat4& view,
+    const glm::mat4& projection,
+    int viewportWidth,
+    int viewportHeight)
+{
+    float zNear = 0.0f;
+    float zFar = 0.0f;
+
+    // recover the clip planes from the projection matrix, an
+    // orthographic matrix has no perspective divide term
+    if (projection[2][3] == 0.0f)
+    {
+        zNear = (projection[3][2] + 1.0f) / projection[2][2];
+        zFar = (projection[3][2] - 1.0f) / projection[2][2];
+    }
+    else
+    {
+        zNear = projection[3][2] / (projection[2][2] - 1.0f);
+        zFar = projection[3][2] / (projection[2][2] + 1.0f);
+    }
+
+    float logRatio = std::log(zFar / zNear);
+    float sliceScale = (float)GRID_Z / logRatio;
+    float sliceBias = -(float)GRID_Z * std::log(zNear) / logRatio;
+
+    // upload the light list only when it has changed
+    if (m_bLightsDirty == true)
+    {
+        size_t lightBytes = std::max(m_lights.size() * sizeof(GPU_LIGHT), sizeof(GPU_LIGHT));
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, lightBytes, NULL, GL_STATIC_DRAW);
+        if (m_lights.size() > 0)
+        {
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_lights.size() * sizeof(GPU_LIGHT), m_lights.data());
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_BUFFER_BINDING, m_lightSSBO);
+
+        m_bLightsDirty = false;
+    }
+
+    // first pass - find the clusters of each light and count
+    // the lights in every cluster
+    m_lightRanges.resize(m_lights.size());
+    std::fill(m_clusterRecords.begin(), m_clusterRecords.end(), 0);
+
+    for (size_t i = 0; i < m_lights.size(); i++)
+    {
+        CLUSTER_RANGE& range = m_lightRanges[i];
+
+        if (FindClusterRange(m_lights[i], view, projection, zNear, zFar, sliceScale, sliceBias, range) == false)
+        {
+            // mark the light as outside of every cluster
+            range.minZ = 1;
+            range.maxZ = 0;
+            continue;
+        }
+
+        for (int z = range.minZ; z <= range.maxZ; z++)
+        {
+            for (int y = range.minY; y <= range.maxY; y++)
+            {
+                for (int x = range.minX; x <= range.maxX; x++)
+                {
+                    int cluster = x + GRID_X * (y + GRID_Y * z);
+                    m_clusterRecords[cluster * 2 + 1]++;
+                }
+            }
+        }
+    }
+
+    // turn the counts into offsets into the light index list
+    GLuint totalIndices = 0;
+    for (int cluster = 0; cluster < CLUSTER_COUNT; cluster++)
+    {
+        m_clusterRecords[cluster * 2] = totalIndices;
+        totalIndices += m_clusterRecords[cluster * 2 + 1];
+        // the count is rebuilt while filling in the indices
+        m_clusterRecords[cluster * 2 + 1] = 0;
+    }
+
+    // second pass - write the light indices of every cluster
+    m_lightIndices.resize(totalIndices);
+    for (size_t i = 0; i < m_lights.size(); i++)
+    {
+        const CLUSTER_RANGE& range = m_lightRanges[i];
+
+        for (int z = range.minZ; z <= range.maxZ; z++)
+        {
+            for (int y = range.minY; y <= range.maxY; y++)
+            {
+                for (int x = range.minX; x <= range.maxX; x++)
+                {
+                    int cluster = x + GRID_X * (y + GRID_Y * z);
+                    GLuint slot = m_clusterRecords[cluster * 2] + m_clusterRecords[cluster * 2 + 1];
+
+                    m_lightIndices[slot] = (GLuint)i;
+                    m_clusterRecords[cluster * 2 + 1]++;
+                }
+            }
+        }
+    }
+
+    // the grid settings the fragment shader needs to find
+    // the cluster of a pixel
+    CLUSTER_BLOCK clusterBlock;
+    clusterBlock.gridSize[0] = GRID_X;
+    clusterBlock.gridSize[1] = GRID_Y;
+    clusterBlock.gridSize[2] = GRID_Z;
+    clusterBlock.gridSize[3] = 0;
+    clusterBlock.sliceScale = sliceScale;
+    clusterBlock.sliceBias = sliceBias;
+    clusterBlock.tileWidth = (float)viewportWidth / (float)GRID_X;
+    clusterBlock.tileHeight = (float)viewportHeight / (float)GRID_Y;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, m_clusterUBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CLUSTER_BLOCK), &clusterBlock);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    UploadClusters();
+}
+
+/***********************************************************
+ *  UploadClusters()
+ *
+ *  This method is used for writing the binned cluster records
+ *  and light indices into the storage buffers.  The index
+ *  buffer only grows, so it settles at the largest size seen.
+ ***********************************************************/
+void LightClusters::UploadClusters()
+{
+    size_t indexBytes = m_lightIndices.size() * sizeof(GLuint);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_clusterSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_clusterRecords.size() * sizeof(GLuint), m_clusterRecords.data());
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightIndexSSBO);
+    if (indexBytes > m_lightIndexCapacity)
+    {
+        // grow the buffer with some headroom for the next frames
+        m_lightIndexCapacity = indexBytes + indexBytes / 2;
+        glBufferData(GL_SHADER_STORAGE_BUFFER, m_lightIndexCapacity, NULL, GL_DYNAMIC_DRAW);
+    }
+    if (indexBytes > 0)
+    {
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, indexBytes, m_lightIndices.data());
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
@@ -0,0 +1,129 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightclusters.h
+// ============
+// assign scene lights to view-space clusters for forward+ shading
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  LightClusters
+ *
+ *  This class keeps every scene light in a storage buffer
+ *  and, once per frame, bins the lights into a grid of
+ *  view-space froxel clusters.  The fragment shader looks up
+ *  the cluster of each pixel and only evaluates the lights
+ *  that were binned into it, so shading cost follows the
+ *  local light density instead of the total light count.
+ ***********************************************************/
+class LightClusters
+{
+public:
+    // constructor
+    LightClusters();
+    // destructor
+    ~LightClusters();
+
+    // dimensions of the cluster grid
+    static const int GRID_X = 16;
+    static const int GRID_Y = 9;
+    static const int GRID_Z = 24;
+    static const int CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+
+    struct LIGHT_SOURCE
+    {
+        glm::vec3 position;
+        glm::vec3 ambientColor;
+        glm::vec3 diffuseColor;
+        glm::vec3 specularColor;
+        float focalStrength;
+        float specularIntensity;
+        // distance at which the light fades out completely
+        float range;
+    };
+
+    // add a light source to the scene lights
+    void AddLight(const LIGHT_SOURCE& light);
+    // remove all of the scene lights
+    void ClearLights();
+    // number of scene lights
+    int GetLightCount() const;
+
+    // bin the lights into the clusters of the passed in view
+    void BuildClusters(
+        const glm::mat4& view,
+        const glm::mat4& projection,
+        int viewportWidth,
+        int viewportHeight);
+
+    // attach the cluster uniform block of a shader program to
+    // the cluster block binding point
+    static void BindClusterBlock(GLuint programID);
+
+private:
+    // light layout matching the std430 light storage buffer
+    struct GPU_LIGHT
+    {
+        glm::vec4 positionRange;
+        glm::vec4 ambientFocal;
+        glm::vec4 diffuseIntensity;
+        glm::vec4 specularColor;
+    };
+
+    // cluster grid settings, matching the std140 ClusterBlock
+    struct CLUSTER_BLOCK
+    {
+        GLuint gridSize[4];
+        float sliceScale;
+        float sliceBias;
+        float tileWidth;
+        float tileHeight;
+    };
+
+    // range of clusters a single light overlaps
+    struct CLUSTER_RANGE
+    {
+        int minX, maxX;
+        int minY, maxY;
+        int minZ, maxZ;
+    };
+
+    // storage buffer with every scene light
+    GLuint m_lightSSBO;
+    // storage buffer with the offset and count of each cluster
+    GLuint m_clusterSSBO;
+    // storage buffer with the light indices of all clusters
+    GLuint m_lightIndexSSBO;
+    // uniform buffer with the cluster grid settings
+    GLuint m_clusterUBO;
+    // allocated size of the light index buffer in bytes
+    size_t m_lightIndexCapacity;
+    // the light buffer needs to be uploaded again
+    bool m_bLightsDirty;
+
+    // scene lights in the GPU layout
+    std::vector<GPU_LIGHT> m_lights;
+    // per-frame scratch data, kept to avoid reallocations
+    std::vector<CLUSTER_RANGE> m_lightRanges;
+    std::vector<GLuint> m_clusterRecords;
+    std::vector<GLuint> m_lightIndices;
+
+    // find the clusters touched by one light
+    bool FindClusterRange(
+        const GPU_LIGHT& light,
+        const glm::mat4& view,
+        const glm::mat4& projection,
+        float zNear,
+        float zFar,
+        float sliceScale,
+        float sliceBias,
+        CLUSTER_RANGE& range) const;
+    // upload the binned cluster data to the storage buffers
+    void UploadClusters();
+};
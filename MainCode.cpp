@@ -1,5 +1,8 @@
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <chrono>           // startup timing
+#include <cstdio>           // window title formatting
+#include <cstring>          // command line options
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -13,6 +16,10 @@
 #include "ViewManager.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "AllocationCounter.h"
+#include "FrameProfiler.h"
+#include "InputRecorder.h"
+#include "RenderThread.h"
 #include <stb_image.h>
 
 // Namespace for declaring global variables
@@ -30,12 +37,22 @@ namespace
 	ShaderManager* g_ShaderManager = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+	// frame profiler object for timing the scopes of every frame
+	FrameProfiler* g_FrameProfiler = nullptr;
+	// input recorder object for recording or replaying the camera input
+	InputRecorder* g_InputRecorder = nullptr;
+	// render thread object that owns the OpenGL context while the frames run
+	RenderThread* g_RenderThread = nullptr;
+
+	// seconds between updates of the frame times in the window title
+	const double TITLE_UPDATE_SECONDS = 0.5;
 }
 
 // Function declarations - all functions that are called manually
 // need to be pre-declared at the beginning of the source code.
 bool InitializeGLFW();
 bool InitializeGLEW();
+void UpdateWindowTitle();
 
 
 /***********************************************************
@@ -46,6 +63,48 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	// the time to the first frame is measured from here
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point titleTime = startTime;
+	bool bFirstFrame = true;
+
+	// the profiled frames are written as a Chrome trace on exit
+	// when the application is launched with --trace <file>, the
+	// input is written to a file with --record <file>, a
+	// recorded input file is replayed with --replay <file>, and
+	// another scene file is loaded with --scene <file>
+	const char* traceFileName = NULL;
+	const char* recordFileName = NULL;
+	const char* replayFileName = NULL;
+	const char* sceneFileName = NULL;
+	for (int i = 1; i < argc - 1; i++)
+	{
+		if (0 == strcmp(argv[i], "--trace"))
+		{
+			traceFileName = argv[i + 1];
+		}
+		else if (0 == strcmp(argv[i], "--record"))
+		{
+			recordFileName = argv[i + 1];
+		}
+		else if (0 == strcmp(argv[i], "--replay"))
+		{
+			replayFileName = argv[i + 1];
+		}
+		else if (0 == strcmp(argv[i], "--scene"))
+		{
+			sceneFileName = argv[i + 1];
+		}
+	}
+
+	// a replay drives the camera at a fixed timestep until the
+	// recorded input runs out, and then closes the window
+	g_InputRecorder = new InputRecorder();
+	if ((NULL != replayFileName) && (g_InputRecorder->StartReplay(replayFileName) == false))
+	{
+		return(EXIT_FAILURE);
+	}
+
 	// if GLFW fails initialization, then terminate the application
 	if (InitializeGLFW() == false)
 	{
@@ -57,6 +116,7 @@ int main(int argc, char* argv[])
 	// try to create a new view manager object
 	g_ViewManager = new ViewManager(
 		g_ShaderManager);
+	g_ViewManager->SetInputRecorder(g_InputRecorder);
 
 	// try to create the main display window
 	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
@@ -67,41 +127,98 @@ int main(int argc, char* argv[])
 		return(EXIT_FAILURE);
 	}
 
+	// try to create a new scene manager object, and start decoding
+	// the scene textures on the worker threads while the shaders
+	// are compiled on this thread, which owns the OpenGL context
+	g_SceneManager = new SceneManager(g_ShaderManager);
+	if ((NULL != sceneFileName) && (g_SceneManager->OpenSceneFile(sceneFileName) == false))
+	{
+		std::cerr << "Could not load the scene file: " << sceneFileName << std::endl;
+		return(EXIT_FAILURE);
+	}
+	g_SceneManager->StartSceneLoading();
+
+	// time the frames, including every draw group of the scene
+	g_FrameProfiler = new FrameProfiler();
+	g_SceneManager->SetFrameProfiler(g_FrameProfiler);
+
 	// load the shader code from the external GLSL files
 	g_ShaderManager->LoadShaders(
-		"../../Utilities/shaders/vertexShader.glsl",
-		"../../Utilities/shaders/fragmentShader.glsl");
+		"Source/shaders/vertexShader.glsl",
+		"Source/shaders/fragmentShader.glsl");
 	g_ShaderManager->use();
 
-	// try to create a new scene manager object and prepare the 3D scene
-	g_SceneManager = new SceneManager(g_ShaderManager);
+	// prepare the 3D scene
 	g_SceneManager->PrepareScene();
 
+	// the recorded times start with the first frame
+	if ((NULL != recordFileName) && (NULL == replayFileName))
+	{
+		g_InputRecorder->StartRecording(glfwGetTime());
+	}
+
+	// the render thread owns the OpenGL context while the frames
+	// run, and this thread handles the input and the simulation
+	g_RenderThread = new RenderThread();
+	glfwMakeContextCurrent(NULL);
+	g_RenderThread->Start(g_Window, g_SceneManager, g_ViewManager, g_FrameProfiler);
+
+	// the heap allocations of both threads are counted from the
+	// first presented frame, since the frames after it should
+	// not allocate
+	uint64_t firstFrameAllocations = 0;
+
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
 	while (!glfwWindowShouldClose(g_Window))
 	{
-		// Enable z-depth
-		glEnable(GL_DEPTH_TEST);
+		// query the latest GLFW events
+		glfwPollEvents();
 
-		// Clear the frame and z buffers
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		// the snapshot is filled while the render thread draws
+		// the frame before it
+		RenderThread::FRAME_SNAPSHOT& snapshot = g_RenderThread->BeginSnapshot();
 
 		// convert from 3D object space to 2D view
-		g_ViewManager->PrepareSceneView();
-
-		// refresh the 3D scene
-		g_SceneManager->RenderScene();
-
-
-		// Flips the the back buffer with the front buffer every frame.
-		glfwSwapBuffers(g_Window);
+		g_ViewManager->UpdateCameraView();
+		snapshot.camera = g_ViewManager->GetCameraBlock();
+		g_ViewManager->GetViewportSize(snapshot.viewportWidth, snapshot.viewportHeight);
+
+		// the objects of this scene do not move
+		snapshot.movedObjects.clear();
+
+		g_RenderThread->PublishSnapshot();
+
+		if (bFirstFrame && (g_RenderThread->GetPresentedFrameCount() > 0))
+		{
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+			std::cout << "INFO: Time to first frame: " << elapsed.count() << " ms" << std::endl;
+			bFirstFrame = false;
+			firstFrameAllocations = GetAllocationCount();
+		}
+
+		// show the rolling frame time percentiles in the title
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (std::chrono::duration<double>(now - titleTime).count() >= TITLE_UPDATE_SECONDS)
+		{
+			UpdateWindowTitle();
+			titleTime = now;
+		}
+	}
 
-		// query the latest GLFW events
-		glfwPollEvents();
+	uint64_t frameCount = g_RenderThread->GetPresentedFrameCount();
+	if (frameCount > 1)
+	{
+		std::cout << "INFO: Heap allocations per frame: "
+			<< (double)(GetAllocationCount() - firstFrameAllocations) / (frameCount - 1) << std::endl;
 	}
 
+	// the context comes back to this thread to free the objects
+	g_RenderThread->Stop();
+	delete g_RenderThread;
+	g_RenderThread = NULL;
+	glfwMakeContextCurrent(g_Window);
+
 	// clear the allocated manager objects from memory
 	if (NULL != g_SceneManager)
 	{
@@ -118,6 +235,38 @@ int main(int argc, char* argv[])
 		delete g_ShaderManager;
 		g_ShaderManager = NULL;
 	}
+	if (NULL != g_FrameProfiler)
+	{
+		if (NULL != traceFileName)
+		{
+			if (g_FrameProfiler->WriteTrace(traceFileName))
+			{
+				std::cout << "INFO: Frame trace written to " << traceFileName << std::endl;
+			}
+			else
+			{
+				std::cerr << "Could not write the frame trace: " << traceFileName << std::endl;
+			}
+		}
+		delete g_FrameProfiler;
+		g_FrameProfiler = NULL;
+	}
+	if (NULL != g_InputRecorder)
+	{
+		if (g_InputRecorder->GetMode() == InputRecorder::MODE_RECORD)
+		{
+			if (g_InputRecorder->SaveRecording(recordFileName))
+			{
+				std::cout << "INFO: " << g_InputRecorder->GetEventCount() << " input events recorded to " << recordFileName << std::endl;
+			}
+			else
+			{
+				std::cerr << "Could not write the input recording: " << recordFileName << std::endl;
+			}
+		}
+		delete g_InputRecorder;
+		g_InputRecorder = NULL;
+	}
 
 	// Terminates the program successfully
 	exit(EXIT_SUCCESS); 
@@ -177,6 +326,36 @@ bool InitializeGLEW()
 	return(true);
 }
 
+/***********************************************************
+ *	UpdateWindowTitle()
+ *
+ *  This function is used to show the percentiles of the CPU
+ *  and GPU frame times of the last frames in the title of the
+ *  display window, with the state calls of a recent frame.
+ ***********************************************************/
+void UpdateWindowTitle()
+{
+	FrameProfiler::FRAME_PERCENTILES cpu;
+	FrameProfiler::FRAME_PERCENTILES gpu;
+	GLStateCache::GL_STATE_STATS stateStats;
+	char title[256];
+
+	// the profiler belongs to the render thread while it runs
+	g_RenderThread->GetFramePercentiles(cpu, gpu);
+	stateStats = g_RenderThread->GetGLStateStats();
+
+	snprintf(
+		title,
+		sizeof(title),
+		"%s | CPU ms p50 %.2f p95 %.2f p99 %.2f | GPU ms p50 %.2f p95 %.2f p99 %.2f | GL calls %llu filtered %llu",
+		WINDOW_TITLE,
+		cpu.p50, cpu.p95, cpu.p99,
+		gpu.p50, gpu.p95, gpu.p99,
+		(unsigned long long)stateStats.callsIssued,
+		(unsigned long long)stateStats.callsFiltered);
+	glfwSetWindowTitle(g_Window, title);
+}
+
 /***********************************************************
  *  LoadTexture()
  *
@@ -194,7 +373,7 @@ GLuint LoadTexture(const char* filename)
 	}
 
 	glGenTextures(1, &texture);
-	glBindTexture(GL_TEXTURE_2D, texture);
+	GetGLStateCache().BindTexture(GL_TEXTURE_2D, texture);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -202,7 +381,7 @@ GLuint LoadTexture(const char* filename)
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 	stbi_image_free(data);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	GetGLStateCache().BindTexture(GL_TEXTURE_2D, 0);
 
 	return texture;
 }
\ No newline at end of file
@@ -0,0 +1,174 @@
+///////////////////////////////////////////////////////////////////////////////
+// mappedfile.cpp
+// ============
+// read only memory mapping of a whole file
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/***********************************************************
+ *  MappedFile()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MappedFile::MappedFile()
+{
+    m_data = NULL;
+    m_size = 0;
+#ifdef _WIN32
+    m_file = INVALID_HANDLE_VALUE;
+    m_mapping = NULL;
+#else
+    m_file = -1;
+#endif
+}
+
+/***********************************************************
+ *  ~MappedFile()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for mapping a whole file into memory
+ *  for reading.  Returns false when the file is missing, is
+ *  empty or can not be mapped, and no file is open then.
+ ***********************************************************/
+bool MappedFile::Open(const char* filename)
+{
+    Close();
+
+#ifdef _WIN32
+    m_file = CreateFileA(
+        filename,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+        NULL);
+    if (INVALID_HANDLE_VALUE == m_file)
+    {
+        return(false);
+    }
+
+    LARGE_INTEGER fileSize;
+    if ((GetFileSizeEx(m_file, &fileSize) == FALSE) || (fileSize.QuadPart <= 0))
+    {
+        Close();
+        return(false);
+    }
+    m_size = (size_t)fileSize.QuadPart;
+
+    m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (NULL == m_mapping)
+    {
+        Close();
+        return(false);
+    }
+    m_data = (const unsigned char*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+    m_file = open(filename, O_RDONLY);
+    if (m_file < 0)
+    {
+        return(false);
+    }
+
+    struct stat fileStatus;
+    if ((fstat(m_file, &fileStatus) != 0) || (fileStatus.st_size <= 0))
+    {
+        Close();
+        return(false);
+    }
+    m_size = (size_t)fileStatus.st_size;
+
+    void* mapped = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+    m_data = (MAP_FAILED != mapped) ? (const unsigned char*)mapped : NULL;
+#endif
+
+    if (NULL == m_data)
+    {
+        Close();
+        return(false);
+    }
+
+    return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for unmapping the file.  The mapped
+ *  bytes must no longer be used.
+ ***********************************************************/
+void MappedFile::Close()
+{
+#ifdef _WIN32
+    if (NULL != m_data)
+    {
+        UnmapViewOfFile(m_data);
+    }
+    if (NULL != m_mapping)
+    {
+        CloseHandle(m_mapping);
+        m_mapping = NULL;
+    }
+    if (INVALID_HANDLE_VALUE != m_file)
+    {
+        CloseHandle(m_file);
+        m_file = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (NULL != m_data)
+    {
+        munmap((void*)m_data, m_size);
+    }
+    if (m_file >= 0)
+    {
+        close(m_file);
+        m_file = -1;
+    }
+#endif
+
+    m_data = NULL;
+    m_size = 0;
+}
+
+/***********************************************************
+ *  GetData()
+ *
+ *  This method returns the mapped bytes of the file.
+ ***********************************************************/
+const unsigned char* MappedFile::GetData() const
+{
+    return(m_data);
+}
+
+/***********************************************************
+ *  GetSize()
+ *
+ *  This method returns the size of the mapped file in bytes.
+ ***********************************************************/
+size_t MappedFile::GetSize() const
+{
+    return(m_size);
+}
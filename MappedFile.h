@@ -0,0 +1,52 @@
+///////////////////////////////////////////////////////////////////////////////
+// mappedfile.h
+// ============
+// read only memory mapping of a whole file
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+
+/***********************************************************
+ *  MappedFile
+ *
+ *  This class maps a whole file into memory for reading, so
+ *  the baked files of the application are used in place with
+ *  no copy and no parsing.  The pages are read by the
+ *  operating system when they are first touched.
+ ***********************************************************/
+class MappedFile
+{
+public:
+    // constructor
+    MappedFile();
+    // destructor
+    ~MappedFile();
+
+    // map a file, false when it is missing or empty
+    bool Open(const char* filename);
+    // unmap the file
+    void Close();
+
+    // mapped bytes of the file, NULL when no file is open
+    const unsigned char* GetData() const;
+    size_t GetSize() const;
+
+private:
+    const unsigned char* m_data;
+    size_t m_size;
+
+    // operating system handles of the mapping
+#ifdef _WIN32
+    void* m_file;
+    void* m_mapping;
+#else
+    int m_file;
+#endif
+
+    // a mapping can not be shared by two objects
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+};
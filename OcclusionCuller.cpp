@@ -0,0 +1,510 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusionculler.cpp
+// ============
+// hierarchical depth occlusion culling from a read back depth buffer
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "OcclusionCuller.h"
+
+#include <cmath>
+#include <algorithm>
+
+// declaration of the global variables and defines
+namespace
+{
+    // a box corner this close to the camera plane has no
+    // usable screen position, so the box is never occluded
+    const float MINIMUM_CLIP_W = 1.0e-5f;
+    // depth tolerance for the rounding of the depth buffer
+    const float DEPTH_BIAS = 1.0e-5f;
+}
+
+/***********************************************************
+ *  OcclusionCuller()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+OcclusionCuller::OcclusionCuller()
+{
+    m_mode = OCCLUSION_CONSERVATIVE;
+    m_stats.objectsTested = 0;
+    m_stats.objectsOccluded = 0;
+    m_stats.samplesPassed = 0;
+    m_frameNumber = 0;
+
+    m_captureWidth = 0;
+    m_captureHeight = 0;
+    m_nextCapture = 0;
+    for (int i = 0; i < CAPTURE_COUNT; i++)
+    {
+        m_captures[i].pixelBuffer = 0;
+        m_captures[i].fence = NULL;
+        m_captures[i].frameNumber = 0;
+        m_captures[i].viewProjection = glm::mat4(1.0f);
+        m_captures[i].sceneVersion = 0;
+    }
+
+    m_pyramidViewProjection = glm::mat4(1.0f);
+    m_pyramidSceneVersion = 0;
+    m_bPyramidUsable = false;
+
+    glGenQueries(CAPTURE_COUNT, m_sampleQueries);
+    for (int i = 0; i < CAPTURE_COUNT; i++)
+    {
+        m_bQueryPending[i] = false;
+    }
+    m_nextQuery = 0;
+    m_bQueryActive = false;
+}
+
+/***********************************************************
+ *  ~OcclusionCuller()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+OcclusionCuller::~OcclusionCuller()
+{
+    ReleaseCaptures();
+    glDeleteQueries(CAPTURE_COUNT, m_sampleQueries);
+}
+
+/***********************************************************
+ *  SetMode()
+ *
+ *  This method is used for setting how the old depth is used
+ *  for culling the objects.
+ ***********************************************************/
+void OcclusionCuller::SetMode(OCCLUSION_MODE mode)
+{
+    m_mode = mode;
+}
+
+/***********************************************************
+ *  GetMode()
+ *
+ *  This method returns how the old depth is used for culling.
+ ***********************************************************/
+OcclusionCuller::OCCLUSION_MODE OcclusionCuller::GetMode() const
+{
+    return(m_mode);
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method returns the occlusion results of the current
+ *  frame.
+ ***********************************************************/
+const OcclusionCuller::OCCLUSION_STATS& OcclusionCuller::GetStats() const
+{
+    return(m_stats);
+}
+
+/***********************************************************
+ *  AllocateCaptures()
+ *
+ *  This method is used for creating the pixel buffers that
+ *  the depth buffer is read back into, one for each capture
+ *  in flight.  The old captures and pyramid are dropped.
+ ***********************************************************/
+void OcclusionCuller::AllocateCaptures(int width, int height)
+{
+    ReleaseCaptures();
+
+    m_captureWidth = width;
+    m_captureHeight = height;
+    for (int i = 0; i < CAPTURE_COUNT; i++)
+    {
+        glGenBuffers(1, &m_captures[i].pixelBuffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, m_captures[i].pixelBuffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (size_t)width * height * sizeof(float), NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+/***********************************************************
+ *  ReleaseCaptures()
+ *
+ *  This method is used for deleting the pixel buffers and the
+ *  fences of the captures in flight, and the pyramid.
+ ***********************************************************/
+void OcclusionCuller::ReleaseCaptures()
+{
+    for (int i = 0; i < CAPTURE_COUNT; i++)
+    {
+        if (NULL != m_captures[i].fence)
+        {
+            glDeleteSync(m_captures[i].fence);
+            m_captures[i].fence = NULL;
+        }
+        if (0 != m_captures[i].pixelBuffer)
+        {
+            glDeleteBuffers(1, &m_captures[i].pixelBuffer);
+            m_captures[i].pixelBuffer = 0;
+        }
+    }
+
+    m_captureWidth = 0;
+    m_captureHeight = 0;
+    m_nextCapture = 0;
+    m_pyramid.clear();
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for building the pyramid from the
+ *  newest depth capture that the GPU has finished, without
+ *  waiting for the ones still in flight, and deciding if the
+ *  pyramid can be used for the current frame.  Returns true
+ *  when objects can be tested.
+ ***********************************************************/
+bool OcclusionCuller::BeginFrame(
+    const glm::mat4& viewProjection,
+    int viewportWidth,
+    int viewportHeight,
+    uint64_t sceneVersion)
+{
+    m_frameNumber++;
+    m_stats.objectsTested = 0;
+    m_stats.objectsOccluded = 0;
+    CollectSampleQueries();
+
+    int newest = -1;
+    for (int i = 0; i < CAPTURE_COUNT; i++)
+    {
+        if (NULL == m_captures[i].fence)
+        {
+            continue;
+        }
+
+        GLenum result = glClientWaitSync(m_captures[i].fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if ((GL_ALREADY_SIGNALED != result) && (GL_CONDITION_SATISFIED != result))
+        {
+            continue;
+        }
+
+        // a finished capture older than the newest one is stale
+        if ((newest >= 0) && (m_captures[newest].frameNumber > m_captures[i].frameNumber))
+        {
+            glDeleteSync(m_captures[i].fence);
+            m_captures[i].fence = NULL;
+            continue;
+        }
+        if (newest >= 0)
+        {
+            glDeleteSync(m_captures[newest].fence);
+            m_captures[newest].fence = NULL;
+        }
+        newest = i;
+    }
+
+    if (newest >= 0)
+    {
+        DEPTH_CAPTURE& capture = m_captures[newest];
+        size_t bytes = (size_t)m_captureWidth * m_captureHeight * sizeof(float);
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, capture.pixelBuffer);
+        const float* depths = (const float*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+        if (NULL != depths)
+        {
+            BuildPyramid(depths);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+
+            m_pyramidViewProjection = capture.viewProjection;
+            m_pyramidSceneVersion = capture.sceneVersion;
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        glDeleteSync(capture.fence);
+        capture.fence = NULL;
+    }
+
+    m_bPyramidUsable =
+        (OCCLUSION_OFF != m_mode) &&
+        (m_pyramid.empty() == false) &&
+        (m_captureWidth == viewportWidth) &&
+        (m_captureHeight == viewportHeight);
+
+    // the conservative mode needs the depth of this exact view
+    if ((OCCLUSION_CONSERVATIVE == m_mode) &&
+        ((viewProjection != m_pyramidViewProjection) || (sceneVersion != m_pyramidSceneVersion)))
+    {
+        m_bPyramidUsable = false;
+    }
+
+    return(m_bPyramidUsable);
+}
+
+/***********************************************************
+ *  BuildPyramid()
+ *
+ *  This method is used for reducing a read back depth buffer
+ *  into the pyramid.  The first level is half the size of the
+ *  depth buffer and every texel keeps the farthest of the 2x2
+ *  texels under it, down to a single texel.  The edge texels
+ *  of an odd size are repeated.
+ ***********************************************************/
+void OcclusionCuller::BuildPyramid(const float* depths)
+{
+    const float* source = depths;
+    int sourceWidth = m_captureWidth;
+    int sourceHeight = m_captureHeight;
+    int levelCount = 0;
+
+    for (int size = std::max(m_captureWidth, m_captureHeight); size > 1; size = (size + 1) / 2)
+    {
+        levelCount++;
+    }
+    m_pyramid.resize(std::max(levelCount, 1));
+
+    for (size_t level = 0; level < m_pyramid.size(); level++)
+    {
+        PYRAMID_LEVEL& target = m_pyramid[level];
+
+        target.width = std::max((sourceWidth + 1) / 2, 1);
+        target.height = std::max((sourceHeight + 1) / 2, 1);
+        target.depths.resize((size_t)target.width * target.height);
+
+        for (int y = 0; y < target.height; y++)
+        {
+            const float* row0 = source + (size_t)std::min(y * 2, sourceHeight - 1) * sourceWidth;
+            const float* row1 = source + (size_t)std::min(y * 2 + 1, sourceHeight - 1) * sourceWidth;
+            float* output = &target.depths[(size_t)y * target.width];
+
+            for (int x = 0; x < target.width; x++)
+            {
+                int x0 = std::min(x * 2, sourceWidth - 1);
+                int x1 = std::min(x * 2 + 1, sourceWidth - 1);
+
+                output[x] = std::max(std::max(row0[x0], row0[x1]), std::max(row1[x0], row1[x1]));
+            }
+        }
+
+        source = target.depths.data();
+        sourceWidth = target.width;
+        sourceHeight = target.height;
+    }
+}
+
+/***********************************************************
+ *  IsOccluded()
+ *
+ *  This method is used for testing the world bounds of an
+ *  object against the pyramid, with the view of the capture
+ *  the pyramid was built from.  The level is picked so the
+ *  screen rectangle of the box covers at most 2x2 texels,
+ *  which are all compared with the nearest depth of the box.
+ *  A box that is partly behind the camera or outside of the
+ *  captured view is never occluded.  The test only reads the
+ *  pyramid, so objects can be tested on several threads at
+ *  once and their results counted with AddTestCounts().
+ ***********************************************************/
+bool OcclusionCuller::IsOccluded(const SceneBVH::BOUNDS& bounds) const
+{
+    if (m_bPyramidUsable == false)
+    {
+        return(false);
+    }
+
+    glm::vec2 screenMin = glm::vec2(1.0f);
+    glm::vec2 screenMax = glm::vec2(-1.0f);
+    float nearestDepth = 1.0f;
+
+    for (int corner = 0; corner < 8; corner++)
+    {
+        glm::vec4 position = glm::vec4(
+            (corner & 1) ? bounds.maximum.x : bounds.minimum.x,
+            (corner & 2) ? bounds.maximum.y : bounds.minimum.y,
+            (corner & 4) ? bounds.maximum.z : bounds.minimum.z,
+            1.0f);
+        glm::vec4 clip = m_pyramidViewProjection * position;
+
+        if (clip.w < MINIMUM_CLIP_W)
+        {
+            return(false);
+        }
+
+        glm::vec2 ndc = glm::vec2(clip.x, clip.y) * (1.0f / clip.w);
+        float depth = clip.z / clip.w * 0.5f + 0.5f;
+
+        if (corner == 0)
+        {
+            screenMin = ndc;
+            screenMax = ndc;
+        }
+        screenMin = glm::min(screenMin, ndc);
+        screenMax = glm::max(screenMax, ndc);
+        nearestDepth = std::min(nearestDepth, depth);
+    }
+
+    // the pixels whose centers the box can cover
+    float minX = (screenMin.x * 0.5f + 0.5f) * m_captureWidth;
+    float maxX = (screenMax.x * 0.5f + 0.5f) * m_captureWidth;
+    float minY = (screenMin.y * 0.5f + 0.5f) * m_captureHeight;
+    float maxY = (screenMax.y * 0.5f + 0.5f) * m_captureHeight;
+
+    if ((maxX < 0.0f) || (minX >= (float)m_captureWidth) ||
+        (maxY < 0.0f) || (minY >= (float)m_captureHeight))
+    {
+        return(false);
+    }
+
+    int x0 = std::max((int)std::floor(minX), 0);
+    int x1 = std::min((int)std::floor(maxX), m_captureWidth - 1);
+    int y0 = std::max((int)std::floor(minY), 0);
+    int y1 = std::min((int)std::floor(maxY), m_captureHeight - 1);
+
+    int level = 0;
+    while ((level + 1 < (int)m_pyramid.size()) &&
+        (((x1 >> (level + 1)) - (x0 >> (level + 1)) > 1) || ((y1 >> (level + 1)) - (y0 >> (level + 1)) > 1)))
+    {
+        level++;
+    }
+
+    const PYRAMID_LEVEL& pyramidLevel = m_pyramid[level];
+    float farthestDepth = 0.0f;
+
+    for (int y = (y0 >> (level + 1)); y <= std::min(y1 >> (level + 1), pyramidLevel.height - 1); y++)
+    {
+        for (int x = (x0 >> (level + 1)); x <= std::min(x1 >> (level + 1), pyramidLevel.width - 1); x++)
+        {
+            farthestDepth = std::max(farthestDepth, pyramidLevel.depths[(size_t)y * pyramidLevel.width + x]);
+        }
+    }
+
+    if (nearestDepth > farthestDepth + DEPTH_BIAS)
+    {
+        return(true);
+    }
+
+    return(false);
+}
+
+/***********************************************************
+ *  AddTestCounts()
+ *
+ *  This method is used for adding the number of objects that
+ *  were tested in the current frame, and how many of them
+ *  were occluded, to the occlusion results.
+ ***********************************************************/
+void OcclusionCuller::AddTestCounts(uint32_t objectsTested, uint32_t objectsOccluded)
+{
+    m_stats.objectsTested += objectsTested;
+    m_stats.objectsOccluded += objectsOccluded;
+}
+
+/***********************************************************
+ *  CaptureDepth()
+ *
+ *  This method is used for starting to read back the depth
+ *  buffer into the next pixel buffer.  It must be called
+ *  after the opaque draws and before the translucent draws,
+ *  which must not hide anything.  The capture is skipped
+ *  when all of the pixel buffers are still in flight, so the
+ *  CPU never waits for the GPU.
+ ***********************************************************/
+void OcclusionCuller::CaptureDepth(
+    const glm::mat4& viewProjection,
+    int viewportWidth,
+    int viewportHeight,
+    uint64_t sceneVersion)
+{
+    if ((OCCLUSION_OFF == m_mode) || (viewportWidth <= 0) || (viewportHeight <= 0))
+    {
+        return;
+    }
+
+    if ((m_captureWidth != viewportWidth) || (m_captureHeight != viewportHeight))
+    {
+        AllocateCaptures(viewportWidth, viewportHeight);
+    }
+
+    DEPTH_CAPTURE& capture = m_captures[m_nextCapture];
+    if (NULL != capture.fence)
+    {
+        return;
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, capture.pixelBuffer);
+    glReadPixels(0, 0, viewportWidth, viewportHeight, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    capture.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    capture.frameNumber = m_frameNumber;
+    capture.viewProjection = viewProjection;
+    capture.sceneVersion = sceneVersion;
+
+    m_nextCapture = (m_nextCapture + 1) % CAPTURE_COUNT;
+}
+
+/***********************************************************
+ *  BeginSampleQuery()
+ *
+ *  This method is used for starting to count the samples that
+ *  pass the depth test, which measures the fragment work that
+ *  the culling saves.  A frame is not counted when the query
+ *  of the oldest frame in flight is not done yet.
+ ***********************************************************/
+void OcclusionCuller::BeginSampleQuery()
+{
+    if (m_bQueryPending[m_nextQuery])
+    {
+        return;
+    }
+
+    glBeginQuery(GL_SAMPLES_PASSED, m_sampleQueries[m_nextQuery]);
+    m_bQueryActive = true;
+}
+
+/***********************************************************
+ *  EndSampleQuery()
+ *
+ *  This method is used for ending the count of the samples
+ *  that started with BeginSampleQuery().
+ ***********************************************************/
+void OcclusionCuller::EndSampleQuery()
+{
+    if (m_bQueryActive == false)
+    {
+        return;
+    }
+
+    glEndQuery(GL_SAMPLES_PASSED);
+    m_bQueryActive = false;
+    m_bQueryPending[m_nextQuery] = true;
+    m_nextQuery = (m_nextQuery + 1) % CAPTURE_COUNT;
+}
+
+/***********************************************************
+ *  CollectSampleQueries()
+ *
+ *  This method is used for reading the results of the sample
+ *  queries that are done, from the oldest to the newest, so
+ *  the stats keep the count of the newest finished frame.
+ ***********************************************************/
+void OcclusionCuller::CollectSampleQueries()
+{
+    for (int i = 0; i < CAPTURE_COUNT; i++)
+    {
+        int query = (m_nextQuery + i) % CAPTURE_COUNT;
+        GLint available = 0;
+
+        if (m_bQueryPending[query] == false)
+        {
+            continue;
+        }
+
+        glGetQueryObjectiv(m_sampleQueries[query], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == 0)
+        {
+            break;
+        }
+
+        GLuint64 samples = 0;
+        glGetQueryObjectui64v(m_sampleQueries[query], GL_QUERY_RESULT, &samples);
+        m_stats.samplesPassed = samples;
+        m_bQueryPending[query] = false;
+    }
+}
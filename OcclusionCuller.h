@@ -0,0 +1,136 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusionculler.h
+// ============
+// hierarchical depth occlusion culling from a read back depth buffer
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneBVH.h"
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  OcclusionCuller
+ *
+ *  This class rejects objects that are hidden behind other
+ *  objects.  The depth of the opaque objects of a frame is
+ *  read back into a pixel buffer without waiting, and once
+ *  the GPU has written it a few frames later, the CPU reduces
+ *  it to a pyramid where every texel holds the farthest depth
+ *  of the pixels under it.  An object is occluded when the
+ *  nearest point of its box is behind the farthest depth of
+ *  the pyramid texels that its screen rectangle covers.
+ *
+ *  The depth is a few frames old.  The conservative mode only
+ *  culls while the camera and the scene are the same as when
+ *  the depth was captured, so it never drops a visible object.
+ *  The aggressive mode also culls while they change, which
+ *  can drop an object for the frames until the depth catches up.
+ ***********************************************************/
+class OcclusionCuller
+{
+public:
+    // constructor
+    OcclusionCuller();
+    // destructor
+    ~OcclusionCuller();
+
+    // how the old depth is used for culling
+    enum OCCLUSION_MODE
+    {
+        OCCLUSION_OFF,
+        OCCLUSION_CONSERVATIVE,
+        OCCLUSION_AGGRESSIVE
+    };
+
+    // occlusion results of one frame
+    struct OCCLUSION_STATS
+    {
+        uint32_t objectsTested;
+        uint32_t objectsOccluded;
+        // samples that passed the depth test in the last frame
+        // whose query result is available
+        uint64_t samplesPassed;
+    };
+
+    // number of depth captures that can be in flight
+    static const int CAPTURE_COUNT = 3;
+
+    // set how the old depth is used for culling
+    void SetMode(OCCLUSION_MODE mode);
+    OCCLUSION_MODE GetMode() const;
+
+    // pick up a finished depth capture and prepare the tests
+    bool BeginFrame(const glm::mat4& viewProjection, int viewportWidth, int viewportHeight, uint64_t sceneVersion);
+    // test the world bounds of an object against the pyramid
+    bool IsOccluded(const SceneBVH::BOUNDS& bounds) const;
+    // count the tests of the current frame
+    void AddTestCounts(uint32_t objectsTested, uint32_t objectsOccluded);
+    // start reading back the depth of the opaque draws
+    void CaptureDepth(const glm::mat4& viewProjection, int viewportWidth, int viewportHeight, uint64_t sceneVersion);
+
+    // count the samples of the draws between these calls
+    void BeginSampleQuery();
+    void EndSampleQuery();
+
+    // occlusion results of the current frame
+    const OCCLUSION_STATS& GetStats() const;
+
+private:
+    // one read back of the depth buffer
+    struct DEPTH_CAPTURE
+    {
+        GLuint pixelBuffer;
+        // signaled when the depth has been written
+        GLsync fence;
+        uint64_t frameNumber;
+        glm::mat4 viewProjection;
+        uint64_t sceneVersion;
+    };
+
+    // one level of the depth pyramid
+    struct PYRAMID_LEVEL
+    {
+        int width;
+        int height;
+        std::vector<float> depths;
+    };
+
+    OCCLUSION_MODE m_mode;
+    OCCLUSION_STATS m_stats;
+    uint64_t m_frameNumber;
+
+    // size of the read back depth buffer
+    int m_captureWidth;
+    int m_captureHeight;
+    DEPTH_CAPTURE m_captures[CAPTURE_COUNT];
+    int m_nextCapture;
+
+    // depth pyramid and the capture it was built from
+    std::vector<PYRAMID_LEVEL> m_pyramid;
+    glm::mat4 m_pyramidViewProjection;
+    uint64_t m_pyramidSceneVersion;
+    // set when the pyramid is used for the current frame
+    bool m_bPyramidUsable;
+
+    // queries counting the samples of the frames in flight
+    GLuint m_sampleQueries[CAPTURE_COUNT];
+    bool m_bQueryPending[CAPTURE_COUNT];
+    int m_nextQuery;
+    // set while a query counts the samples of this frame
+    bool m_bQueryActive;
+
+    // create the pixel buffers for a new viewport size
+    void AllocateCaptures(int width, int height);
+    // delete the pixel buffers and their fences
+    void ReleaseCaptures();
+    // reduce a read back depth buffer into the pyramid
+    void BuildPyramid(const float* depths);
+    // read the finished sample queries
+    void CollectSampleQueries();
+};
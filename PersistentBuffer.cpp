@@ -0,0 +1,190 @@
+///////////////////////////////////////////////////////////////////////////////
+// persistentbuffer.cpp
+// ============
+// persistently mapped buffer that streams data to the GPU every frame
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "PersistentBuffer.h"
+
+// declaration of the global variables and defines
+namespace
+{
+    // regions start on this boundary, which satisfies the
+    // storage and uniform buffer offset alignment of all drivers
+    const size_t REGION_ALIGNMENT = 256;
+    // the smallest region that is allocated
+    const size_t MINIMUM_REGION_SIZE = 64 * 1024;
+    // fence waits are made in steps of one second
+    const GLuint64 FENCE_TIMEOUT = 1000000000;
+}
+
+/***********************************************************
+ *  PersistentBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+PersistentBuffer::PersistentBuffer()
+{
+    m_buffer = 0;
+    m_mapped = NULL;
+    m_regionSize = 0;
+    m_region = 0;
+
+    for (int i = 0; i < REGION_COUNT; i++)
+    {
+        m_fences[i] = NULL;
+    }
+}
+
+/***********************************************************
+ *  ~PersistentBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+PersistentBuffer::~PersistentBuffer()
+{
+    Release();
+}
+
+/***********************************************************
+ *  BeginRegion()
+ *
+ *  This method is used for moving to the next region of the
+ *  ring and returns the mapped memory of the region.  The
+ *  buffer is allocated again when the region is too small,
+ *  which only happens while the data is still growing.
+ ***********************************************************/
+void* PersistentBuffer::BeginRegion(size_t bytes)
+{
+    if (bytes > m_regionSize)
+    {
+        // grow with some headroom for the next frames
+        size_t regionSize = bytes + bytes / 2;
+        if (regionSize < MINIMUM_REGION_SIZE)
+        {
+            regionSize = MINIMUM_REGION_SIZE;
+        }
+        regionSize = (regionSize + REGION_ALIGNMENT - 1) & ~(REGION_ALIGNMENT - 1);
+
+        Release();
+        Allocate(regionSize);
+    }
+    else
+    {
+        m_region = (m_region + 1) % REGION_COUNT;
+        WaitForRegion(m_region);
+    }
+
+    return(m_mapped + m_region * m_regionSize);
+}
+
+/***********************************************************
+ *  EndRegion()
+ *
+ *  This method is used for fencing the current region.  It
+ *  must be called after the last command that reads from the
+ *  region has been issued.
+ ***********************************************************/
+void PersistentBuffer::EndRegion()
+{
+    if (NULL != m_fences[m_region])
+    {
+        glDeleteSync(m_fences[m_region]);
+    }
+    m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+/***********************************************************
+ *  GetBuffer()
+ *
+ *  This method returns the name of the buffer object.
+ ***********************************************************/
+GLuint PersistentBuffer::GetBuffer() const
+{
+    return(m_buffer);
+}
+
+/***********************************************************
+ *  GetRegionOffset()
+ *
+ *  This method returns the offset of the current region from
+ *  the start of the buffer.
+ ***********************************************************/
+GLintptr PersistentBuffer::GetRegionOffset() const
+{
+    return((GLintptr)(m_region * m_regionSize));
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used for creating the buffer with immutable
+ *  storage and mapping it one time.  The mapping is coherent,
+ *  so writes are seen by the commands issued after them
+ *  without flushing.
+ ***********************************************************/
+void PersistentBuffer::Allocate(size_t regionSize)
+{
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    m_regionSize = regionSize;
+    m_region = 0;
+
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, m_regionSize * REGION_COUNT, NULL, flags);
+    m_mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, m_regionSize * REGION_COUNT, flags);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  Release()
+ *
+ *  This method is used for waiting until the GPU is done with
+ *  every region and then unmapping and deleting the buffer.
+ ***********************************************************/
+void PersistentBuffer::Release()
+{
+    for (int i = 0; i < REGION_COUNT; i++)
+    {
+        WaitForRegion(i);
+    }
+
+    if (0 != m_buffer)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glDeleteBuffers(1, &m_buffer);
+    }
+
+    m_buffer = 0;
+    m_mapped = NULL;
+    m_regionSize = 0;
+}
+
+/***********************************************************
+ *  WaitForRegion()
+ *
+ *  This method is used for blocking until the commands that
+ *  read the passed in region have completed.
+ ***********************************************************/
+void PersistentBuffer::WaitForRegion(int region)
+{
+    if (NULL == m_fences[region])
+    {
+        return;
+    }
+
+    // keep waiting while the GPU is still busy, a failed wait
+    // means the fence can never signal
+    GLenum result = GL_TIMEOUT_EXPIRED;
+    while (GL_TIMEOUT_EXPIRED == result)
+    {
+        result = glClientWaitSync(m_fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+    }
+
+    glDeleteSync(m_fences[region]);
+    m_fences[region] = NULL;
+}
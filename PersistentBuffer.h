@@ -0,0 +1,62 @@
+///////////////////////////////////////////////////////////////////////////////
+// persistentbuffer.h
+// ============
+// persistently mapped buffer that streams data to the GPU every frame
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+
+/***********************************************************
+ *  PersistentBuffer
+ *
+ *  This class keeps one buffer mapped for its whole lifetime
+ *  and splits it into a ring of regions, one region for each
+ *  frame in flight.  The CPU writes a frame straight into the
+ *  mapped memory while the GPU still reads the previous frames
+ *  from the other regions, and a fence on every region makes
+ *  sure a region is never written while the GPU reads it.
+ ***********************************************************/
+class PersistentBuffer
+{
+public:
+    // constructor
+    PersistentBuffer();
+    // destructor
+    ~PersistentBuffer();
+
+    // number of frames that can be in flight
+    static const int REGION_COUNT = 3;
+
+    // start writing the next region, returns the mapped memory
+    void* BeginRegion(size_t bytes);
+    // fence the region once the commands reading it are issued
+    void EndRegion();
+
+    // buffer object name
+    GLuint GetBuffer() const;
+    // offset of the current region into the buffer
+    GLintptr GetRegionOffset() const;
+
+private:
+    // buffer object name
+    GLuint m_buffer;
+    // start of the mapped buffer
+    unsigned char* m_mapped;
+    // size of one region in bytes
+    size_t m_regionSize;
+    // region written in the current frame
+    int m_region;
+    // fences of the commands that read each region
+    GLsync m_fences[REGION_COUNT];
+
+    // create and map the buffer with the passed in region size
+    void Allocate(size_t regionSize);
+    // wait for the GPU and free the buffer
+    void Release();
+    // wait until the GPU is done with a region
+    void WaitForRegion(int region);
+};
@@ -0,0 +1,319 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.cpp
+// ============
+// state-sorted list of the draw submissions for a frame
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+// declaration of the global variables and defines
+namespace
+{
+    // bit layout of a sort key, from the most significant bit
+    //   opaque:      layer(1) program(3) texture(12) mesh(16) material(12) depth(20)
+    //   translucent: layer(1) depth(20) program(3) texture(12) mesh(16) material(12)
+    // the mesh field is wide enough that two meshes of a large
+    // scene never share a key, and the depth keeps the exponent
+    // and the top mantissa bits, which still order the draws
+    const int PROGRAM_BITS = 3;
+    const int TEXTURE_BITS = 12;
+    const int MESH_BITS = 16;
+    const int MATERIAL_BITS = 12;
+    const int DEPTH_BITS = 20;
+
+    const uint64_t TRANSLUCENT_LAYER = (uint64_t)1 << 63;
+
+    // fewest draws of a chunk that is sorted on its own thread
+    const size_t MIN_SORT_CHUNK = 8192;
+
+    /***********************************************************
+     *  QuantizeDepth()
+     *
+     *  The bit pattern of a positive float grows with its value,
+     *  so the top bits of the pattern are a depth key that keeps
+     *  its precision close to the camera and needs no range.
+     ***********************************************************/
+    uint64_t QuantizeDepth(float viewDepth)
+    {
+        uint32_t depthBits = 0;
+
+        if (viewDepth > 0.0f)
+        {
+            memcpy(&depthBits, &viewDepth, sizeof(depthBits));
+        }
+
+        return((uint64_t)(depthBits >> (32 - DEPTH_BITS)));
+    }
+
+    // pack the state fields of a key into one value
+    uint64_t PackState(uint32_t program, uint32_t texture, uint32_t mesh, uint32_t material)
+    {
+        uint64_t state = program & ((1u << PROGRAM_BITS) - 1);
+        state = (state << TEXTURE_BITS) | (texture & ((1u << TEXTURE_BITS) - 1));
+        state = (state << MESH_BITS) | (mesh & ((1u << MESH_BITS) - 1));
+        state = (state << MATERIAL_BITS) | (material & ((1u << MATERIAL_BITS) - 1));
+
+        return(state);
+    }
+}
+
+/***********************************************************
+ *  RenderQueue()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderQueue::RenderQueue()
+{
+}
+
+/***********************************************************
+ *  MakeOpaqueKey()
+ *
+ *  This method is used for building the sort key of an opaque
+ *  draw.  The state fields come first so draws with the same
+ *  state are grouped, and the depth comes last so each group
+ *  is drawn front-to-back to reduce overdraw.  The mesh comes
+ *  before the material, since draws that only differ in their
+ *  material are drawn together as instances of one mesh.
+ ***********************************************************/
+uint64_t RenderQueue::MakeOpaqueKey(
+    uint32_t program,
+    uint32_t texture,
+    uint32_t mesh,
+    uint32_t material,
+    float viewDepth)
+{
+    uint64_t state = PackState(program, texture, mesh, material);
+
+    return((state << DEPTH_BITS) | QuantizeDepth(viewDepth));
+}
+
+/***********************************************************
+ *  MakeTranslucentKey()
+ *
+ *  This method is used for building the sort key of a
+ *  translucent draw.  Translucent draws must blend in order,
+ *  so the inverted depth comes first to draw back-to-front.
+ ***********************************************************/
+uint64_t RenderQueue::MakeTranslucentKey(
+    uint32_t program,
+    uint32_t texture,
+    uint32_t mesh,
+    uint32_t material,
+    float viewDepth)
+{
+    uint64_t depth = ((uint64_t)1 << DEPTH_BITS) - 1 - QuantizeDepth(viewDepth);
+    uint64_t state = PackState(program, texture, mesh, material);
+    int stateBits = PROGRAM_BITS + TEXTURE_BITS + MATERIAL_BITS + MESH_BITS;
+
+    return(TRANSLUCENT_LAYER | (depth << stateBits) | state);
+}
+
+/***********************************************************
+ *  IsTranslucentKey()
+ *
+ *  This method returns true when the passed in sort key was
+ *  built for a translucent draw.
+ ***********************************************************/
+bool RenderQueue::IsTranslucentKey(uint64_t key)
+{
+    return((key & TRANSLUCENT_LAYER) != 0);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the queued draws.
+ *  The storage is kept, so refilling the queue every frame
+ *  does not allocate once it has reached its working size.
+ ***********************************************************/
+void RenderQueue::Clear()
+{
+    m_entries.clear();
+}
+
+/***********************************************************
+ *  Submit()
+ *
+ *  This method is used for queueing a draw of a scene object.
+ ***********************************************************/
+void RenderQueue::Submit(uint64_t key, uint32_t objectIndex)
+{
+    DRAW_ENTRY entry;
+
+    entry.key = key;
+    entry.objectIndex = objectIndex;
+    m_entries.push_back(entry);
+}
+
+/***********************************************************
+ *  Resize()
+ *
+ *  This method is used for setting the number of queued draws
+ *  ahead of filling them in with SetEntry(), which lets the
+ *  draws be written by index from several threads.
+ ***********************************************************/
+void RenderQueue::Resize(size_t count)
+{
+    m_entries.resize(count);
+}
+
+/***********************************************************
+ *  SetEntry()
+ *
+ *  This method is used for filling in a queued draw by index.
+ ***********************************************************/
+void RenderQueue::SetEntry(size_t index, uint64_t key, uint32_t objectIndex)
+{
+    m_entries[index].key = key;
+    m_entries[index].objectIndex = objectIndex;
+}
+
+/***********************************************************
+ *  Sort()
+ *
+ *  This method is used for sorting the queued draws with a
+ *  least significant digit radix sort, one byte per pass.  A
+ *  pass is skipped when every key has the same value in that
+ *  byte, which is common for the program and layer bits.
+ *
+ *  With a job system a long queue is cut into one chunk for
+ *  each thread.  Every chunk counts its digits on its own
+ *  thread, the counts of all chunks are turned into starting
+ *  offsets in chunk order, and then every chunk moves its
+ *  draws on its own thread.  The chunks keep their order, so
+ *  the sort is still stable and gives the same result.
+ ***********************************************************/
+void RenderQueue::Sort(JobSystem* pJobSystem)
+{
+    size_t count = m_entries.size();
+
+    if (count < 2)
+    {
+        return;
+    }
+
+    m_sortBuffer.resize(count);
+
+    size_t chunkCount = 1;
+    if (NULL != pJobSystem)
+    {
+        chunkCount = std::min((size_t)pJobSystem->GetThreadCount(), count / MIN_SORT_CHUNK);
+        chunkCount = std::max(chunkCount, (size_t)1);
+    }
+    size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+    m_digitOffsets.resize(chunkCount * 256);
+
+    DRAW_ENTRY* source = m_entries.data();
+    DRAW_ENTRY* destination = m_sortBuffer.data();
+    size_t* chunkOffsets = m_digitOffsets.data();
+
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        JobSystem::RANGE_FUNCTION countDigits = [=](size_t firstChunk, size_t endChunk)
+        {
+            for (size_t chunk = firstChunk; chunk < endChunk; chunk++)
+            {
+                size_t* offsets = chunkOffsets + chunk * 256;
+                size_t last = std::min(count, (chunk + 1) * chunkSize);
+
+                memset(offsets, 0, 256 * sizeof(size_t));
+                for (size_t i = chunk * chunkSize; i < last; i++)
+                {
+                    offsets[(source[i].key >> shift) & 0xFF]++;
+                }
+            }
+        };
+        JobSystem::RANGE_FUNCTION moveDraws = [=](size_t firstChunk, size_t endChunk)
+        {
+            for (size_t chunk = firstChunk; chunk < endChunk; chunk++)
+            {
+                size_t* offsets = chunkOffsets + chunk * 256;
+                size_t last = std::min(count, (chunk + 1) * chunkSize);
+
+                for (size_t i = chunk * chunkSize; i < last; i++)
+                {
+                    destination[offsets[(source[i].key >> shift) & 0xFF]++] = source[i];
+                }
+            }
+        };
+
+        if (chunkCount > 1)
+        {
+            pJobSystem->ParallelFor(chunkCount, 1, countDigits);
+        }
+        else
+        {
+            countDigits(0, 1);
+        }
+
+        // all of the keys share this byte
+        size_t firstDigit = (source[0].key >> shift) & 0xFF;
+        size_t firstDigitCount = 0;
+        for (size_t chunk = 0; chunk < chunkCount; chunk++)
+        {
+            firstDigitCount += chunkOffsets[chunk * 256 + firstDigit];
+        }
+        if (firstDigitCount == count)
+        {
+            continue;
+        }
+
+        // turn the counts into starting offsets, the chunks of
+        // one digit follow each other in chunk order
+        size_t total = 0;
+        for (int digit = 0; digit < 256; digit++)
+        {
+            for (size_t chunk = 0; chunk < chunkCount; chunk++)
+            {
+                size_t digitCount = chunkOffsets[chunk * 256 + digit];
+                chunkOffsets[chunk * 256 + digit] = total;
+                total += digitCount;
+            }
+        }
+
+        if (chunkCount > 1)
+        {
+            pJobSystem->ParallelFor(chunkCount, 1, moveDraws);
+        }
+        else
+        {
+            moveDraws(0, 1);
+        }
+
+        DRAW_ENTRY* swap = source;
+        source = destination;
+        destination = swap;
+    }
+
+    // an odd number of passes leaves the result in the buffer
+    if (source != m_entries.data())
+    {
+        memcpy(m_entries.data(), source, count * sizeof(DRAW_ENTRY));
+    }
+}
+
+/***********************************************************
+ *  GetCount()
+ *
+ *  This method returns the number of queued draws.
+ ***********************************************************/
+size_t RenderQueue::GetCount() const
+{
+    return(m_entries.size());
+}
+
+/***********************************************************
+ *  GetEntries()
+ *
+ *  This method returns the queued draws, which are in sorted
+ *  order after Sort() has been called.
+ ***********************************************************/
+const RenderQueue::DRAW_ENTRY* RenderQueue::GetEntries() const
+{
+    return(m_entries.data());
+}
@@ -0,0 +1,80 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.h
+// ============
+// state-sorted list of the draw submissions for a frame
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "JobSystem.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  RenderQueue
+ *
+ *  This class collects one 64-bit sort key per draw and sorts
+ *  the draws with a radix sort.  Opaque keys are ordered by
+ *  program, texture, mesh, material and then depth, so draws
+ *  that share state end up next to each other and are drawn
+ *  front-to-back.  Translucent keys sort after every opaque
+ *  key and are ordered back-to-front.
+ ***********************************************************/
+class RenderQueue
+{
+public:
+    // constructor
+    RenderQueue();
+
+    // one queued draw
+    struct DRAW_ENTRY
+    {
+        uint64_t key;
+        uint32_t objectIndex;
+    };
+
+    // build the sort key for an opaque draw
+    static uint64_t MakeOpaqueKey(
+        uint32_t program,
+        uint32_t texture,
+        uint32_t mesh,
+        uint32_t material,
+        float viewDepth);
+    // build the sort key for a translucent draw
+    static uint64_t MakeTranslucentKey(
+        uint32_t program,
+        uint32_t texture,
+        uint32_t mesh,
+        uint32_t material,
+        float viewDepth);
+    // check if a sort key is for a translucent draw
+    static bool IsTranslucentKey(uint64_t key);
+
+    // remove all of the queued draws
+    void Clear();
+    // queue a draw of the passed in scene object
+    void Submit(uint64_t key, uint32_t objectIndex);
+    // set the number of queued draws, to be filled in by index
+    void Resize(size_t count);
+    // fill in a queued draw
+    void SetEntry(size_t index, uint64_t key, uint32_t objectIndex);
+    // sort the queued draws by key, split over the threads of
+    // a job system when one is passed in
+    void Sort(JobSystem* pJobSystem = NULL);
+
+    // number of queued draws
+    size_t GetCount() const;
+    // queued draws, in sorted order after Sort()
+    const DRAW_ENTRY* GetEntries() const;
+
+private:
+    // queued draws
+    std::vector<DRAW_ENTRY> m_entries;
+    // scratch space for the radix sort passes
+    std::vector<DRAW_ENTRY> m_sortBuffer;
+    // digit counts and offsets of every chunk of a sort
+    std::vector<size_t> m_digitOffsets;
+};
@@ -0,0 +1,290 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderthread.cpp
+// ============
+// thread that owns the OpenGL context and renders the frame snapshots
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderThread.h"
+
+// declaration of the global variables and defines
+namespace
+{
+    // frames between two refreshes of the shared percentiles
+    const uint64_t PERCENTILE_UPDATE_FRAMES = 30;
+}
+
+/***********************************************************
+ *  RenderThread()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderThread::RenderThread()
+{
+    m_pWindow = NULL;
+    m_pSceneManager = NULL;
+    m_pViewManager = NULL;
+    m_pProfiler = NULL;
+    m_publishedFrame = 0;
+    m_takenFrame = 0;
+    m_presentedFrames = 0;
+    m_bStopping = false;
+    m_cpuPercentiles = FrameProfiler::FRAME_PERCENTILES();
+    m_gpuPercentiles = FrameProfiler::FRAME_PERCENTILES();
+    m_glStateStats.callsIssued = 0;
+    m_glStateStats.callsFiltered = 0;
+}
+
+/***********************************************************
+ *  ~RenderThread()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RenderThread::~RenderThread()
+{
+    Stop();
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for starting the render thread, which
+ *  makes the context of the window current on itself.  The
+ *  context must have been released by the calling thread.
+ ***********************************************************/
+bool RenderThread::Start(
+    GLFWwindow* pWindow,
+    SceneManager* pSceneManager,
+    ViewManager* pViewManager,
+    FrameProfiler* pProfiler)
+{
+    if (m_thread.joinable() || (NULL == pWindow))
+    {
+        return(false);
+    }
+
+    m_pWindow = pWindow;
+    m_pSceneManager = pSceneManager;
+    m_pViewManager = pViewManager;
+    m_pProfiler = pProfiler;
+    m_bStopping = false;
+    m_thread = std::thread(&RenderThread::RenderLoop, this);
+
+    return(true);
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for stopping the render thread once
+ *  it has rendered the published snapshots.  The context is
+ *  released by the render thread, so the calling thread can
+ *  make it current again.
+ ***********************************************************/
+void RenderThread::Stop()
+{
+    if (m_thread.joinable() == false)
+    {
+        return;
+    }
+
+    m_bStopping = true;
+    SignalWaiter();
+    m_thread.join();
+}
+
+/***********************************************************
+ *  BeginSnapshot()
+ *
+ *  This method is used for getting the snapshot to fill for
+ *  the next frame.  It waits while the render thread has not
+ *  taken the last published snapshot, which keeps the thread
+ *  of the window at most one frame ahead of the render thread.
+ ***********************************************************/
+RenderThread::FRAME_SNAPSHOT& RenderThread::BeginSnapshot()
+{
+    uint64_t publishedFrame = m_publishedFrame.load();
+
+    if (m_takenFrame.load() < publishedFrame)
+    {
+        std::unique_lock<std::mutex> lock(m_waitMutex);
+
+        m_waitChanged.wait(lock, [this, publishedFrame]() { return(m_takenFrame.load() >= publishedFrame); });
+    }
+
+    FRAME_SNAPSHOT& snapshot = m_snapshots.GetBack();
+    snapshot.frameNumber = publishedFrame + 1;
+
+    return(snapshot);
+}
+
+/***********************************************************
+ *  PublishSnapshot()
+ *
+ *  This method is used for handing the snapshot that was
+ *  filled over to the render thread.  The snapshot must not
+ *  be changed after it is published.
+ ***********************************************************/
+void RenderThread::PublishSnapshot()
+{
+    m_snapshots.Publish();
+    m_publishedFrame++;
+    SignalWaiter();
+}
+
+/***********************************************************
+ *  GetPresentedFrameCount()
+ *
+ *  This method returns the number of frames that the render
+ *  thread has presented.
+ ***********************************************************/
+uint64_t RenderThread::GetPresentedFrameCount() const
+{
+    return(m_presentedFrames.load());
+}
+
+/***********************************************************
+ *  GetFramePercentiles()
+ *
+ *  This method returns the percentiles of the CPU and GPU
+ *  frame times, as they were when the render thread last
+ *  refreshed them.
+ ***********************************************************/
+void RenderThread::GetFramePercentiles(
+    FrameProfiler::FRAME_PERCENTILES& cpu,
+    FrameProfiler::FRAME_PERCENTILES& gpu)
+{
+    std::lock_guard<std::mutex> lock(m_percentileMutex);
+
+    cpu = m_cpuPercentiles;
+    gpu = m_gpuPercentiles;
+}
+
+/***********************************************************
+ *  GetGLStateStats()
+ *
+ *  This method returns the number of state calls that one
+ *  frame passed to OpenGL and that the state cache dropped,
+ *  as they were when the render thread last refreshed them.
+ ***********************************************************/
+GLStateCache::GL_STATE_STATS RenderThread::GetGLStateStats()
+{
+    std::lock_guard<std::mutex> lock(m_percentileMutex);
+
+    return(m_glStateStats);
+}
+
+/***********************************************************
+ *  RenderLoop()
+ *
+ *  This method is run by the render thread.  It takes the
+ *  newest published snapshot and renders it, and sleeps when
+ *  there is none, until it is stopped with every snapshot
+ *  rendered.
+ ***********************************************************/
+void RenderThread::RenderLoop()
+{
+    glfwMakeContextCurrent(m_pWindow);
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_waitMutex);
+
+            m_waitChanged.wait(lock, [this]() { return(m_snapshots.HasNewValue() || m_bStopping.load()); });
+        }
+
+        if (m_snapshots.TakeNewValue() == false)
+        {
+            break;
+        }
+
+        // the thread of the window can fill the next snapshot
+        // while this one is rendered
+        const FRAME_SNAPSHOT& snapshot = m_snapshots.GetFront();
+        m_takenFrame = snapshot.frameNumber;
+        SignalWaiter();
+
+        RenderFrame(snapshot);
+    }
+
+    glfwMakeContextCurrent(NULL);
+}
+
+/***********************************************************
+ *  RenderFrame()
+ *
+ *  This method is used for drawing the frame of a snapshot
+ *  and presenting it.  The camera data and the moved objects
+ *  of the snapshot are applied first, so the scene is only
+ *  ever changed on this thread while it renders.
+ ***********************************************************/
+void RenderThread::RenderFrame(const FRAME_SNAPSHOT& snapshot)
+{
+    GLStateCache& stateCache = GetGLStateCache();
+
+    m_pProfiler->BeginFrame();
+    stateCache.ResetStats();
+
+    // the viewport follows the size of the window, and the
+    // state that stays the same from frame to frame is only
+    // passed to OpenGL by the first frame
+    stateCache.Viewport(0, 0, snapshot.viewportWidth, snapshot.viewportHeight);
+
+    // Enable z-depth
+    stateCache.Enable(GL_DEPTH_TEST);
+
+    // Clear the frame and z buffers
+    stateCache.ClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    m_pProfiler->BeginScope("ApplySnapshot");
+    m_pViewManager->UploadCameraBlock(snapshot.camera);
+    m_pSceneManager->SetSceneView(
+        snapshot.camera.view,
+        snapshot.camera.projection,
+        snapshot.viewportWidth,
+        snapshot.viewportHeight);
+    m_pSceneManager->SetObjectTransforms(snapshot.movedObjects.data(), snapshot.movedObjects.size());
+    m_pProfiler->EndScope();
+
+    m_pProfiler->BeginScope("RenderScene");
+    m_pSceneManager->RenderScene();
+    m_pProfiler->EndScope();
+
+    // Flips the the back buffer with the front buffer every frame.
+    m_pProfiler->BeginScope("SwapBuffers");
+    glfwSwapBuffers(m_pWindow);
+    m_pProfiler->EndScope();
+
+    m_pProfiler->EndFrame();
+    m_presentedFrames++;
+
+    if ((m_presentedFrames.load() % PERCENTILE_UPDATE_FRAMES) == 0)
+    {
+        FrameProfiler::FRAME_PERCENTILES cpu = m_pProfiler->GetCpuPercentiles();
+        FrameProfiler::FRAME_PERCENTILES gpu = m_pProfiler->GetGpuPercentiles();
+        GLStateCache::GL_STATE_STATS stats = stateCache.GetStats();
+        std::lock_guard<std::mutex> lock(m_percentileMutex);
+
+        m_cpuPercentiles = cpu;
+        m_gpuPercentiles = gpu;
+        m_glStateStats = stats;
+    }
+}
+
+/***********************************************************
+ *  SignalWaiter()
+ *
+ *  This method is used for waking the other thread after a
+ *  snapshot was published or taken.  The mutex is taken
+ *  first, so a thread that checked the frame numbers and is
+ *  about to sleep can not miss the signal.
+ ***********************************************************/
+void RenderThread::SignalWaiter()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_waitMutex);
+    }
+    m_waitChanged.notify_all();
+}
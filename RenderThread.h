@@ -0,0 +1,122 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderthread.h
+// ============
+// thread that owns the OpenGL context and renders the frame snapshots
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+#include "ViewManager.h"
+#include "FrameProfiler.h"
+#include "TripleBuffer.h"
+#include "GLStateCache.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// GLFW library
+#include "GLFW/glfw3.h"
+
+/***********************************************************
+ *  RenderThread
+ *
+ *  This class runs the rendering of the frames on a thread of
+ *  its own, which owns the OpenGL context of the window.  The
+ *  thread of the window handles the input and the simulation,
+ *  and describes every frame with a snapshot - the camera
+ *  data, the viewport and the objects that moved.  A snapshot
+ *  is not changed once it is published, and the snapshots
+ *  are handed over through a lock-free triple buffer, so the
+ *  next frame is simulated while the last one is submitted
+ *  to the GPU.
+ *
+ *  The thread of the window is kept at most one frame ahead.
+ *  It only waits when the render thread has not taken the
+ *  last snapshot yet, and the render thread only waits when
+ *  no new snapshot has been published.
+ ***********************************************************/
+class RenderThread
+{
+public:
+    // constructor
+    RenderThread();
+    // destructor
+    ~RenderThread();
+
+    // everything the render thread needs to draw one frame
+    struct FRAME_SNAPSHOT
+    {
+        uint64_t frameNumber;
+        ViewManager::CAMERA_BLOCK camera;
+        int viewportWidth;
+        int viewportHeight;
+        // new transforms of the objects moved for the frame
+        std::vector<SceneManager::OBJECT_TRANSFORM> movedObjects;
+    };
+
+    // start rendering, the context of the window must not be
+    // current on the calling thread
+    bool Start(
+        GLFWwindow* pWindow,
+        SceneManager* pSceneManager,
+        ViewManager* pViewManager,
+        FrameProfiler* pProfiler);
+    // render the snapshots that are left and release the context
+    void Stop();
+
+    // snapshot to fill for the next frame, waits while the
+    // render thread has not taken the last published one
+    FRAME_SNAPSHOT& BeginSnapshot();
+    // hand the filled snapshot over to the render thread
+    void PublishSnapshot();
+
+    // number of frames that have been presented
+    uint64_t GetPresentedFrameCount() const;
+    // percentiles of the frame times, refreshed from time to
+    // time by the render thread
+    void GetFramePercentiles(
+        FrameProfiler::FRAME_PERCENTILES& cpu,
+        FrameProfiler::FRAME_PERCENTILES& gpu);
+    // state calls of a recent frame, refreshed with the
+    // percentiles
+    GLStateCache::GL_STATE_STATS GetGLStateStats();
+
+private:
+    GLFWwindow* m_pWindow;
+    SceneManager* m_pSceneManager;
+    ViewManager* m_pViewManager;
+    FrameProfiler* m_pProfiler;
+    std::thread m_thread;
+
+    // snapshots passed from the thread of the window
+    TripleBuffer<FRAME_SNAPSHOT> m_snapshots;
+    // frame numbers of the last published and taken snapshots
+    std::atomic<uint64_t> m_publishedFrame;
+    std::atomic<uint64_t> m_takenFrame;
+    std::atomic<uint64_t> m_presentedFrames;
+    // set when the thread must exit
+    std::atomic<bool> m_bStopping;
+
+    // only used for sleeping while there is nothing to do
+    std::mutex m_waitMutex;
+    std::condition_variable m_waitChanged;
+
+    // copy of the percentiles for the thread of the window
+    std::mutex m_percentileMutex;
+    FrameProfiler::FRAME_PERCENTILES m_cpuPercentiles;
+    FrameProfiler::FRAME_PERCENTILES m_gpuPercentiles;
+    GLStateCache::GL_STATE_STATS m_glStateStats;
+
+    // take the snapshots and render them until stopped
+    void RenderLoop();
+    // draw and present the frame of a snapshot
+    void RenderFrame(const FRAME_SNAPSHOT& snapshot);
+    // wake the other thread when it waits
+    void SignalWaiter();
+};
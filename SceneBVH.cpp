@@ -0,0 +1,482 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenebvh.cpp
+// ============
+// bounding volume hierarchy used for culling the scene objects
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneBVH.h"
+
+#include <cmath>
+#include <algorithm>
+
+// declaration of the global variables and defines
+namespace
+{
+    // a node with this many objects or less is not split
+    const uint32_t MAX_LEAF_OBJECTS = 4;
+    // the tree is split at the median, so its depth stays
+    // below the number of bits of the object count
+    const int MAX_TREE_DEPTH = 64;
+    // all six frustum planes still need to be tested
+    const uint32_t ALL_PLANES = 0x3F;
+
+    /***********************************************************
+     *  ClassifyBox()
+     *
+     *  Test a box against the frustum planes of the passed in
+     *  mask.  Returns false when the box is outside of a plane,
+     *  otherwise the planes that the box is fully inside of are
+     *  cleared from the mask, so they are skipped for the
+     *  contents of the box.
+     ***********************************************************/
+    bool ClassifyBox(
+        const SceneBVH::FRUSTUM& frustum,
+        const glm::vec3& minimum,
+        const glm::vec3& maximum,
+        uint32_t& planeMask)
+    {
+        glm::vec3 center = (minimum + maximum) * 0.5f;
+        glm::vec3 extent = (maximum - minimum) * 0.5f;
+
+        for (int i = 0; i < 6; i++)
+        {
+            if ((planeMask & (1u << i)) == 0)
+            {
+                continue;
+            }
+
+            const glm::vec4& plane = frustum.planes[i];
+            float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+            float radius = std::fabs(plane.x) * extent.x + std::fabs(plane.y) * extent.y + std::fabs(plane.z) * extent.z;
+
+            if (distance < -radius)
+            {
+                return(false);
+            }
+            if (distance >= radius)
+            {
+                planeMask &= ~(1u << i);
+            }
+        }
+
+        return(true);
+    }
+
+    // test a sphere against the frustum planes of the mask
+    bool SphereOutside(const SceneBVH::FRUSTUM& frustum, const glm::vec3& center, float radius, uint32_t planeMask)
+    {
+        for (int i = 0; i < 6; i++)
+        {
+            const glm::vec4& plane = frustum.planes[i];
+
+            if ((planeMask & (1u << i)) &&
+                (plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w < -radius))
+            {
+                return(true);
+            }
+        }
+
+        return(false);
+    }
+}
+
+/***********************************************************
+ *  SceneBVH()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneBVH::SceneBVH()
+{
+}
+
+/***********************************************************
+ *  ComputeMeshBounds()
+ *
+ *  This method is used for finding the box around all of the
+ *  vertices of a mesh, and the sphere around the center of
+ *  that box that holds all of the vertices.
+ ***********************************************************/
+SceneBVH::BOUNDS SceneBVH::ComputeMeshBounds(const ShapeGeometry::MESH_DATA& mesh)
+{
+    return(ComputeMeshBounds(mesh.vertices.data(), mesh.vertices.size()));
+}
+
+/***********************************************************
+ *  ComputeMeshBounds()
+ *
+ *  This method is used for finding the bounds of a mesh from
+ *  an array of vertices, such as the vertices of a mapped
+ *  asset pack.
+ ***********************************************************/
+SceneBVH::BOUNDS SceneBVH::ComputeMeshBounds(const ShapeGeometry::MESH_VERTEX* vertices, size_t vertexCount)
+{
+    BOUNDS bounds;
+    float radiusSquared = 0.0f;
+
+    bounds.minimum = glm::vec3(0.0f);
+    bounds.maximum = glm::vec3(0.0f);
+
+    if (vertexCount > 0)
+    {
+        bounds.minimum = vertices[0].position;
+        bounds.maximum = vertices[0].position;
+    }
+    for (size_t i = 1; i < vertexCount; i++)
+    {
+        bounds.minimum = glm::min(bounds.minimum, vertices[i].position);
+        bounds.maximum = glm::max(bounds.maximum, vertices[i].position);
+    }
+
+    bounds.center = (bounds.minimum + bounds.maximum) * 0.5f;
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+        glm::vec3 offset = vertices[i].position - bounds.center;
+        radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+    }
+    bounds.radius = std::sqrt(radiusSquared);
+
+    return(bounds);
+}
+
+/***********************************************************
+ *  TransformBounds()
+ *
+ *  This method is used for placing the bounds of a mesh in
+ *  the world.  The new box holds the transformed box, its
+ *  extent along each world axis is the sum of the extents of
+ *  the model axes projected on that axis.  The sphere radius
+ *  grows by the largest scale of the model matrix.
+ ***********************************************************/
+SceneBVH::BOUNDS SceneBVH::TransformBounds(const BOUNDS& meshBounds, const glm::mat4& model)
+{
+    BOUNDS bounds;
+    glm::vec3 boxCenter = (meshBounds.minimum + meshBounds.maximum) * 0.5f;
+    glm::vec3 boxExtent = (meshBounds.maximum - meshBounds.minimum) * 0.5f;
+    glm::vec3 worldCenter = glm::vec3(model * glm::vec4(boxCenter, 1.0f));
+    glm::vec3 worldExtent = glm::vec3(0.0f);
+    float maxScaleSquared = 0.0f;
+
+    for (int column = 0; column < 3; column++)
+    {
+        glm::vec3 axis = glm::vec3(model[column]);
+
+        worldExtent += glm::abs(axis) * boxExtent[column];
+        maxScaleSquared = std::max(maxScaleSquared, glm::dot(axis, axis));
+    }
+
+    bounds.minimum = worldCenter - worldExtent;
+    bounds.maximum = worldCenter + worldExtent;
+    bounds.center = glm::vec3(model * glm::vec4(meshBounds.center, 1.0f));
+    bounds.radius = meshBounds.radius * std::sqrt(maxScaleSquared);
+
+    return(bounds);
+}
+
+/***********************************************************
+ *  ExtractFrustum()
+ *
+ *  This method is used for recovering the six planes of the
+ *  view frustum from a view-projection matrix.  A point is
+ *  inside the clip volume when -w <= x, y, z <= w, so every
+ *  plane is the sum or the difference of the fourth row and
+ *  one of the other rows.  The planes are normalized, so the
+ *  plane equation gives the distance in world units.
+ ***********************************************************/
+SceneBVH::FRUSTUM SceneBVH::ExtractFrustum(const glm::mat4& viewProjection)
+{
+    FRUSTUM frustum;
+    glm::vec4 rows[4];
+
+    // the matrix is stored in columns
+    for (int i = 0; i < 4; i++)
+    {
+        rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    }
+
+    // left, right, bottom, top, near and far
+    frustum.planes[0] = rows[3] + rows[0];
+    frustum.planes[1] = rows[3] - rows[0];
+    frustum.planes[2] = rows[3] + rows[1];
+    frustum.planes[3] = rows[3] - rows[1];
+    frustum.planes[4] = rows[3] + rows[2];
+    frustum.planes[5] = rows[3] - rows[2];
+
+    for (int i = 0; i < 6; i++)
+    {
+        float length = glm::length(glm::vec3(frustum.planes[i]));
+
+        if (length > 0.0f)
+        {
+            frustum.planes[i] = frustum.planes[i] * (1.0f / length);
+        }
+    }
+
+    return(frustum);
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for building a new tree over the
+ *  bounds of all of the objects.  It is only needed when the
+ *  number of objects changes, moved objects are refit.
+ ***********************************************************/
+void SceneBVH::Build(const BOUNDS* objectBounds, size_t objectCount)
+{
+    m_nodes.clear();
+    m_objectBounds.assign(objectBounds, objectBounds + objectCount);
+    m_objectOrder.resize(objectCount);
+    m_objectLeaves.assign(objectCount, -1);
+
+    for (size_t i = 0; i < objectCount; i++)
+    {
+        m_objectOrder[i] = (uint32_t)i;
+    }
+
+    if (objectCount > 0)
+    {
+        // a balanced tree of small leaves has less than half
+        // as many nodes as objects
+        m_nodes.reserve(objectCount);
+        BuildNode(0, (uint32_t)objectCount, -1);
+    }
+}
+
+/***********************************************************
+ *  BuildNode()
+ *
+ *  This method is used for building the subtree of a range of
+ *  the object order.  The range is split at its median along
+ *  the longest axis of the box around the object centers, so
+ *  the tree stays balanced.  Returns the index of the node.
+ ***********************************************************/
+int32_t SceneBVH::BuildNode(uint32_t firstObject, uint32_t objectCount, int32_t parent)
+{
+    int32_t nodeIndex = (int32_t)m_nodes.size();
+    NODE node;
+
+    node.firstObject = firstObject;
+    node.objectCount = objectCount;
+    node.left = -1;
+    node.right = -1;
+    node.parent = parent;
+    m_nodes.push_back(node);
+
+    if (objectCount <= MAX_LEAF_OBJECTS)
+    {
+        for (uint32_t i = 0; i < objectCount; i++)
+        {
+            m_objectLeaves[m_objectOrder[firstObject + i]] = nodeIndex;
+        }
+        FitNode(m_nodes[nodeIndex]);
+
+        return(nodeIndex);
+    }
+
+    // box around the centers of the objects of the range
+    std::vector<uint32_t>::iterator first = m_objectOrder.begin() + firstObject;
+    std::vector<uint32_t>::iterator last = first + objectCount;
+    glm::vec3 centerMin = m_objectBounds[*first].center;
+    glm::vec3 centerMax = centerMin;
+
+    for (std::vector<uint32_t>::iterator it = first; it != last; ++it)
+    {
+        centerMin = glm::min(centerMin, m_objectBounds[*it].center);
+        centerMax = glm::max(centerMax, m_objectBounds[*it].center);
+    }
+
+    glm::vec3 size = centerMax - centerMin;
+    int axis = 0;
+    if (size.y > size[axis])
+    {
+        axis = 1;
+    }
+    if (size.z > size[axis])
+    {
+        axis = 2;
+    }
+
+    uint32_t half = objectCount / 2;
+    const std::vector<BOUNDS>& bounds = m_objectBounds;
+    std::nth_element(first, first + half, last,
+        [&bounds, axis](uint32_t a, uint32_t b)
+        {
+            return(bounds[a].center[axis] < bounds[b].center[axis]);
+        });
+
+    // the node vector grows while the children are built, so
+    // the node is only accessed by index afterwards
+    int32_t left = BuildNode(firstObject, half, nodeIndex);
+    int32_t right = BuildNode(firstObject + half, objectCount - half, nodeIndex);
+    m_nodes[nodeIndex].left = left;
+    m_nodes[nodeIndex].right = right;
+    FitNode(m_nodes[nodeIndex]);
+
+    return(nodeIndex);
+}
+
+/***********************************************************
+ *  FitNode()
+ *
+ *  This method is used for fitting the box of a leaf around
+ *  the boxes of its objects, and the box of an inner node
+ *  around the boxes of its two children.
+ ***********************************************************/
+void SceneBVH::FitNode(NODE& node) const
+{
+    if (node.left < 0)
+    {
+        const BOUNDS& firstBounds = m_objectBounds[m_objectOrder[node.firstObject]];
+
+        node.minimum = firstBounds.minimum;
+        node.maximum = firstBounds.maximum;
+        for (uint32_t i = 1; i < node.objectCount; i++)
+        {
+            const BOUNDS& bounds = m_objectBounds[m_objectOrder[node.firstObject + i]];
+
+            node.minimum = glm::min(node.minimum, bounds.minimum);
+            node.maximum = glm::max(node.maximum, bounds.maximum);
+        }
+    }
+    else
+    {
+        const NODE& left = m_nodes[node.left];
+        const NODE& right = m_nodes[node.right];
+
+        node.minimum = glm::min(left.minimum, right.minimum);
+        node.maximum = glm::max(left.maximum, right.maximum);
+    }
+}
+
+/***********************************************************
+ *  UpdateObject()
+ *
+ *  This method is used for changing the bounds of a moved
+ *  object.  The leaf of the object and its ancestors are refit
+ *  up to the first node whose box does not change.  The shape
+ *  of the tree is kept, so it becomes looser when objects move
+ *  far, until the tree is built again.
+ ***********************************************************/
+void SceneBVH::UpdateObject(uint32_t objectIndex, const BOUNDS& bounds)
+{
+    if (objectIndex >= m_objectBounds.size())
+    {
+        return;
+    }
+
+    m_objectBounds[objectIndex] = bounds;
+
+    int32_t nodeIndex = m_objectLeaves[objectIndex];
+    while (nodeIndex >= 0)
+    {
+        NODE& node = m_nodes[nodeIndex];
+        glm::vec3 oldMinimum = node.minimum;
+        glm::vec3 oldMaximum = node.maximum;
+
+        FitNode(node);
+        if ((node.minimum == oldMinimum) && (node.maximum == oldMaximum))
+        {
+            break;
+        }
+
+        nodeIndex = node.parent;
+    }
+}
+
+/***********************************************************
+ *  GetObjectCount()
+ *
+ *  This method returns the number of objects in the tree.
+ ***********************************************************/
+size_t SceneBVH::GetObjectCount() const
+{
+    return(m_objectBounds.size());
+}
+
+/***********************************************************
+ *  GetObjectBounds()
+ *
+ *  This method returns the world bounds of an object.
+ ***********************************************************/
+const SceneBVH::BOUNDS& SceneBVH::GetObjectBounds(uint32_t objectIndex) const
+{
+    return(m_objectBounds[objectIndex]);
+}
+
+/***********************************************************
+ *  Cull()
+ *
+ *  This method is used for collecting the indices of all of
+ *  the objects that can be seen through the frustum.  Subtrees
+ *  outside of a plane are skipped, subtrees fully inside are
+ *  accepted without more tests, and only the objects of the
+ *  leaves that cross a plane are tested one at a time - first
+ *  with the cheaper sphere and then with the tighter box.
+ ***********************************************************/
+void SceneBVH::Cull(const FRUSTUM& frustum, std::vector<uint32_t>& visibleObjects, CULL_STATS& stats) const
+{
+    int32_t stackNodes[MAX_TREE_DEPTH];
+    uint32_t stackMasks[MAX_TREE_DEPTH];
+    int stackSize = 0;
+
+    visibleObjects.clear();
+    stats.objectCount = (uint32_t)m_objectBounds.size();
+    stats.nodesTested = 0;
+    stats.objectsTested = 0;
+    stats.objectsCulled = 0;
+
+    if (m_nodes.empty() == false)
+    {
+        stackNodes[0] = 0;
+        stackMasks[0] = ALL_PLANES;
+        stackSize = 1;
+    }
+
+    while (stackSize > 0)
+    {
+        stackSize--;
+        const NODE& node = m_nodes[stackNodes[stackSize]];
+        uint32_t planeMask = stackMasks[stackSize];
+
+        stats.nodesTested++;
+        if (ClassifyBox(frustum, node.minimum, node.maximum, planeMask) == false)
+        {
+            continue;
+        }
+
+        if (planeMask == 0)
+        {
+            visibleObjects.insert(
+                visibleObjects.end(),
+                m_objectOrder.begin() + node.firstObject,
+                m_objectOrder.begin() + node.firstObject + node.objectCount);
+        }
+        else if (node.left < 0)
+        {
+            for (uint32_t i = 0; i < node.objectCount; i++)
+            {
+                uint32_t objectIndex = m_objectOrder[node.firstObject + i];
+                const BOUNDS& bounds = m_objectBounds[objectIndex];
+                uint32_t objectMask = planeMask;
+
+                stats.objectsTested++;
+                if ((SphereOutside(frustum, bounds.center, bounds.radius, objectMask) == false) &&
+                    ClassifyBox(frustum, bounds.minimum, bounds.maximum, objectMask))
+                {
+                    visibleObjects.push_back(objectIndex);
+                }
+            }
+        }
+        else
+        {
+            stackNodes[stackSize] = node.left;
+            stackMasks[stackSize] = planeMask;
+            stackNodes[stackSize + 1] = node.right;
+            stackMasks[stackSize + 1] = planeMask;
+            stackSize += 2;
+        }
+    }
+
+    stats.objectsCulled = stats.objectCount - (uint32_t)visibleObjects.size();
+}
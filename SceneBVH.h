@@ -0,0 +1,107 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenebvh.h
+// ============
+// bounding volume hierarchy used for culling the scene objects
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShapeGeometry.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  SceneBVH
+ *
+ *  This class keeps the bounds of every scene object in a
+ *  binary tree of axis aligned boxes, so the objects outside
+ *  of the view frustum are rejected a whole subtree at a time.
+ *  The tree is built one time for a set of objects and refit
+ *  when an object moves, which only walks the path from the
+ *  leaf of the object up to the root.  The objects of every
+ *  node are kept next to each other, so a node that is fully
+ *  inside the frustum is accepted without testing its objects.
+ ***********************************************************/
+class SceneBVH
+{
+public:
+    // constructor
+    SceneBVH();
+
+    // bounding box and bounding sphere of a mesh or an object
+    struct BOUNDS
+    {
+        glm::vec3 minimum;
+        glm::vec3 maximum;
+        glm::vec3 center;
+        float radius;
+    };
+
+    // planes of a view frustum, pointing into the frustum
+    struct FRUSTUM
+    {
+        glm::vec4 planes[6];
+    };
+
+    // culling results of one frame
+    struct CULL_STATS
+    {
+        uint32_t objectCount;
+        uint32_t nodesTested;
+        uint32_t objectsTested;
+        uint32_t objectsCulled;
+    };
+
+    // bounds of the vertices of a mesh in model space
+    static BOUNDS ComputeMeshBounds(const ShapeGeometry::MESH_DATA& mesh);
+    static BOUNDS ComputeMeshBounds(const ShapeGeometry::MESH_VERTEX* vertices, size_t vertexCount);
+    // bounds of a mesh placed in the world by a model matrix
+    static BOUNDS TransformBounds(const BOUNDS& meshBounds, const glm::mat4& model);
+    // planes of the frustum of a view-projection matrix
+    static FRUSTUM ExtractFrustum(const glm::mat4& viewProjection);
+
+    // build the tree over the bounds of all of the objects
+    void Build(const BOUNDS* objectBounds, size_t objectCount);
+    // change the bounds of an object and refit its ancestors
+    void UpdateObject(uint32_t objectIndex, const BOUNDS& bounds);
+    // number of objects in the tree
+    size_t GetObjectCount() const;
+    // world bounds of an object
+    const BOUNDS& GetObjectBounds(uint32_t objectIndex) const;
+
+    // collect the indices of the objects inside the frustum
+    void Cull(const FRUSTUM& frustum, std::vector<uint32_t>& visibleObjects, CULL_STATS& stats) const;
+
+private:
+    // one node of the tree, covering a range of the objects
+    struct NODE
+    {
+        glm::vec3 minimum;
+        glm::vec3 maximum;
+        // first object of the node in the object order
+        uint32_t firstObject;
+        uint32_t objectCount;
+        // child nodes, -1 when the node is a leaf
+        int32_t left;
+        int32_t right;
+        int32_t parent;
+    };
+
+    // nodes of the tree, the root is the first node
+    std::vector<NODE> m_nodes;
+    // object indices, ordered so every node covers one range
+    std::vector<uint32_t> m_objectOrder;
+    // bounds of the objects, indexed by object index
+    std::vector<BOUNDS> m_objectBounds;
+    // leaf node of each object, indexed by object index
+    std::vector<int32_t> m_objectLeaves;
+
+    // split a range of the object order into a subtree
+    int32_t BuildNode(uint32_t firstObject, uint32_t objectCount, int32_t parent);
+    // fit the box of a node around its objects or children
+    void FitNode(NODE& node) const;
+};
@@ -0,0 +1,1004 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenebenchmark.cpp
+// ============
+// headless benchmark that renders the scene offscreen along a camera path
+//
+//  usage: SceneBenchmark [--frames N] [--warmup N] [--width W] [--height H]
+//                        [--path <camera path>] [--output <json file>]
+//                        [--trace <trace file>] [--scene <scene file>]
+//                        [--objects N | --sweep <max objects>] [--seed S]
+//                        [--meshes <mesh:weight,...>] [--textures N]
+//                        [--materials N] [--textured F] [--moving F]
+//                        [--move-interval N] [--jobs N]
+//
+//  The scene is rendered into an offscreen framebuffer, so no
+//  display is needed.  On Windows the context comes from a
+//  hidden GLFW window, and elsewhere from EGL, which also runs
+//  on the Mesa software rasterizer with LIBGL_ALWAYS_SOFTWARE=1.
+//  Every line of a camera path file holds one key as a camera
+//  position and a target, as six numbers.  Empty lines and
+//  lines starting with # are skipped.  The camera moves through
+//  the keys at an even speed over the measured frames.
+//
+//  With --objects the scene is filled with that many generated
+//  objects, and with --sweep it is measured again and again with
+//  1k, 2k, 5k, 10k and so on generated objects up to the largest
+//  count, which gives the frame times against the object count.
+//  The mesh types are a list of mesh names of the scene file
+//  format with optional weights, such as sphere:3,box:1.  The
+//  camera circles the generated field unless a path is passed.
+//  With --jobs the CPU stages of the frames are split over that
+//  many threads, which shows how they scale with the cores.
+//  The heap allocations of the measured frames are counted on
+//  every thread, and a run writes them per frame, which is zero
+//  while the frames allocate nothing.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <GL/glew.h>        // GLEW library
+
+#if defined(_WIN32)
+#include "GLFW/glfw3.h"     // GLFW library
+#else
+#include <EGL/egl.h>        // EGL library
+#include <EGL/eglext.h>
+#endif
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "SceneManager.h"
+#include "ViewManager.h"
+#include "ShaderManager.h"
+#include "FrameProfiler.h"
+#include "AllocationCounter.h"
+#include "SceneFile.h"
+#include "SceneGenerator.h"
+#include "GLStateCache.h"
+
+// declaration of the global variables and defines
+namespace
+{
+    // frames that can be queued before the CPU waits for the
+    // GPU, like a swap chain, which keeps every frame's queries
+    // readable before the profiler reuses them
+    const int FRAMES_IN_FLIGHT = FrameProfiler::FRAME_LATENCY - 1;
+
+    // one key of the camera path
+    struct CAMERA_KEY
+    {
+        glm::vec3 position;
+        glm::vec3 target;
+    };
+
+    // default camera path, around the table and past the objects
+    const CAMERA_KEY DEFAULT_CAMERA_PATH[] =
+    {
+        { glm::vec3(0.0f, 5.0f, 12.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+        { glm::vec3(-12.0f, 4.0f, 6.0f), glm::vec3(-3.0f, 1.0f, 0.0f) },
+        { glm::vec3(-6.0f, 2.0f, 6.0f), glm::vec3(-8.0f, 0.5f, 2.5f) },
+        { glm::vec3(-2.0f, 6.0f, -9.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+        { glm::vec3(10.0f, 3.0f, 7.0f), glm::vec3(6.5f, 1.0f, 2.0f) },
+        { glm::vec3(0.0f, 5.0f, 12.0f), glm::vec3(0.0f, 1.0f, 0.0f) }
+    };
+
+    // smallest object count of a sweep, the counts then go up
+    // in steps of 1, 2 and 5 times a power of ten
+    const size_t SWEEP_FIRST_COUNT = 1000;
+
+    // settings read from the command line
+    struct BENCHMARK_SETTINGS
+    {
+        int frameCount;
+        int warmupFrames;
+        int width;
+        int height;
+        const char* pathFileName;
+        const char* outputFileName;
+        const char* traceFileName;
+        const char* sceneFileName;
+        // set when the scene is filled with generated objects
+        bool bGenerate;
+        // largest object count of a sweep, 0 without a sweep
+        size_t sweepMaxObjects;
+        SceneGenerator::GENERATOR_SETTINGS generator;
+        // threads of the frame stages, 0 for one for each core
+        unsigned int jobThreads;
+    };
+
+    // frame times measured with one scene
+    struct BENCHMARK_RUN
+    {
+        size_t objectCount;
+        size_t movingCount;
+        size_t triangleCount;
+        unsigned int jobThreads;
+        uint64_t droppedGpuFrames;
+        // state calls of the measured frames
+        GLStateCache::GL_STATE_STATS glStateStats;
+        // heap allocations of the measured frames
+        uint64_t allocations;
+        std::vector<double> cpuTimes;
+        std::vector<double> gpuTimes;
+    };
+
+#if defined(_WIN32)
+    // hidden window that only provides the OpenGL context
+    GLFWwindow* g_Window = nullptr;
+#else
+    // EGL display, context and the small surface it is made
+    // current with, which is never drawn to
+    EGLDisplay g_Display = EGL_NO_DISPLAY;
+    EGLContext g_Context = EGL_NO_CONTEXT;
+    EGLSurface g_Surface = EGL_NO_SURFACE;
+#endif
+
+    // offscreen framebuffer the scene is rendered into
+    GLuint g_Framebuffer = 0;
+    GLuint g_ColorBuffer = 0;
+    GLuint g_DepthBuffer = 0;
+
+    /***********************************************************
+     *  ParseMeshWeights()
+     *
+     *  This function is used for reading a list of mesh names
+     *  with optional weights, such as sphere:3,box:1, into the
+     *  mesh weights.  A mesh without a weight has a weight of
+     *  one, and the meshes that are not listed are not used.
+     ***********************************************************/
+    bool ParseMeshWeights(const char* list, float* weights)
+    {
+        std::istringstream items(list);
+        std::string item;
+
+        for (int meshType = 0; meshType < SceneManager::MESH_COUNT; meshType++)
+        {
+            weights[meshType] = 0.0f;
+        }
+
+        while (std::getline(items, item, ','))
+        {
+            size_t separator = item.find(':');
+            int meshType = SceneFile::FindMeshName(item.substr(0, separator).c_str());
+            float weight = (std::string::npos != separator) ? (float)atof(item.c_str() + separator + 1) : 1.0f;
+
+            if ((meshType < 0) || (weight < 0.0f))
+            {
+                std::cout << "Invalid mesh weight:" << item << std::endl;
+                return(false);
+            }
+            weights[meshType] = weight;
+        }
+
+        return(true);
+    }
+
+    /***********************************************************
+     *  ParseSettings()
+     *
+     *  This function is used for reading the settings from the
+     *  command line.  Returns false for an unknown option or a
+     *  missing or invalid value.
+     ***********************************************************/
+    bool ParseSettings(int argc, char* argv[], BENCHMARK_SETTINGS& settings)
+    {
+        settings.frameCount = 1000;
+        settings.warmupFrames = 60;
+        settings.width = 1280;
+        settings.height = 720;
+        settings.pathFileName = NULL;
+        settings.outputFileName = "benchmark.json";
+        settings.traceFileName = NULL;
+        settings.sceneFileName = NULL;
+        settings.bGenerate = false;
+        settings.sweepMaxObjects = 0;
+        settings.generator = SceneGenerator::GetDefaultSettings(0);
+        settings.jobThreads = 0;
+
+        for (int i = 1; i < argc; i++)
+        {
+            if (i + 1 >= argc)
+            {
+                return(false);
+            }
+
+            const char* option = argv[i];
+            const char* value = argv[++i];
+
+            if (0 == strcmp(option, "--frames"))
+            {
+                settings.frameCount = atoi(value);
+            }
+            else if (0 == strcmp(option, "--warmup"))
+            {
+                settings.warmupFrames = atoi(value);
+            }
+            else if (0 == strcmp(option, "--width"))
+            {
+                settings.width = atoi(value);
+            }
+            else if (0 == strcmp(option, "--height"))
+            {
+                settings.height = atoi(value);
+            }
+            else if (0 == strcmp(option, "--path"))
+            {
+                settings.pathFileName = value;
+            }
+            else if (0 == strcmp(option, "--output"))
+            {
+                settings.outputFileName = value;
+            }
+            else if (0 == strcmp(option, "--trace"))
+            {
+                settings.traceFileName = value;
+            }
+            else if (0 == strcmp(option, "--scene"))
+            {
+                settings.sceneFileName = value;
+            }
+            else if (0 == strcmp(option, "--objects"))
+            {
+                settings.bGenerate = true;
+                settings.generator.objectCount = (size_t)atol(value);
+            }
+            else if (0 == strcmp(option, "--sweep"))
+            {
+                settings.bGenerate = true;
+                settings.sweepMaxObjects = (size_t)atol(value);
+            }
+            else if (0 == strcmp(option, "--seed"))
+            {
+                settings.generator.seed = (uint32_t)strtoul(value, NULL, 10);
+            }
+            else if (0 == strcmp(option, "--meshes"))
+            {
+                if (ParseMeshWeights(value, settings.generator.meshWeights) == false)
+                {
+                    return(false);
+                }
+            }
+            else if (0 == strcmp(option, "--textures"))
+            {
+                settings.generator.textureVariety = atoi(value);
+            }
+            else if (0 == strcmp(option, "--materials"))
+            {
+                settings.generator.materialVariety = atoi(value);
+            }
+            else if (0 == strcmp(option, "--textured"))
+            {
+                settings.generator.texturedFraction = (float)atof(value);
+            }
+            else if (0 == strcmp(option, "--moving"))
+            {
+                settings.generator.movingFraction = (float)atof(value);
+            }
+            else if (0 == strcmp(option, "--move-interval"))
+            {
+                settings.generator.moveInterval = atoi(value);
+            }
+            else if (0 == strcmp(option, "--jobs"))
+            {
+                settings.jobThreads = (unsigned int)atoi(value);
+            }
+            else
+            {
+                return(false);
+            }
+        }
+
+        if (settings.bGenerate &&
+            (((settings.sweepMaxObjects == 0) && (settings.generator.objectCount == 0)) ||
+            ((settings.sweepMaxObjects > 0) && (settings.sweepMaxObjects < SWEEP_FIRST_COUNT))))
+        {
+            return(false);
+        }
+
+        return((settings.frameCount > 0) && (settings.warmupFrames >= 0) &&
+            (settings.width > 0) && (settings.height > 0));
+    }
+
+    /***********************************************************
+     *  LoadCameraPath()
+     *
+     *  This function is used for reading the keys of a camera
+     *  path file, or for using the default path when no file
+     *  is passed in.  A path needs at least one key.
+     ***********************************************************/
+    bool LoadCameraPath(const char* filename, std::vector<CAMERA_KEY>& keys)
+    {
+        if (NULL == filename)
+        {
+            keys.assign(
+                DEFAULT_CAMERA_PATH,
+                DEFAULT_CAMERA_PATH + sizeof(DEFAULT_CAMERA_PATH) / sizeof(DEFAULT_CAMERA_PATH[0]));
+            return(true);
+        }
+
+        std::ifstream file(filename);
+        if (!file)
+        {
+            std::cout << "Could not open camera path:" << filename << std::endl;
+            return(false);
+        }
+
+        std::string line;
+        while (std::getline(file, line))
+        {
+            std::istringstream fields(line);
+            CAMERA_KEY key;
+
+            if ((line.find_first_not_of(" \t\r") == std::string::npos) ||
+                (line[line.find_first_not_of(" \t\r")] == '#'))
+            {
+                continue;
+            }
+            if (!(fields >> key.position.x >> key.position.y >> key.position.z >>
+                key.target.x >> key.target.y >> key.target.z))
+            {
+                std::cout << "Invalid camera path key:" << line << std::endl;
+                return(false);
+            }
+            keys.push_back(key);
+        }
+
+        if (keys.empty())
+        {
+            std::cout << "Camera path has no keys:" << filename << std::endl;
+            return(false);
+        }
+
+        return(true);
+    }
+
+    /***********************************************************
+     *  GetPathKey()
+     *
+     *  This function returns the camera at a point of the path
+     *  from 0 at the first key to 1 at the last key, blending
+     *  the two keys around it.
+     ***********************************************************/
+    CAMERA_KEY GetPathKey(const std::vector<CAMERA_KEY>& keys, float t)
+    {
+        if (keys.size() == 1)
+        {
+            return(keys[0]);
+        }
+
+        float position = glm::clamp(t, 0.0f, 1.0f) * (float)(keys.size() - 1);
+        size_t first = (size_t)position;
+        if (first >= keys.size() - 1)
+        {
+            first = keys.size() - 2;
+        }
+        float blend = position - (float)first;
+
+        CAMERA_KEY key;
+        key.position = glm::mix(keys[first].position, keys[first + 1].position, blend);
+        key.target = glm::mix(keys[first].target, keys[first + 1].target, blend);
+
+        return(key);
+    }
+
+    /***********************************************************
+     *  CreateOffscreenContext()
+     *
+     *  This function is used for creating an OpenGL 4.6 core
+     *  context that is not shown on any display.
+     ***********************************************************/
+    bool CreateOffscreenContext()
+    {
+#if defined(_WIN32)
+        if (glfwInit() == GLFW_FALSE)
+        {
+            std::cout << "Failed to initialize GLFW" << std::endl;
+            return(false);
+        }
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+        g_Window = glfwCreateWindow(16, 16, "SceneBenchmark", NULL, NULL);
+        if (NULL == g_Window)
+        {
+            std::cout << "Failed to create the hidden GLFW window" << std::endl;
+            return(false);
+        }
+        glfwMakeContextCurrent(g_Window);
+        // the window is never presented, so nothing waits for vsync
+        glfwSwapInterval(0);
+#else
+        EGLint major = 0;
+        EGLint minor = 0;
+
+        g_Display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if ((EGL_NO_DISPLAY == g_Display) || (eglInitialize(g_Display, &major, &minor) == EGL_FALSE))
+        {
+            std::cout << "Failed to initialize EGL" << std::endl;
+            return(false);
+        }
+
+        const EGLint configAttributes[] =
+        {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_RED_SIZE, 8,
+            EGL_GREEN_SIZE, 8,
+            EGL_BLUE_SIZE, 8,
+            EGL_DEPTH_SIZE, 24,
+            EGL_NONE
+        };
+        EGLConfig config = NULL;
+        EGLint configCount = 0;
+        if ((eglChooseConfig(g_Display, configAttributes, &config, 1, &configCount) == EGL_FALSE) ||
+            (configCount == 0))
+        {
+            std::cout << "No EGL config supports OpenGL rendering" << std::endl;
+            return(false);
+        }
+
+        const EGLint surfaceAttributes[] =
+        {
+            EGL_WIDTH, 16,
+            EGL_HEIGHT, 16,
+            EGL_NONE
+        };
+        g_Surface = eglCreatePbufferSurface(g_Display, config, surfaceAttributes);
+
+        const EGLint contextAttributes[] =
+        {
+            EGL_CONTEXT_MAJOR_VERSION, 4,
+            EGL_CONTEXT_MINOR_VERSION, 6,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        eglBindAPI(EGL_OPENGL_API);
+        g_Context = eglCreateContext(g_Display, config, EGL_NO_CONTEXT, contextAttributes);
+        if ((EGL_NO_SURFACE == g_Surface) || (EGL_NO_CONTEXT == g_Context) ||
+            (eglMakeCurrent(g_Display, g_Surface, g_Surface, g_Context) == EGL_FALSE))
+        {
+            std::cout << "Failed to create an OpenGL 4.6 core context with EGL " << major << "." << minor << std::endl;
+            return(false);
+        }
+        eglSwapInterval(g_Display, 0);
+#endif
+
+        // GLEW also looks for GLX, which an EGL context without a
+        // display does not have, after it has loaded the functions
+        glewExperimental = GL_TRUE;
+        GLenum result = glewInit();
+#if defined(GLEW_ERROR_NO_GLX_DISPLAY)
+        if (GLEW_ERROR_NO_GLX_DISPLAY == result)
+        {
+            result = GLEW_OK;
+        }
+#endif
+        if (GLEW_OK != result)
+        {
+            std::cout << glewGetErrorString(result) << std::endl;
+            return(false);
+        }
+
+        return(true);
+    }
+
+    /***********************************************************
+     *  DestroyOffscreenContext()
+     *
+     *  This function is used for releasing the context.
+     ***********************************************************/
+    void DestroyOffscreenContext()
+    {
+#if defined(_WIN32)
+        if (NULL != g_Window)
+        {
+            glfwDestroyWindow(g_Window);
+            g_Window = NULL;
+        }
+        glfwTerminate();
+#else
+        if (EGL_NO_DISPLAY != g_Display)
+        {
+            eglMakeCurrent(g_Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            if (EGL_NO_CONTEXT != g_Context)
+            {
+                eglDestroyContext(g_Display, g_Context);
+            }
+            if (EGL_NO_SURFACE != g_Surface)
+            {
+                eglDestroySurface(g_Display, g_Surface);
+            }
+            eglTerminate(g_Display);
+        }
+        g_Display = EGL_NO_DISPLAY;
+        g_Context = EGL_NO_CONTEXT;
+        g_Surface = EGL_NO_SURFACE;
+#endif
+    }
+
+    /***********************************************************
+     *  CreateOffscreenFramebuffer()
+     *
+     *  This function is used for creating the framebuffer the
+     *  scene is rendered into, and binding it for drawing and
+     *  for the depth read back of the occlusion culling.
+     ***********************************************************/
+    bool CreateOffscreenFramebuffer(int width, int height)
+    {
+        glGenRenderbuffers(1, &g_ColorBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, g_ColorBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glGenRenderbuffers(1, &g_DepthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, g_DepthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glGenFramebuffers(1, &g_Framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, g_Framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, g_ColorBuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, g_DepthBuffer);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            std::cout << "The offscreen framebuffer is not complete" << std::endl;
+            return(false);
+        }
+
+        return(true);
+    }
+
+    /***********************************************************
+     *  DestroyOffscreenFramebuffer()
+     *
+     *  This function is used for deleting the framebuffer.
+     ***********************************************************/
+    void DestroyOffscreenFramebuffer()
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &g_Framebuffer);
+        glDeleteRenderbuffers(1, &g_ColorBuffer);
+        glDeleteRenderbuffers(1, &g_DepthBuffer);
+        g_Framebuffer = 0;
+        g_ColorBuffer = 0;
+        g_DepthBuffer = 0;
+    }
+
+    /***********************************************************
+     *  WriteJsonString()
+     *
+     *  This function is used for writing a string as a quoted
+     *  JSON string, escaping the characters that need it.
+     ***********************************************************/
+    void WriteJsonString(std::ostream& stream, const char* text)
+    {
+        stream << '"';
+        for (const char* c = (NULL != text) ? text : ""; *c != '\0'; c++)
+        {
+            if ((*c == '"') || (*c == '\\'))
+            {
+                stream << '\\' << *c;
+            }
+            else if ((unsigned char)*c >= 0x20)
+            {
+                stream << *c;
+            }
+        }
+        stream << '"';
+    }
+
+    /***********************************************************
+     *  WriteSummary()
+     *
+     *  This function is used for writing the percentiles, mean
+     *  and largest value of a list of frame times as a JSON
+     *  object.
+     ***********************************************************/
+    void WriteSummary(std::ostream& stream, const std::vector<double>& times)
+    {
+        FrameProfiler::FRAME_PERCENTILES percentiles = FrameProfiler::GetPercentiles(times);
+        double total = 0.0;
+        double largest = 0.0;
+
+        for (size_t i = 0; i < times.size(); i++)
+        {
+            total += times[i];
+            largest = (times[i] > largest) ? times[i] : largest;
+        }
+
+        stream << "{\"frames\":" << percentiles.frameCount
+            << ",\"mean\":" << (times.empty() ? 0.0 : total / times.size())
+            << ",\"p50\":" << percentiles.p50
+            << ",\"p95\":" << percentiles.p95
+            << ",\"p99\":" << percentiles.p99
+            << ",\"max\":" << largest << "}";
+    }
+
+    /***********************************************************
+     *  WriteRunSummary()
+     *
+     *  This function is used for writing the object counts,
+     *  triangles and the CPU and GPU summaries of a run as the
+     *  members of a JSON object.
+     ***********************************************************/
+    void WriteRunSummary(std::ostream& stream, const BENCHMARK_RUN& run)
+    {
+        stream << "\"objects\":" << run.objectCount
+            << ",\"movingObjects\":" << run.movingCount
+            << ",\"jobThreads\":" << run.jobThreads
+            << ",\"frameCount\":" << run.cpuTimes.size()
+            << ",\"lastFrameTriangles\":" << run.triangleCount
+            << ",\"droppedGpuFrames\":" << run.droppedGpuFrames
+            << ",\"glCallsIssued\":" << run.glStateStats.callsIssued
+            << ",\"glCallsFiltered\":" << run.glStateStats.callsFiltered
+            << ",\"allocationsPerFrame\":" << (run.cpuTimes.empty() ? 0.0 : (double)run.allocations / run.cpuTimes.size())
+            << ",\"cpuMilliseconds\":";
+        WriteSummary(stream, run.cpuTimes);
+        stream << ",\"gpuMilliseconds\":";
+        WriteSummary(stream, run.gpuTimes);
+    }
+
+    /***********************************************************
+     *  WriteResults()
+     *
+     *  This function is used for writing the results as a JSON
+     *  file.  A single run has the times of every measured
+     *  frame, where a frame without a GPU time has null for it,
+     *  and a sweep has the summaries of every object count.
+     ***********************************************************/
+    bool WriteResults(
+        const BENCHMARK_SETTINGS& settings,
+        const FrameProfiler& profiler,
+        const std::vector<BENCHMARK_RUN>& runs)
+    {
+        std::ofstream file(settings.outputFileName);
+        if (!file.is_open())
+        {
+            std::cout << "Could not write the benchmark results:" << settings.outputFileName << std::endl;
+            return(false);
+        }
+
+        file << std::fixed << std::setprecision(4);
+        file << "{\n\"renderer\":";
+        WriteJsonString(file, (const char*)glGetString(GL_RENDERER));
+        file << ",\n\"version\":";
+        WriteJsonString(file, (const char*)glGetString(GL_VERSION));
+        file << ",\n\"width\":" << settings.width
+            << ",\n\"height\":" << settings.height
+            << ",\n\"warmupFrames\":" << settings.warmupFrames;
+        if (settings.bGenerate)
+        {
+            file << ",\n\"seed\":" << settings.generator.seed;
+        }
+
+        if (settings.sweepMaxObjects > 0)
+        {
+            file << ",\n\"steps\":[";
+            for (size_t i = 0; i < runs.size(); i++)
+            {
+                file << ((i > 0) ? ",\n{" : "\n{");
+                WriteRunSummary(file, runs[i]);
+                file << "}";
+            }
+            file << "\n]\n}\n";
+        }
+        else
+        {
+            const std::vector<FrameProfiler::FRAME_TIMES>& log = profiler.GetFrameLog();
+
+            file << ",\n";
+            WriteRunSummary(file, runs[0]);
+            file << ",\n\"frames\":[";
+            for (size_t i = 0; i < log.size(); i++)
+            {
+                file << ((i > 0) ? ",\n" : "\n") << "{\"frame\":" << (i + 1) << ",\"cpu\":" << log[i].cpuMilliseconds << ",\"gpu\":";
+                if (log[i].gpuMilliseconds >= 0.0)
+                {
+                    file << log[i].gpuMilliseconds;
+                }
+                else
+                {
+                    file << "null";
+                }
+                file << "}";
+            }
+            file << "\n]\n}\n";
+        }
+
+        std::cout << "INFO: Benchmark results written to " << settings.outputFileName << std::endl;
+
+        return(file.good());
+    }
+
+    /***********************************************************
+     *  GetFieldCameraPath()
+     *
+     *  This function is used for making a camera path that
+     *  circles a generated field, looking at its center from
+     *  high enough that the far corners stay in view.
+     ***********************************************************/
+    void GetFieldCameraPath(float fieldSize, std::vector<CAMERA_KEY>& keys)
+    {
+        const int KEY_COUNT = 8;
+
+        keys.clear();
+        for (int i = 0; i <= KEY_COUNT; i++)
+        {
+            float angle = 6.2831853f * (float)i / (float)KEY_COUNT;
+            CAMERA_KEY key;
+
+            key.position = glm::vec3(0.5f * fieldSize * std::sin(angle), 0.25f * fieldSize, 0.5f * fieldSize * std::cos(angle));
+            key.target = glm::vec3(0.0f, 0.0f, 0.0f);
+            keys.push_back(key);
+        }
+    }
+
+    /***********************************************************
+     *  RunFrames()
+     *
+     *  This function is used for rendering the warm up frames
+     *  at the start of the camera path, and then the measured
+     *  frames along it.  The generated objects are moved every
+     *  frame when there is a generator.  The times of the
+     *  measured frames are kept in the run.
+     ***********************************************************/
+    void RunFrames(
+        const BENCHMARK_SETTINGS& settings,
+        const std::vector<CAMERA_KEY>& cameraPath,
+        ViewManager* pViewManager,
+        SceneManager* pSceneManager,
+        SceneGenerator* pGenerator,
+        FrameProfiler* pProfiler,
+        BENCHMARK_RUN& run)
+    {
+        uint64_t droppedGpuFrames = pProfiler->GetDroppedGpuFrames();
+        uint64_t firstAllocation = 0;
+        GLsync fences[FRAMES_IN_FLIGHT] = {};
+        int totalFrames = settings.warmupFrames + settings.frameCount;
+
+        for (int frame = 0; frame < totalFrames; frame++)
+        {
+            int measuredFrame = frame - settings.warmupFrames;
+
+            if (0 == measuredFrame)
+            {
+                pProfiler->SetFrameLogging(true);
+                GetGLStateCache().ResetStats();
+                firstAllocation = GetAllocationCount();
+            }
+            pProfiler->BeginFrame();
+
+            // wait for the frame that used this fence, like a swap
+            // chain that only has a few images
+            GLsync& fence = fences[frame % FRAMES_IN_FLIGHT];
+            if (NULL != fence)
+            {
+                ProfileScope scope(pProfiler, "WaitForGPU");
+                glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+                glDeleteSync(fence);
+                fence = NULL;
+            }
+
+            GetGLStateCache().Enable(GL_DEPTH_TEST);
+            GetGLStateCache().ClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            // the warm up frames stay at the start of the path
+            float t = 0.0f;
+            if ((measuredFrame > 0) && (settings.frameCount > 1))
+            {
+                t = (float)measuredFrame / (float)(settings.frameCount - 1);
+            }
+            CAMERA_KEY key = GetPathKey(cameraPath, t);
+
+            pProfiler->BeginScope("PrepareSceneView");
+            pViewManager->SetCameraLookAt(key.position, key.target);
+            pViewManager->PrepareSceneView();
+            pProfiler->EndScope();
+
+            pSceneManager->SetSceneView(
+                pViewManager->GetCameraBlock().view,
+                pViewManager->GetCameraBlock().projection,
+                settings.width,
+                settings.height);
+
+            if (NULL != pGenerator)
+            {
+                ProfileScope scope(pProfiler, "AnimateObjects");
+                pGenerator->Animate(pSceneManager, (uint64_t)frame);
+            }
+
+            pProfiler->BeginScope("RenderScene");
+            pSceneManager->RenderScene();
+            pProfiler->EndScope();
+
+            fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            pProfiler->EndFrame();
+        }
+        run.allocations = GetAllocationCount() - firstAllocation;
+
+        pProfiler->CollectPending();
+        pProfiler->SetFrameLogging(false);
+
+        for (int i = 0; i < FRAMES_IN_FLIGHT; i++)
+        {
+            if (NULL != fences[i])
+            {
+                glDeleteSync(fences[i]);
+            }
+        }
+
+        const std::vector<FrameProfiler::FRAME_TIMES>& log = pProfiler->GetFrameLog();
+        for (size_t i = 0; i < log.size(); i++)
+        {
+            run.cpuTimes.push_back(log[i].cpuMilliseconds);
+            if (log[i].gpuMilliseconds >= 0.0)
+            {
+                run.gpuTimes.push_back(log[i].gpuMilliseconds);
+            }
+        }
+        run.objectCount = pSceneManager->GetSceneObjectCount();
+        run.movingCount = (NULL != pGenerator) ? pGenerator->GetMovingCount() : 0;
+        run.jobThreads = pSceneManager->GetJobSystem()->GetThreadCount();
+        run.triangleCount = pSceneManager->GetFrameTriangleCount();
+        run.droppedGpuFrames = pProfiler->GetDroppedGpuFrames() - droppedGpuFrames;
+        run.glStateStats = GetGLStateCache().GetStats();
+
+        FrameProfiler::FRAME_PERCENTILES cpu = FrameProfiler::GetPercentiles(run.cpuTimes);
+        FrameProfiler::FRAME_PERCENTILES gpu = FrameProfiler::GetPercentiles(run.gpuTimes);
+        std::cout << "INFO: " << run.objectCount << " objects" << std::endl;
+        std::cout << "INFO: CPU ms p50 " << cpu.p50 << " p95 " << cpu.p95 << " p99 " << cpu.p99 << std::endl;
+        std::cout << "INFO: GPU ms p50 " << gpu.p50 << " p95 " << gpu.p95 << " p99 " << gpu.p99 << std::endl;
+        std::cout << "INFO: GL state calls issued " << run.glStateStats.callsIssued
+            << " filtered " << run.glStateStats.callsFiltered << std::endl;
+        std::cout << "INFO: heap allocations " << run.allocations << std::endl;
+    }
+}
+
+/***********************************************************
+ *  main(int, char*)
+ *
+ *  This function gets called after the benchmark has been
+ *  launched.  It measures the scene once, or once for every
+ *  object count of a sweep with a new scene each time.
+ *  Returns nonzero when the benchmark could not run.
+ ***********************************************************/
+int main(int argc, char* argv[])
+{
+    BENCHMARK_SETTINGS settings;
+    std::vector<CAMERA_KEY> cameraPath;
+
+    if (ParseSettings(argc, argv, settings) == false)
+    {
+        std::cout << "usage: SceneBenchmark [--frames N] [--warmup N] [--width W] [--height H]" << std::endl;
+        std::cout << "                      [--path <camera path>] [--output <json file>] [--trace <trace file>]" << std::endl;
+        std::cout << "                      [--scene <scene file>] [--objects N | --sweep <max objects>] [--seed S]" << std::endl;
+        std::cout << "                      [--meshes <mesh:weight,...>] [--textures N] [--materials N]" << std::endl;
+        std::cout << "                      [--textured F] [--moving F] [--move-interval N] [--jobs N]" << std::endl;
+        return(1);
+    }
+    if (settings.bGenerate && (NULL == settings.pathFileName))
+    {
+        GetFieldCameraPath(settings.generator.fieldSize, cameraPath);
+    }
+    else if (LoadCameraPath(settings.pathFileName, cameraPath) == false)
+    {
+        return(1);
+    }
+    if ((CreateOffscreenContext() == false) ||
+        (CreateOffscreenFramebuffer(settings.width, settings.height) == false))
+    {
+        DestroyOffscreenContext();
+        return(1);
+    }
+
+    std::cout << "INFO: OpenGL Renderer: " << glGetString(GL_RENDERER) << std::endl;
+    std::cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << std::endl;
+
+    // the object counts that are measured, one count without
+    // a sweep
+    std::vector<size_t> objectCounts;
+    if (settings.sweepMaxObjects > 0)
+    {
+        for (size_t decade = SWEEP_FIRST_COUNT; decade <= settings.sweepMaxObjects; decade *= 10)
+        {
+            const size_t STEPS[] = { 1, 2, 5 };
+
+            for (size_t i = 0; i < sizeof(STEPS) / sizeof(STEPS[0]); i++)
+            {
+                if (decade * STEPS[i] <= settings.sweepMaxObjects)
+                {
+                    objectCounts.push_back(decade * STEPS[i]);
+                }
+            }
+        }
+    }
+    else
+    {
+        objectCounts.push_back(settings.generator.objectCount);
+    }
+
+    // the managers are set up like the interactive application,
+    // with a viewport of the offscreen size instead of a window
+    ShaderManager* pShaderManager = new ShaderManager();
+    ViewManager* pViewManager = new ViewManager(pShaderManager);
+    FrameProfiler* pProfiler = new FrameProfiler();
+    std::vector<BENCHMARK_RUN> runs(objectCounts.size());
+
+    pViewManager->SetViewportSize(settings.width, settings.height);
+    pShaderManager->LoadShaders(
+        "Source/shaders/vertexShader.glsl",
+        "Source/shaders/fragmentShader.glsl");
+    pShaderManager->use();
+
+    // enable blending for supporting tranparent rendering
+    GetGLStateCache().Enable(GL_BLEND);
+    GetGLStateCache().BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    bool bLoaded = true;
+    for (size_t i = 0; (i < objectCounts.size()) && bLoaded; i++)
+    {
+        // every count starts from a new scene
+        SceneManager* pSceneManager = new SceneManager(pShaderManager);
+        SceneGenerator generator;
+
+        pSceneManager->SetFrameProfiler(pProfiler);
+        if (settings.jobThreads > 0)
+        {
+            pSceneManager->SetJobThreadCount(settings.jobThreads);
+        }
+        if ((NULL != settings.sceneFileName) && (pSceneManager->OpenSceneFile(settings.sceneFileName) == false))
+        {
+            std::cout << "Could not load the scene file:" << settings.sceneFileName << std::endl;
+            bLoaded = false;
+        }
+        else
+        {
+            pSceneManager->StartSceneLoading();
+            pSceneManager->PrepareScene();
+
+            if (settings.bGenerate)
+            {
+                SceneGenerator::GENERATOR_SETTINGS generatorSettings = settings.generator;
+
+                generatorSettings.objectCount = objectCounts[i];
+                generator.Generate(pSceneManager, generatorSettings);
+            }
+
+            RunFrames(
+                settings,
+                cameraPath,
+                pViewManager,
+                pSceneManager,
+                settings.bGenerate ? &generator : NULL,
+                pProfiler,
+                runs[i]);
+        }
+
+        delete pSceneManager;
+    }
+
+    bool bWritten = bLoaded && WriteResults(settings, *pProfiler, runs);
+    if (bLoaded && (NULL != settings.traceFileName) && (pProfiler->WriteTrace(settings.traceFileName) == false))
+    {
+        std::cout << "Could not write the frame trace:" << settings.traceFileName << std::endl;
+        bWritten = false;
+    }
+
+    delete pViewManager;
+    delete pShaderManager;
+    delete pProfiler;
+    DestroyOffscreenFramebuffer();
+    DestroyOffscreenContext();
+
+    return(bWritten ? 0 : 1);
+}
@@ -0,0 +1,668 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.cpp
+// ============
+// scene description with a text form and a compiled binary form
+//
+//  Every line of the text form holds one item of the scene, the
+//  values in brackets are optional and the other values are
+//  needed.  Empty lines and lines starting with # are skipped.
+//
+//  texture  <tag> <image file>
+//  material <tag> <ambient r g b> <ambient strength>
+//           <diffuse r g b> <specular r g b> <shininess>
+//  light    <position x y z> <ambient r g b> <diffuse r g b>
+//           <specular r g b> <focal strength> <specular intensity>
+//           <range>
+//  object   <mesh> <scale x y z> <rotation x y z> <position x y z>
+//           [texture <tag>] [color <r g b a>] [material <tag>]
+//           [uv <u v>]
+//
+//  The mesh is one of box, plane, cylinder, cone, prism, pyramid4,
+//  sphere, taperedCylinder and torus, and the rotation is in
+//  degrees.  An object without a texture is drawn with its color.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneFile.h"
+#include "ShapeGeometry.h"
+#include "TagRegistry.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// declaration of the global variables and defines
+namespace
+{
+    // texture or material tag named by an object of the text
+    // form, checked once the whole file has been read
+    struct TAG_REFERENCE
+    {
+        int lineNumber;
+        bool bTexture;
+        std::string tag;
+    };
+
+    // names of the meshes in the text form, indexed by shape
+    const char* const MESH_NAMES[ShapeGeometry::SHAPE_COUNT] =
+    {
+        "box",
+        "plane",
+        "cylinder",
+        "cone",
+        "prism",
+        "pyramid4",
+        "sphere",
+        "taperedCylinder",
+        "torus"
+    };
+
+    /***********************************************************
+     *  AddString()
+     *
+     *  This function is used for appending a string with its
+     *  terminating zero to a string block.  Returns the offset
+     *  of the string in the block.
+     ***********************************************************/
+    uint32_t AddString(std::string& strings, const std::string& text)
+    {
+        uint32_t offset = (uint32_t)strings.size();
+
+        strings.append(text);
+        strings.push_back('\0');
+
+        return(offset);
+    }
+
+    /***********************************************************
+     *  AppendTable()
+     *
+     *  This function is used for appending the records of a
+     *  table to a binary scene image.
+     ***********************************************************/
+    template <typename T>
+    void AppendTable(std::vector<unsigned char>& image, const std::vector<T>& records)
+    {
+        const unsigned char* pRecords = (const unsigned char*)records.data();
+
+        image.insert(image.end(), pRecords, pRecords + records.size() * sizeof(T));
+    }
+
+    /***********************************************************
+     *  ReadTextFile()
+     *
+     *  This function is used for reading the whole of a text
+     *  file into a string.  Returns false when the file can not
+     *  be opened.
+     ***********************************************************/
+    bool ReadTextFile(const char* filename, std::string& text)
+    {
+        std::ifstream file(filename);
+        if (!file)
+        {
+            return(false);
+        }
+
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        text = contents.str();
+
+        return(true);
+    }
+
+    /***********************************************************
+     *  HashText()
+     *
+     *  This function returns the FNV-1a hash of a text, the same
+     *  hash the tags use, for any length of text.
+     ***********************************************************/
+    uint32_t HashText(const std::string& text)
+    {
+        uint32_t hash = 2166136261u;
+
+        for (size_t i = 0; i < text.size(); i++)
+        {
+            hash = (hash ^ (uint32_t)(unsigned char)text[i]) * 16777619u;
+        }
+
+        return(hash);
+    }
+}
+
+/***********************************************************
+ *  SceneFile()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneFile::SceneFile()
+{
+    m_data = NULL;
+    m_size = 0;
+    m_header = NULL;
+    m_textures = NULL;
+    m_materials = NULL;
+    m_lights = NULL;
+    m_objects = NULL;
+    m_strings = NULL;
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for mapping a binary scene file into
+ *  memory.  The tables are used in place, so nothing is read
+ *  until it is touched.  A file that does not start like a
+ *  binary scene is parsed as the text form instead.  Returns
+ *  false when the file is missing or does not pass the checks.
+ ***********************************************************/
+bool SceneFile::Open(const char* filename)
+{
+    Close();
+
+    if (m_file.Open(filename) == false)
+    {
+        return(false);
+    }
+
+    if ((m_file.GetSize() < sizeof(uint32_t)) || (*(const uint32_t*)m_file.GetData() != SCENE_MAGIC))
+    {
+        return(LoadText(filename));
+    }
+
+    if (Attach(m_file.GetData(), m_file.GetSize(), filename) == false)
+    {
+        Close();
+        return(false);
+    }
+
+    return(true);
+}
+
+/***********************************************************
+ *  LoadText()
+ *
+ *  This method is used for parsing a scene in the text form
+ *  into the same layout as the binary form.  A line that can
+ *  not be parsed is reported with its number, and no scene is
+ *  loaded then.  The same goes for an object that names a
+ *  texture or material tag the file does not declare, which
+ *  is found after the whole file is read, so the tags can be
+ *  declared in any order.  The hash of the text is kept in
+ *  the header.
+ ***********************************************************/
+bool SceneFile::LoadText(const char* filename)
+{
+    Close();
+
+    std::string text;
+    if (ReadTextFile(filename, text) == false)
+    {
+        return(false);
+    }
+
+    std::istringstream file(text);
+
+    std::vector<SCENE_TEXTURE> textures;
+    std::vector<SCENE_MATERIAL> materials;
+    std::vector<SCENE_LIGHT> lights;
+    std::vector<SCENE_OBJECT> objects;
+    std::vector<uint32_t> materialHashes;
+    std::vector<TAG_REFERENCE> references;
+    // offset 0 is the empty string
+    std::string strings(1, '\0');
+    std::string line;
+    int lineNumber = 0;
+
+    while (std::getline(file, line))
+    {
+        std::istringstream fields(line);
+        std::string keyword;
+        bool bValid = true;
+
+        lineNumber++;
+        if (!(fields >> keyword) || (keyword[0] == '#'))
+        {
+            continue;
+        }
+
+        if (keyword == "texture")
+        {
+            std::string tag;
+            std::string imageFile;
+            SCENE_TEXTURE texture;
+
+            bValid = !!(fields >> tag >> imageFile);
+            texture.tagHash = HashTag(tag.c_str());
+            texture.tagString = AddString(strings, tag);
+            texture.fileString = AddString(strings, imageFile);
+            texture.reserved = 0;
+            textures.push_back(texture);
+        }
+        else if (keyword == "material")
+        {
+            std::string tag;
+            SCENE_MATERIAL material;
+
+            bValid = !!(fields >> tag >>
+                material.ambientColor.r >> material.ambientColor.g >> material.ambientColor.b >>
+                material.ambientStrength >>
+                material.diffuseColor.r >> material.diffuseColor.g >> material.diffuseColor.b >>
+                material.specularColor.r >> material.specularColor.g >> material.specularColor.b >>
+                material.shininess);
+            material.tagString = AddString(strings, tag);
+            materials.push_back(material);
+            materialHashes.push_back(HashTag(tag.c_str()));
+        }
+        else if (keyword == "light")
+        {
+            SCENE_LIGHT light;
+
+            bValid = !!(fields >>
+                light.position.x >> light.position.y >> light.position.z >>
+                light.ambientColor.r >> light.ambientColor.g >> light.ambientColor.b >>
+                light.diffuseColor.r >> light.diffuseColor.g >> light.diffuseColor.b >>
+                light.specularColor.r >> light.specularColor.g >> light.specularColor.b >>
+                light.focalStrength >> light.specularIntensity >> light.range);
+            lights.push_back(light);
+        }
+        else if (keyword == "object")
+        {
+            std::string meshName;
+            std::string option;
+            SCENE_OBJECT object;
+
+            object.textureTag = NO_TAG;
+            object.materialTag = NO_TAG;
+            object.reserved = 0;
+            object.color = glm::vec4(1.0f);
+            object.UVscale = glm::vec2(1.0f, 1.0f);
+
+            bValid = !!(fields >> meshName >>
+                object.scaleXYZ.x >> object.scaleXYZ.y >> object.scaleXYZ.z >>
+                object.rotationDegrees.x >> object.rotationDegrees.y >> object.rotationDegrees.z >>
+                object.positionXYZ.x >> object.positionXYZ.y >> object.positionXYZ.z);
+
+            int mesh = FindMeshName(meshName.c_str());
+            bValid = bValid && (mesh >= 0);
+            object.mesh = (uint32_t)mesh;
+
+            while (bValid && (fields >> option))
+            {
+                std::string tag;
+                TAG_REFERENCE reference;
+
+                reference.lineNumber = lineNumber;
+
+                if (option == "texture")
+                {
+                    bValid = !!(fields >> tag);
+                    object.textureTag = HashTag(tag.c_str());
+                    reference.bTexture = true;
+                    reference.tag = tag;
+                    references.push_back(reference);
+                }
+                else if (option == "color")
+                {
+                    bValid = !!(fields >> object.color.r >> object.color.g >> object.color.b >> object.color.a);
+                }
+                else if (option == "material")
+                {
+                    bValid = !!(fields >> tag);
+                    object.materialTag = HashTag(tag.c_str());
+                    reference.bTexture = false;
+                    reference.tag = tag;
+                    references.push_back(reference);
+                }
+                else if (option == "uv")
+                {
+                    bValid = !!(fields >> object.UVscale.x >> object.UVscale.y);
+                }
+                else
+                {
+                    bValid = false;
+                }
+            }
+            objects.push_back(object);
+        }
+        else
+        {
+            bValid = false;
+        }
+
+        if (bValid == false)
+        {
+            std::cout << "Invalid scene line " << lineNumber << ":" << line << std::endl;
+            return(false);
+        }
+    }
+
+    // a misspelled tag would draw the object white or with the
+    // default material without any message
+    bool bTagsKnown = true;
+    for (size_t i = 0; i < references.size(); i++)
+    {
+        const TAG_REFERENCE& reference = references[i];
+        uint32_t tagHash = HashTag(reference.tag.c_str());
+        bool bFound = false;
+
+        if (reference.bTexture)
+        {
+            for (size_t j = 0; (j < textures.size()) && (bFound == false); j++)
+            {
+                bFound = (textures[j].tagHash == tagHash);
+            }
+        }
+        else
+        {
+            for (size_t j = 0; (j < materialHashes.size()) && (bFound == false); j++)
+            {
+                bFound = (materialHashes[j] == tagHash);
+            }
+        }
+
+        if (bFound == false)
+        {
+            std::cout << "Unknown " << (reference.bTexture ? "texture" : "material") << " tag on scene line " << reference.lineNumber << ":" << reference.tag << std::endl;
+            bTagsKnown = false;
+        }
+    }
+    if (bTagsKnown == false)
+    {
+        return(false);
+    }
+
+    // the strings end the image, so the tables keep the four
+    // byte alignment of their floats
+    SCENE_HEADER header;
+    memset(&header, 0, sizeof(header));
+    header.magic = SCENE_MAGIC;
+    header.version = SCENE_VERSION;
+    header.textureCount = (uint32_t)textures.size();
+    header.materialCount = (uint32_t)materials.size();
+    header.lightCount = (uint32_t)lights.size();
+    header.objectCount = (uint32_t)objects.size();
+    header.stringBytes = (uint32_t)strings.size();
+    header.sourceHash = HashText(text);
+
+    std::vector<unsigned char> image((const unsigned char*)&header, (const unsigned char*)(&header + 1));
+    AppendTable(image, textures);
+    AppendTable(image, materials);
+    AppendTable(image, lights);
+    AppendTable(image, objects);
+    image.insert(image.end(), strings.begin(), strings.end());
+    ((SCENE_HEADER*)image.data())->fileSize = image.size();
+
+    m_image.swap(image);
+    if (Attach(m_image.data(), m_image.size(), filename) == false)
+    {
+        Close();
+        return(false);
+    }
+
+    return(true);
+}
+
+/***********************************************************
+ *  SaveBinary()
+ *
+ *  This method is used for writing the loaded scene as a
+ *  binary scene file, which is a copy of the tables.
+ ***********************************************************/
+bool SceneFile::SaveBinary(const char* filename) const
+{
+    if (NULL == m_header)
+    {
+        return(false);
+    }
+
+    std::ofstream output(filename, std::ios::binary | std::ios::trunc);
+    output.write((const char*)m_data, (std::streamsize)m_size);
+    if (!output)
+    {
+        std::cout << "Could not write scene file:" << filename << std::endl;
+        return(false);
+    }
+
+    std::cout << "Wrote scene file:" << filename << ", objects:" << m_header->objectCount << ", bytes:" << m_size << std::endl;
+
+    return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for releasing the loaded scene.  The
+ *  tables must no longer be used.
+ ***********************************************************/
+void SceneFile::Close()
+{
+    m_file.Close();
+    std::vector<unsigned char>().swap(m_image);
+    m_data = NULL;
+    m_size = 0;
+    m_header = NULL;
+    m_textures = NULL;
+    m_materials = NULL;
+    m_lights = NULL;
+    m_objects = NULL;
+    m_strings = NULL;
+}
+
+/***********************************************************
+ *  IsOpen()
+ *
+ *  This method returns true while a scene is loaded.
+ ***********************************************************/
+bool SceneFile::IsOpen() const
+{
+    return(NULL != m_header);
+}
+
+/***********************************************************
+ *  GetTextureCount()
+ *
+ *  This method returns the number of textures of the scene.
+ ***********************************************************/
+uint32_t SceneFile::GetTextureCount() const
+{
+    return((NULL != m_header) ? m_header->textureCount : 0);
+}
+
+/***********************************************************
+ *  GetMaterialCount()
+ *
+ *  This method returns the number of materials of the scene.
+ ***********************************************************/
+uint32_t SceneFile::GetMaterialCount() const
+{
+    return((NULL != m_header) ? m_header->materialCount : 0);
+}
+
+/***********************************************************
+ *  GetLightCount()
+ *
+ *  This method returns the number of lights of the scene.
+ ***********************************************************/
+uint32_t SceneFile::GetLightCount() const
+{
+    return((NULL != m_header) ? m_header->lightCount : 0);
+}
+
+/***********************************************************
+ *  GetObjectCount()
+ *
+ *  This method returns the number of objects of the scene.
+ ***********************************************************/
+uint32_t SceneFile::GetObjectCount() const
+{
+    return((NULL != m_header) ? m_header->objectCount : 0);
+}
+
+/***********************************************************
+ *  GetTextures()
+ *
+ *  This method returns the table of the scene textures.
+ ***********************************************************/
+const SceneFile::SCENE_TEXTURE* SceneFile::GetTextures() const
+{
+    return(m_textures);
+}
+
+/***********************************************************
+ *  GetMaterials()
+ *
+ *  This method returns the table of the scene materials.
+ ***********************************************************/
+const SceneFile::SCENE_MATERIAL* SceneFile::GetMaterials() const
+{
+    return(m_materials);
+}
+
+/***********************************************************
+ *  GetLights()
+ *
+ *  This method returns the table of the scene lights.
+ ***********************************************************/
+const SceneFile::SCENE_LIGHT* SceneFile::GetLights() const
+{
+    return(m_lights);
+}
+
+/***********************************************************
+ *  GetObjects()
+ *
+ *  This method returns the table of the scene objects.
+ ***********************************************************/
+const SceneFile::SCENE_OBJECT* SceneFile::GetObjects() const
+{
+    return(m_objects);
+}
+
+/***********************************************************
+ *  GetString()
+ *
+ *  This method returns the string at an offset of the string
+ *  block, or an empty string for an offset past the block.
+ ***********************************************************/
+const char* SceneFile::GetString(uint32_t offset) const
+{
+    if ((NULL == m_header) || (offset >= m_header->stringBytes))
+    {
+        return("");
+    }
+
+    return(m_strings + offset);
+}
+
+/***********************************************************
+ *  GetSourceHash()
+ *
+ *  This method returns the hash of the text form the scene
+ *  was parsed or compiled from.
+ ***********************************************************/
+uint32_t SceneFile::GetSourceHash() const
+{
+    return((NULL != m_header) ? m_header->sourceHash : 0);
+}
+
+/***********************************************************
+ *  FindMeshName()
+ *
+ *  This method returns the shape of a mesh name of the text
+ *  form, or -1 when the name is not known.
+ ***********************************************************/
+int SceneFile::FindMeshName(const char* name)
+{
+    for (int shape = 0; shape < ShapeGeometry::SHAPE_COUNT; shape++)
+    {
+        if (0 == strcmp(name, MESH_NAMES[shape]))
+        {
+            return(shape);
+        }
+    }
+
+    return(-1);
+}
+
+/***********************************************************
+ *  HashTextFile()
+ *
+ *  This method is used for hashing a file of the text form
+ *  the way LoadText() does, to compare it with the hash of a
+ *  compiled scene.  Returns false when the file is missing.
+ ***********************************************************/
+bool SceneFile::HashTextFile(const char* filename, uint32_t& hash)
+{
+    std::string text;
+
+    if (ReadTextFile(filename, text) == false)
+    {
+        return(false);
+    }
+
+    hash = HashText(text);
+    return(true);
+}
+
+/***********************************************************
+ *  Attach()
+ *
+ *  This method is used for checking that a binary scene is
+ *  of the current version and that its tables and strings
+ *  lie inside of it, and then finding the tables.  Only the
+ *  header is read, the records are not visited.
+ ***********************************************************/
+bool SceneFile::Attach(const unsigned char* data, size_t size, const char* filename)
+{
+    const SCENE_HEADER* pHeader = (const SCENE_HEADER*)data;
+
+    if ((size < sizeof(SCENE_HEADER)) || (pHeader->magic != SCENE_MAGIC))
+    {
+        std::cout << "Not a scene file:" << filename << std::endl;
+        return(false);
+    }
+
+    if (pHeader->version != SCENE_VERSION)
+    {
+        std::cout << "Scene file version " << pHeader->version << " is not supported:" << filename << std::endl;
+        return(false);
+    }
+
+    uint64_t expectedSize = sizeof(SCENE_HEADER) +
+        (uint64_t)pHeader->textureCount * sizeof(SCENE_TEXTURE) +
+        (uint64_t)pHeader->materialCount * sizeof(SCENE_MATERIAL) +
+        (uint64_t)pHeader->lightCount * sizeof(SCENE_LIGHT) +
+        (uint64_t)pHeader->objectCount * sizeof(SCENE_OBJECT) +
+        pHeader->stringBytes;
+    if ((pHeader->fileSize != size) || (expectedSize != size))
+    {
+        std::cout << "Scene file is truncated:" << filename << std::endl;
+        return(false);
+    }
+
+    // every string offset is checked when it is read, so a
+    // block that ends with a zero keeps every string inside
+    const char* pStrings = (const char*)(data + size - pHeader->stringBytes);
+    if ((pHeader->stringBytes == 0) || (pStrings[pHeader->stringBytes - 1] != '\0'))
+    {
+        std::cout << "Scene file strings are not terminated:" << filename << std::endl;
+        return(false);
+    }
+
+    const unsigned char* pTable = data + sizeof(SCENE_HEADER);
+    m_textures = (const SCENE_TEXTURE*)pTable;
+    pTable += pHeader->textureCount * sizeof(SCENE_TEXTURE);
+    m_materials = (const SCENE_MATERIAL*)pTable;
+    pTable += pHeader->materialCount * sizeof(SCENE_MATERIAL);
+    m_lights = (const SCENE_LIGHT*)pTable;
+    pTable += pHeader->lightCount * sizeof(SCENE_LIGHT);
+    m_objects = (const SCENE_OBJECT*)pTable;
+
+    m_data = data;
+    m_size = size;
+    m_strings = pStrings;
+    m_header = pHeader;
+
+    return(true);
+}
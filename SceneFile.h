@@ -0,0 +1,160 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.h
+// ============
+// scene description with a text form and a compiled binary form
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  SceneFile
+ *
+ *  This class holds the description of a scene - the
+ *  textures, materials and lights, and the objects with
+ *  their mesh, transform, texture, material and UV scale.
+ *
+ *  The text form is edited by hand and parsed line by line.
+ *  The binary form is compiled from the text by the asset
+ *  packer, and it is the same layout that the tables have in
+ *  memory - a versioned header followed by the texture,
+ *  material, light and object tables and a block of strings.
+ *  It is used in place from one mapping of the file, so even
+ *  a scene with many objects is opened with no parsing and
+ *  no allocations.  The file is written in the byte order of
+ *  the machine, and it keeps a hash of the text it was
+ *  compiled from, so a compiled scene that is older than its
+ *  text can be found.
+ ***********************************************************/
+class SceneFile
+{
+public:
+    // constructor
+    SceneFile();
+
+    // identifies a scene file, "SCNE" in the file
+    static const uint32_t SCENE_MAGIC = 0x454E4353;
+    // changed whenever the layout or the meaning of a field
+    // in the file changes
+    static const uint32_t SCENE_VERSION = 2;
+    // tag hash of an object drawn without a texture
+    static const uint32_t NO_TAG = 0;
+
+    // start of the binary scene file, the tables follow it in
+    // the order of the counts, and then the strings
+    struct SCENE_HEADER
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t textureCount;
+        uint32_t materialCount;
+        uint32_t lightCount;
+        uint32_t objectCount;
+        // bytes of the string block at the end of the file
+        uint32_t stringBytes;
+        // hash of the text form the scene was compiled from
+        uint32_t sourceHash;
+        uint64_t fileSize;
+    };
+
+    // a texture, the strings are offsets into the string block
+    struct SCENE_TEXTURE
+    {
+        uint32_t tagHash;
+        uint32_t tagString;
+        uint32_t fileString;
+        uint32_t reserved;
+    };
+
+    struct SCENE_MATERIAL
+    {
+        glm::vec3 ambientColor;
+        float ambientStrength;
+        glm::vec3 diffuseColor;
+        float shininess;
+        glm::vec3 specularColor;
+        uint32_t tagString;
+    };
+
+    struct SCENE_LIGHT
+    {
+        glm::vec3 position;
+        glm::vec3 ambientColor;
+        glm::vec3 diffuseColor;
+        glm::vec3 specularColor;
+        float focalStrength;
+        float specularIntensity;
+        float range;
+    };
+
+    // an object, the texture and material are found by their
+    // tag hashes when the object is added to the scene
+    struct SCENE_OBJECT
+    {
+        // shape of the shared geometry builder
+        uint32_t mesh;
+        uint32_t textureTag;
+        uint32_t materialTag;
+        uint32_t reserved;
+        glm::vec3 scaleXYZ;
+        glm::vec3 rotationDegrees;
+        glm::vec3 positionXYZ;
+        // used when the object has no texture
+        glm::vec4 color;
+        glm::vec2 UVscale;
+    };
+
+    // map a binary scene file and check its header, or parse
+    // a file of the text form
+    bool Open(const char* filename);
+    // parse a scene in the text form
+    bool LoadText(const char* filename);
+    // write the loaded scene in the binary form
+    bool SaveBinary(const char* filename) const;
+    // release the loaded scene
+    void Close();
+    bool IsOpen() const;
+
+    uint32_t GetTextureCount() const;
+    uint32_t GetMaterialCount() const;
+    uint32_t GetLightCount() const;
+    uint32_t GetObjectCount() const;
+    const SCENE_TEXTURE* GetTextures() const;
+    const SCENE_MATERIAL* GetMaterials() const;
+    const SCENE_LIGHT* GetLights() const;
+    const SCENE_OBJECT* GetObjects() const;
+    // string of the string block at an offset
+    const char* GetString(uint32_t offset) const;
+    // hash of the text form the scene was loaded from
+    uint32_t GetSourceHash() const;
+
+    // shape of a mesh name of the text form, -1 if unknown
+    static int FindMeshName(const char* name);
+    // hash of a file of the text form, false if it is missing
+    static bool HashTextFile(const char* filename, uint32_t& hash);
+
+private:
+    // mapped binary file
+    MappedFile m_file;
+    // binary image built from the text form
+    std::vector<unsigned char> m_image;
+    // tables of the open scene, inside of the file or image
+    const unsigned char* m_data;
+    size_t m_size;
+    const SCENE_HEADER* m_header;
+    const SCENE_TEXTURE* m_textures;
+    const SCENE_MATERIAL* m_materials;
+    const SCENE_LIGHT* m_lights;
+    const SCENE_OBJECT* m_objects;
+    const char* m_strings;
+
+    // check the header and strings and find the tables
+    bool Attach(const unsigned char* data, size_t size, const char* filename);
+};
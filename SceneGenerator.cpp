@@ -0,0 +1,257 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegenerator.cpp
+// ============
+// fill a scene with many random objects for scaling benchmarks
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneGenerator.h"
+
+#include <cmath>
+
+// declaration of the global variables and defines
+namespace
+{
+    // size of an object against its grid cell
+    const float MIN_OBJECT_SIZE = 0.3f;
+    const float MAX_OBJECT_SIZE = 0.7f;
+    // part of a grid cell an object can move off its center
+    const float CELL_JITTER = 0.15f;
+    // height of the bobbing of the moving objects against
+    // their size, and the angle they turn with every move
+    const float MOVE_HEIGHT = 0.5f;
+    const float MOVE_DEGREES = 3.0f;
+    // radians of the bobbing motion for every frame
+    const float MOVE_SPEED = 0.05f;
+    // fewest moving objects of a job of the animation
+    const size_t ANIMATE_GRAIN_SIZE = 1024;
+}
+
+/***********************************************************
+ *  SceneGenerator()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneGenerator::SceneGenerator()
+{
+    m_moveInterval = 1;
+    m_randomState = 0;
+}
+
+/***********************************************************
+ *  GetDefaultSettings()
+ *
+ *  This method returns settings that use every mesh type,
+ *  texture and material equally, draw most objects with a
+ *  texture, and move a tenth of the objects every frame.
+ ***********************************************************/
+SceneGenerator::GENERATOR_SETTINGS SceneGenerator::GetDefaultSettings(size_t objectCount)
+{
+    GENERATOR_SETTINGS settings;
+
+    settings.seed = 1;
+    settings.objectCount = objectCount;
+    for (int meshType = 0; meshType < SceneManager::MESH_COUNT; meshType++)
+    {
+        settings.meshWeights[meshType] = 1.0f;
+    }
+    // the plane is the floor of a scene, not an object on it
+    settings.meshWeights[SceneManager::MESH_PLANE] = 0.0f;
+    settings.textureVariety = 0;
+    settings.materialVariety = 0;
+    settings.texturedFraction = 0.8f;
+    settings.movingFraction = 0.1f;
+    settings.moveInterval = 1;
+    settings.fieldSize = 80.0f;
+
+    return(settings);
+}
+
+/***********************************************************
+ *  Generate()
+ *
+ *  This method is used for adding the objects to a scene.
+ *  The scene must have been prepared, so its textures are
+ *  loaded and its materials are defined.  Every object gets
+ *  a grid cell of the field, a mesh type by the weights, a
+ *  size and a turn, and then a texture or a color and a
+ *  material.
+ ***********************************************************/
+void SceneGenerator::Generate(SceneManager* pScene, const GENERATOR_SETTINGS& settings)
+{
+    // odd state from the seed, so a seed of zero still moves the
+    // generator
+    m_randomState = ((uint64_t)settings.seed << 1) | 1;
+    m_moveInterval = (settings.moveInterval > 0) ? settings.moveInterval : 1;
+    m_movingObjects.clear();
+
+    int textureCount = pScene->GetTextureCount();
+    int materialCount = pScene->GetMaterialCount();
+    if ((settings.textureVariety > 0) && (settings.textureVariety < textureCount))
+    {
+        textureCount = settings.textureVariety;
+    }
+    if ((settings.materialVariety > 0) && (settings.materialVariety < materialCount))
+    {
+        materialCount = settings.materialVariety;
+    }
+
+    size_t gridSide = (size_t)std::ceil(std::sqrt((double)settings.objectCount));
+    float cellSize = settings.fieldSize / (float)((gridSide > 0) ? gridSide : 1);
+    float fieldStart = -0.5f * settings.fieldSize + 0.5f * cellSize;
+
+    for (size_t i = 0; i < settings.objectCount; i++)
+    {
+        SceneManager::MESH_TYPE mesh = (SceneManager::MESH_TYPE)PickWeighted(settings.meshWeights, SceneManager::MESH_COUNT);
+        float size = cellSize * (MIN_OBJECT_SIZE + (MAX_OBJECT_SIZE - MIN_OBJECT_SIZE) * NextFloat());
+        glm::vec3 scaleXYZ(size, size, size);
+        float rotationDegrees = 360.0f * NextFloat();
+        glm::vec3 positionXYZ(
+            fieldStart + cellSize * ((float)(i % gridSide) + CELL_JITTER * (2.0f * NextFloat() - 1.0f)),
+            0.5f * size,
+            fieldStart + cellSize * ((float)(i / gridSide) + CELL_JITTER * (2.0f * NextFloat() - 1.0f)));
+
+        int object = pScene->AddSceneObject(mesh, scaleXYZ, 0.0f, rotationDegrees, 0.0f, positionXYZ);
+
+        if ((textureCount > 0) && (NextFloat() < settings.texturedFraction))
+        {
+            pScene->SetObjectTexture(object, pScene->GetTextureTagHash((int)(NextRandom() % (uint32_t)textureCount)));
+        }
+        else
+        {
+            pScene->SetObjectColor(object, NextFloat(), NextFloat(), NextFloat(), 1.0f);
+        }
+        if (materialCount > 0)
+        {
+            pScene->SetObjectMaterial(object, pScene->GetMaterialTagHash((int)(NextRandom() % (uint32_t)materialCount)));
+        }
+
+        if (NextFloat() < settings.movingFraction)
+        {
+            MOVING_OBJECT moving;
+
+            moving.objectIndex = object;
+            moving.scaleXYZ = scaleXYZ;
+            moving.positionXYZ = positionXYZ;
+            moving.rotationDegrees = rotationDegrees;
+            moving.phase = 6.2831853f * NextFloat();
+            m_movingObjects.push_back(moving);
+        }
+    }
+}
+
+/***********************************************************
+ *  Animate()
+ *
+ *  This method is used for moving the moving objects that are
+ *  due in a frame.  The moves of the objects are spread over
+ *  the frames of the interval, and an object is placed from
+ *  the frame number alone, so a frame always looks the same.
+ *  The transforms of the due objects are worked out on the
+ *  job threads of the scene and then set all at once.
+ ***********************************************************/
+void SceneGenerator::Animate(SceneManager* pScene, uint64_t frameNumber)
+{
+    size_t firstMoving = (size_t)(frameNumber % (uint64_t)m_moveInterval);
+    size_t interval = (size_t)m_moveInterval;
+
+    if (firstMoving >= m_movingObjects.size())
+    {
+        return;
+    }
+
+    m_frameTransforms.resize((m_movingObjects.size() - firstMoving + interval - 1) / interval);
+    SceneManager::OBJECT_TRANSFORM* transforms = m_frameTransforms.data();
+    pScene->GetJobSystem()->ParallelFor(m_frameTransforms.size(), ANIMATE_GRAIN_SIZE, [this, transforms, firstMoving, interval, frameNumber](size_t first, size_t end)
+    {
+        for (size_t k = first; k < end; k++)
+        {
+            const MOVING_OBJECT& moving = m_movingObjects[firstMoving + k * interval];
+            float angle = moving.phase + MOVE_SPEED * (float)frameNumber;
+            SceneManager::OBJECT_TRANSFORM& transform = transforms[k];
+
+            transform.objectIndex = moving.objectIndex;
+            transform.scaleXYZ = moving.scaleXYZ;
+            transform.rotationDegrees = glm::vec3(0.0f, std::fmod(moving.rotationDegrees + MOVE_DEGREES * (float)frameNumber, 360.0f), 0.0f);
+            transform.positionXYZ = moving.positionXYZ;
+            transform.positionXYZ.y += MOVE_HEIGHT * moving.scaleXYZ.y * (0.5f + 0.5f * std::sin(angle));
+        }
+    });
+
+    pScene->SetObjectTransforms(m_frameTransforms.data(), m_frameTransforms.size());
+}
+
+/***********************************************************
+ *  GetMovingCount()
+ *
+ *  This method returns the number of generated objects that
+ *  move.
+ ***********************************************************/
+size_t SceneGenerator::GetMovingCount() const
+{
+    return(m_movingObjects.size());
+}
+
+/***********************************************************
+ *  NextRandom()
+ *
+ *  This method returns the next number of a permuted
+ *  congruential generator, which has the same output on
+ *  every platform.
+ ***********************************************************/
+uint32_t SceneGenerator::NextRandom()
+{
+    uint64_t state = m_randomState;
+    uint32_t xorShifted = (uint32_t)(((state >> 18) ^ state) >> 27);
+    uint32_t rotation = (uint32_t)(state >> 59);
+
+    m_randomState = state * 6364136223846793005ull + 1442695040888963407ull;
+
+    return((xorShifted >> rotation) | (xorShifted << ((32 - rotation) & 31)));
+}
+
+/***********************************************************
+ *  NextFloat()
+ *
+ *  This method returns a random number from 0 to below 1.
+ ***********************************************************/
+float SceneGenerator::NextFloat()
+{
+    // the top 24 bits fill the mantissa of a float exactly
+    return((float)(NextRandom() >> 8) * (1.0f / 16777216.0f));
+}
+
+/***********************************************************
+ *  PickWeighted()
+ *
+ *  This method is used for picking an index of a table with
+ *  a chance that follows its weight.  The first index is
+ *  picked when every weight is zero.
+ ***********************************************************/
+int SceneGenerator::PickWeighted(const float* weights, int count)
+{
+    float total = 0.0f;
+
+    for (int i = 0; i < count; i++)
+    {
+        total += (weights[i] > 0.0f) ? weights[i] : 0.0f;
+    }
+
+    float pick = NextFloat() * total;
+    int last = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (weights[i] <= 0.0f)
+        {
+            continue;
+        }
+        if (pick < weights[i])
+        {
+            return(i);
+        }
+        pick -= weights[i];
+        last = i;
+    }
+
+    return(last);
+}
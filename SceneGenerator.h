@@ -0,0 +1,97 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegenerator.h
+// ============
+// fill a scene with many random objects for scaling benchmarks
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  SceneGenerator
+ *
+ *  This class adds a number of objects to a scene, drawn from
+ *  the basic shape meshes, the loaded textures and the defined
+ *  materials.  The objects stand on a square field with one
+ *  object in every cell of a jittered grid, so the field keeps
+ *  its size and the objects get smaller as there are more.
+ *
+ *  Every choice comes from a random generator that is seeded
+ *  from the settings and does not depend on the standard
+ *  library, so the same settings give the same scene on every
+ *  platform.  A part of the objects keeps moving, each one on
+ *  a fixed interval of frames, for the cost of refitting the
+ *  moved objects every frame.
+ ***********************************************************/
+class SceneGenerator
+{
+public:
+    // constructor
+    SceneGenerator();
+
+    // what to generate
+    struct GENERATOR_SETTINGS
+    {
+        uint32_t seed;
+        size_t objectCount;
+        // relative weight of every mesh type, the types with a
+        // weight of zero are not used
+        float meshWeights[SceneManager::MESH_COUNT];
+        // number of the loaded textures and of the defined
+        // materials the objects are given, 0 uses all of them
+        int textureVariety;
+        int materialVariety;
+        // part of the objects drawn with a texture, the others
+        // are drawn with a random color
+        float texturedFraction;
+        // part of the objects that move, and the frames between
+        // two moves of a moving object
+        float movingFraction;
+        int moveInterval;
+        // side of the square field the objects stand on
+        float fieldSize;
+    };
+
+    // settings with every mesh type, texture and material,
+    // and a tenth of the objects moving every frame
+    static GENERATOR_SETTINGS GetDefaultSettings(size_t objectCount);
+
+    // add the objects to a scene that has been prepared
+    void Generate(SceneManager* pScene, const GENERATOR_SETTINGS& settings);
+    // move the moving objects that are due in a frame
+    void Animate(SceneManager* pScene, uint64_t frameNumber);
+    // number of the generated objects that move
+    size_t GetMovingCount() const;
+
+private:
+    // a generated object that moves
+    struct MOVING_OBJECT
+    {
+        int objectIndex;
+        glm::vec3 scaleXYZ;
+        glm::vec3 positionXYZ;
+        float rotationDegrees;
+        // offset of the object along its motion
+        float phase;
+    };
+
+    std::vector<MOVING_OBJECT> m_movingObjects;
+    // transforms of the objects moved in the current frame
+    std::vector<SceneManager::OBJECT_TRANSFORM> m_frameTransforms;
+    int m_moveInterval;
+    // state of the random generator
+    uint64_t m_randomState;
+
+    // next random number, and one from 0 to below 1
+    uint32_t NextRandom();
+    float NextFloat();
+    // pick an index by the weights of a table
+    int PickWeighted(const float* weights, int count);
+};
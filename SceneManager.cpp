@@ -9,367 +9,1574 @@
 
 #include "SceneManager.h"
 
+#include <atomic>
+#include <cstring>
+
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #endif
 
-#include <glm/gtx/transform.hpp>
+// declaration of global variables
+namespace
+{
+    const char* g_TextureValueName = "objectTextures";
+    const char* g_UseLightingName = "bUseLighting";
+    // baked scene assets written by the asset packer
+    const char* g_AssetPackName = "Source/scene.pack";
+    // scene description compiled by the asset packer, and the
+    // text form it is compiled from
+    const char* g_SceneFileName = "Source/scene.bin";
+    const char* g_SceneTextName = "Source/Scene.txt";
+
+    // texture unit that the texture array of a draw is bound to
+    const GLuint TEXTURE_UNIT = 0;
+
+    // storage buffer binding point of the material table
+    const GLuint MATERIAL_BUFFER_BINDING = 3;
+
+    // smallest projected diameter in pixels that keeps a level,
+    // the coarsest level is used below the last size
+    const float LOD_SCREEN_SIZES[SceneManager::LOD_COUNT - 1] = { 160.0f, 64.0f, 24.0f };
+    // bytes of mesh data kept uploaded before meshes that are
+    // not drawn are evicted
+    const size_t DEFAULT_MESH_BUDGET = 16 * 1024 * 1024;
+
+    // fraction of a size that an object must move past it
+    // before its level changes, so levels do not flicker
+    const float LOD_HYSTERESIS = 0.15f;
+
+    // fewest objects of a job of the frame stages, so a small
+    // scene is prepared by the calling thread alone
+    const size_t OBJECT_GRAIN_SIZE = 1024;
+
+    // material layout matching the std430 material buffer
+    struct GPU_MATERIAL
+    {
+        glm::vec4 ambientColorStrength;
+        glm::vec4 diffuseColor;
+        glm::vec4 specularShininess;
+    };
+}
+
+/***********************************************************
+ *  SceneManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneManager::SceneManager(ShaderManager* pShaderManager)
+{
+    m_pShaderManager = pShaderManager;
+    m_sceneMeshes = new SceneMeshes();
+    m_textureArrays = new TextureArrays();
+    m_textureResidency = new TextureResidency(m_textureArrays);
+    m_lightClusters = new LightClusters();
+    m_occlusionCuller = new OcclusionCuller();
+    m_sceneVersion = 0;
+    m_frameNumber = 0;
+    m_meshBudget = DEFAULT_MESH_BUDGET;
+    m_workerPool = new WorkerPool();
+    m_jobSystem = new JobSystem();
+    m_bLoadingStarted = false;
+    m_bDeferTextureBinds = false;
+    m_pProfiler = NULL;
+    m_shaderProgram = 0;
+    for (int meshType = 0; meshType < MESH_COUNT; meshType++)
+    {
+        m_meshReferences[meshType] = 0;
+        m_bMeshBoundsFound[meshType] = false;
+        for (int level = 0; level < LOD_COUNT; level++)
+        {
+            m_meshSlots[meshType][level].meshIndex = -1;
+            m_meshSlots[meshType][level].lastUsedFrame = 0;
+            m_meshSlots[meshType][level].bBuilt = false;
+        }
+    }
+    m_materialSSBO = 0;
+    m_bTransformsDirty = false;
+    m_cullStats.objectCount = 0;
+    m_cullStats.nodesTested = 0;
+    m_cullStats.objectsTested = 0;
+    m_cullStats.objectsCulled = 0;
+    m_sceneView.view = glm::mat4(1.0f);
+    m_sceneView.projection = glm::mat4(1.0f);
+    m_sceneView.viewportWidth = 1;
+    m_sceneView.viewportHeight = 1;
+}
+
+/***********************************************************
+ *  ~SceneManager()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneManager::~SceneManager()
+{
+    m_pShaderManager = NULL;
+    delete m_sceneMeshes;
+    m_sceneMeshes = NULL;
+    delete m_lightClusters;
+    m_lightClusters = NULL;
+    delete m_occlusionCuller;
+    m_occlusionCuller = NULL;
+    delete m_workerPool;
+    m_workerPool = NULL;
+    delete m_jobSystem;
+    m_jobSystem = NULL;
+
+    if (0 != m_materialSSBO)
+    {
+        glDeleteBuffers(1, &m_materialSSBO);
+        m_materialSSBO = 0;
+    }
+
+    DestroyGLTextures();
+    delete m_textureResidency;
+    m_textureResidency = NULL;
+    delete m_textureArrays;
+    m_textureArrays = NULL;
+}
+
+/***********************************************************
+ *  ResolveShaderUniforms()
+ *
+ *  This method is used for looking up the locations of the
+ *  uniforms of the scene shader and setting the sampler to
+ *  the texture unit of the texture arrays.  It must be called
+ *  after the shader program has been loaded and put into use.
+ ***********************************************************/
+void SceneManager::ResolveShaderUniforms()
+{
+    GLuint programID = GetActiveShaderProgram();
+
+    // the program was put into use around the state cache
+    m_shaderProgram = programID;
+    GetGLStateCache().UseProgram(programID);
+
+    m_uniforms.objectTextures.Resolve(programID, g_TextureValueName);
+
+    // every texture array is drawn from the same texture unit
+    m_uniforms.objectTextures.Set((int)TEXTURE_UNIT);
+}
+
+/***********************************************************
+ *  SetSceneView()
+ *
+ *  This method is used for passing the camera settings of
+ *  the next rendered frame to the scene, which needs them
+ *  to assign the scene lights to the view clusters.
+ ***********************************************************/
+void SceneManager::SetSceneView(
+    const glm::mat4& view,
+    const glm::mat4& projection,
+    int viewportWidth,
+    int viewportHeight)
+{
+    m_sceneView.view = view;
+    m_sceneView.projection = projection;
+    m_sceneView.viewportWidth = viewportWidth;
+    m_sceneView.viewportHeight = viewportHeight;
+}
+
+/***********************************************************
+ *  AddSceneObject()
+ *
+ *  This method is used for adding an object to the retained
+ *  scene.  The object is drawn every frame until the scene is
+ *  destroyed, with a white color, no texture and the first
+ *  material until those are set.  Returns the object index.
+ ***********************************************************/
+int SceneManager::AddSceneObject(
+    MESH_TYPE mesh,
+    glm::vec3 scaleXYZ,
+    float XrotationDegrees,
+    float YrotationDegrees,
+    float ZrotationDegrees,
+    glm::vec3 positionXYZ)
+{
+    SCENE_OBJECT object;
+
+    object.mesh = mesh;
+    object.lodLevel = 0;
+    object.meshIndex = -1;
+    object.textureHandle = TagRegistry::INVALID_HANDLE;
+    object.materialHandle = 0;
+    object.color = glm::vec4(1.0f);
+    object.UVscale = glm::vec2(1.0f, 1.0f);
+
+    ReferenceMesh(mesh);
+    m_sceneObjects.push_back(object);
+    m_objectTransforms.Add(
+        scaleXYZ,
+        glm::vec3(XrotationDegrees, YrotationDegrees, ZrotationDegrees),
+        positionXYZ);
+    m_bTransformsDirty = true;
+    m_sceneVersion++;
+
+    return((int)m_sceneObjects.size() - 1);
+}
+
+/***********************************************************
+ *  SetObjectTransform()
+ *
+ *  This method is used for moving an object of the retained
+ *  scene with the passed in transformation values.
+ ***********************************************************/
+void SceneManager::SetObjectTransform(
+    int objectIndex,
+    glm::vec3 scaleXYZ,
+    float XrotationDegrees,
+    float YrotationDegrees,
+    float ZrotationDegrees,
+    glm::vec3 positionXYZ)
+{
+    m_objectTransforms.Set(
+        objectIndex,
+        scaleXYZ,
+        glm::vec3(XrotationDegrees, YrotationDegrees, ZrotationDegrees),
+        positionXYZ);
+    m_movedObjects.push_back((uint32_t)objectIndex);
+    m_bTransformsDirty = true;
+    m_sceneVersion++;
+}
+
+/***********************************************************
+ *  SetObjectTransforms()
+ *
+ *  This method is used for moving many objects of the retained
+ *  scene at once.  The transforms are stored on the threads of
+ *  the job system, so every object must be listed only once.
+ ***********************************************************/
+void SceneManager::SetObjectTransforms(const OBJECT_TRANSFORM* transforms, size_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    m_jobSystem->ParallelFor(count, OBJECT_GRAIN_SIZE, [this, transforms](size_t first, size_t end)
+    {
+        for (size_t i = first; i < end; i++)
+        {
+            m_objectTransforms.Set(
+                transforms[i].objectIndex,
+                transforms[i].scaleXYZ,
+                transforms[i].rotationDegrees,
+                transforms[i].positionXYZ);
+        }
+    });
+
+    for (size_t i = 0; i < count; i++)
+    {
+        m_movedObjects.push_back((uint32_t)transforms[i].objectIndex);
+    }
+    m_bTransformsDirty = true;
+    m_sceneVersion++;
+}
+
+/***********************************************************
+ *  SetObjectMesh()
+ *
+ *  This method is used for changing the basic shape mesh
+ *  that an object of the retained scene is drawn with.
+ ***********************************************************/
+void SceneManager::SetObjectMesh(int objectIndex, MESH_TYPE mesh)
+{
+    SCENE_OBJECT& object = m_sceneObjects[objectIndex];
+
+    ReferenceMesh(mesh);
+    ReleaseMesh(object.mesh);
+    object.mesh = mesh;
+
+    // the bounds of the object change with its mesh
+    m_movedObjects.push_back((uint32_t)objectIndex);
+    m_bTransformsDirty = true;
+    m_sceneVersion++;
+}
+
+/***********************************************************
+ *  SetMeshMemoryBudget()
+ *
+ *  This method is used for setting how many bytes of mesh
+ *  data are kept uploaded before the meshes that are not
+ *  drawn are evicted.
+ ***********************************************************/
+void SceneManager::SetMeshMemoryBudget(size_t bytes)
+{
+    m_meshBudget = bytes;
+}
+
+/***********************************************************
+ *  GetMeshMemoryUsage()
+ *
+ *  This method returns the bytes of the uploaded mesh data.
+ ***********************************************************/
+size_t SceneManager::GetMeshMemoryUsage() const
+{
+    return(m_sceneMeshes->GetMeshBytes());
+}
+
+/***********************************************************
+ *  SetTextureMemoryBudget()
+ *
+ *  This method is used for setting how many bytes of texture
+ *  levels are kept in video memory before the finer levels
+ *  of the textures that are not drawn are dropped.
+ ***********************************************************/
+void SceneManager::SetTextureMemoryBudget(size_t bytes)
+{
+    m_textureResidency->SetBudget(bytes);
+}
+
+/***********************************************************
+ *  GetTextureStats()
+ *
+ *  This method returns the texture streaming counters of the
+ *  last rendered frame.
+ ***********************************************************/
+const TextureResidency::RESIDENCY_STATS& SceneManager::GetTextureStats() const
+{
+    return(m_textureResidency->GetStats());
+}
+
+/***********************************************************
+ *  SetObjectTexture()
+ *
+ *  This method is used for setting the previously loaded
+ *  texture that an object of the retained scene is drawn with.
+ ***********************************************************/
+void SceneManager::SetObjectTexture(int objectIndex, uint32_t textureTag)
+{
+    // a texture makes the object opaque, which changes its depth
+    m_sceneObjects[objectIndex].textureHandle = m_textureTags.Find(textureTag);
+    m_sceneVersion++;
+}
+
+/***********************************************************
+ *  SetObjectColor()
+ *
+ *  This method is used for setting the color that an object
+ *  of the retained scene is drawn with.  The color is only
+ *  used when the object has no texture.
+ ***********************************************************/
+void SceneManager::SetObjectColor(
+    int objectIndex,
+    float red,
+    float green,
+    float blue,
+    float alpha)
+{
+    SCENE_OBJECT& object = m_sceneObjects[objectIndex];
+
+    object.textureHandle = TagRegistry::INVALID_HANDLE;
+    object.color = glm::vec4(red, green, blue, alpha);
+    m_sceneVersion++;
+}
+
+/***********************************************************
+ *  SetObjectMaterial()
+ *
+ *  This method is used for setting the previously defined
+ *  material that an object of the retained scene is drawn with.
+ ***********************************************************/
+void SceneManager::SetObjectMaterial(int objectIndex, uint32_t materialTag)
+{
+    uint16_t handle = m_materialTags.Find(materialTag);
+
+    if (TagRegistry::INVALID_HANDLE != handle)
+    {
+        m_sceneObjects[objectIndex].materialHandle = handle;
+    }
+}
+
+/***********************************************************
+ *  SetObjectUVScale()
+ *
+ *  This method is used for setting the texture UV scale of
+ *  an object of the retained scene.
+ ***********************************************************/
+void SceneManager::SetObjectUVScale(int objectIndex, float u, float v)
+{
+    m_sceneObjects[objectIndex].UVscale = glm::vec2(u, v);
+}
+
+/***********************************************************
+ *  GetSceneObjectCount()
+ *
+ *  This method returns the number of objects that have been
+ *  added to the retained scene.
+ ***********************************************************/
+size_t SceneManager::GetSceneObjectCount() const
+{
+    return(m_sceneObjects.size());
+}
+
+/***********************************************************
+ *  GetTextureCount()
+ *
+ *  This method returns the number of loaded textures, which
+ *  are the texture slots from 0.
+ ***********************************************************/
+int SceneManager::GetTextureCount() const
+{
+    return((int)m_textures.size());
+}
+
+/***********************************************************
+ *  GetTextureTagHash()
+ *
+ *  This method returns the tag hash of the texture in a slot,
+ *  which is passed to SetObjectTexture().
+ ***********************************************************/
+uint32_t SceneManager::GetTextureTagHash(int textureSlot) const
+{
+    return(HashTag(m_textures[textureSlot].tag.c_str()));
+}
+
+/***********************************************************
+ *  GetMaterialCount()
+ *
+ *  This method returns the number of defined materials.
+ ***********************************************************/
+int SceneManager::GetMaterialCount() const
+{
+    return((int)m_objectMaterials.size());
+}
+
+/***********************************************************
+ *  GetMaterialTagHash()
+ *
+ *  This method returns the tag hash of a defined material,
+ *  which is passed to SetObjectMaterial().
+ ***********************************************************/
+uint32_t SceneManager::GetMaterialTagHash(int materialIndex) const
+{
+    return(HashTag(m_objectMaterials[materialIndex].tag.c_str()));
+}
+
+/***********************************************************
+ *  GetCullStats()
+ *
+ *  This method returns how many objects the last rendered
+ *  frame tested against the view frustum and how many of
+ *  them were culled.
+ ***********************************************************/
+const SceneBVH::CULL_STATS& SceneManager::GetCullStats() const
+{
+    return(m_cullStats);
+}
+
+/***********************************************************
+ *  SetOcclusionMode()
+ *
+ *  This method is used for setting how the objects hidden
+ *  behind other objects are culled.  The conservative mode
+ *  is the default and never drops a visible object.
+ ***********************************************************/
+void SceneManager::SetOcclusionMode(OcclusionCuller::OCCLUSION_MODE mode)
+{
+    m_occlusionCuller->SetMode(mode);
+}
+
+/***********************************************************
+ *  GetOcclusionStats()
+ *
+ *  This method returns how many objects the last rendered
+ *  frame tested for occlusion, how many were hidden, and the
+ *  number of samples drawn by the newest finished frame.
+ ***********************************************************/
+const OcclusionCuller::OCCLUSION_STATS& SceneManager::GetOcclusionStats() const
+{
+    return(m_occlusionCuller->GetStats());
+}
+
+/***********************************************************
+ *  GetFrameTriangleCount()
+ *
+ *  This method returns the number of triangles drawn by the
+ *  last rendered frame, after culling and level selection.
+ ***********************************************************/
+size_t SceneManager::GetFrameTriangleCount() const
+{
+    return(m_sceneMeshes->GetFrameTriangleCount());
+}
+
+/***********************************************************
+ *  SetFrameProfiler()
+ *
+ *  This method is used for setting the profiler that times
+ *  every draw group of the rendered frames.  No draw groups
+ *  are timed while it is NULL.
+ ***********************************************************/
+void SceneManager::SetFrameProfiler(FrameProfiler* pProfiler)
+{
+    m_pProfiler = pProfiler;
+}
+
+/***********************************************************
+ *  SetJobThreadCount()
+ *
+ *  This method is used for setting the number of threads that
+ *  share the CPU stages of the frames, which includes the
+ *  thread that renders the scene.  It must not be called
+ *  while a frame is rendered.
+ ***********************************************************/
+void SceneManager::SetJobThreadCount(unsigned int threadCount)
+{
+    delete m_jobSystem;
+    m_jobSystem = new JobSystem(threadCount);
+}
+
+/***********************************************************
+ *  GetJobSystem()
+ *
+ *  This method returns the threads that run the CPU stages
+ *  of the frames.
+ ***********************************************************/
+JobSystem* SceneManager::GetJobSystem() const
+{
+    return(m_jobSystem);
+}
+
+/***********************************************************
+ *  CreateGLTexture()
+ *
+ *  This method is used for loading textures from image files
+ *  into the layer of a texture array.  The image is decoded
+ *  by a worker thread, so the textures of a scene are decoded
+ *  at the same time, and its layer is written with the other
+ *  textures when they are bound.  A texture that is in the
+ *  asset pack is created right away instead.  Only the small
+ *  mip levels are uploaded at first, and the finer levels
+ *  are streamed in when the texture is drawn large.
+ ***********************************************************/
+bool SceneManager::CreateGLTexture(const char* filename, const std::string& tag)
+{
+    // the handle of the interned tag is the texture slot, so a
+    // tag can only be used for one texture
+    if (m_textureTags.Intern(tag) != (uint16_t)m_textures.size())
+    {
+        std::cout << "Texture tag is already used or invalid:" << tag << std::endl;
+        return(false);
+    }
+
+    // a baked texture is uploaded straight from the mapped pack,
+    // which needs no decoding and already holds the mipmaps
+    const AssetPack::PACK_ENTRY* pPacked = m_assetPack.FindEntry(AssetPack::ENTRY_TEXTURE, HashTag(tag.c_str()));
+    m_textures.push_back(TEXTURE_INFO());
+    TEXTURE_INFO& texture = m_textures.back();
+    texture.tag = tag;
+    texture.location.arrayIndex = -1;
+    texture.location.layer = 0;
+
+    if ((NULL != pPacked) && UploadPackedTexture(*pPacked, texture))
+    {
+        return(true);
+    }
+
+    // indicate to always flip images vertically when loaded
+    stbi_set_flip_vertically_on_load(true);
+
+    // the queue keeps its elements in place while it grows, so
+    // the worker can write to the texture while more are queued
+    m_pendingTextures.push_back(PENDING_TEXTURE());
+    PENDING_TEXTURE* pTexture = &m_pendingTextures.back();
+    pTexture->filename = filename;
+    pTexture->slot = (int)m_textures.size() - 1;
+    pTexture->levelCount = 0;
+    pTexture->width = 0;
+    pTexture->height = 0;
+    pTexture->colorChannels = 0;
+
+    m_workerPool->Submit([pTexture]()
+        {
+            // try to parse the image data from the specified image file
+            unsigned char* image = stbi_load(
+                pTexture->filename.c_str(),
+                &pTexture->width,
+                &pTexture->height,
+                &pTexture->colorChannels,
+                0);
+
+            // the mip chain is built on the worker as well, it is
+            // kept to stream the finer levels from
+            if ((NULL != image) && ((pTexture->colorChannels == 3) || (pTexture->colorChannels == 4)))
+            {
+                pTexture->levels.assign(
+                    image,
+                    image + (size_t)pTexture->width * pTexture->height * pTexture->colorChannels);
+                pTexture->levelCount = (int)AssetPack::BuildMipChain(
+                    pTexture->levels,
+                    pTexture->width,
+                    pTexture->height,
+                    pTexture->colorChannels);
+            }
+            stbi_image_free(image);
+        });
+
+    return(true);
+}
+
+/***********************************************************
+ *  UploadPendingTextures()
+ *
+ *  This method is used for writing the queued images into
+ *  their texture array layers once the workers have decoded
+ *  them.  A worker also builds the mip chain of its image,
+ *  so the levels that start out resident are uploaded one by
+ *  one and no mipmaps are generated.  The chain is then kept
+ *  by the residency manager to stream the finer levels from.
+ ***********************************************************/
+void SceneManager::UploadPendingTextures()
+{
+    if (m_pendingTextures.empty())
+    {
+        return;
+    }
+
+    m_workerPool->Wait();
+
+    for (size_t i = 0; i < m_pendingTextures.size(); i++)
+    {
+        PENDING_TEXTURE& texture = m_pendingTextures[i];
+
+        if (0 == texture.width)
+        {
+            std::cout << "Could not load image:" << texture.filename << std::endl;
+            continue;
+        }
+
+        std::cout << "Successfully loaded image:" << texture.filename << ", width:" << texture.width << ", height:" << texture.height << ", channels:" << texture.colorChannels << std::endl;
+
+        if (texture.levels.empty())
+        {
+            std::cout << "Not implemented to handle image with " << texture.colorChannels << " channels" << std::endl;
+            continue;
+        }
+
+        // the image goes into the array of the textures with the
+        // same size and format - an RGBA image supports transparency
+        GLenum internalFormat = (texture.colorChannels == 3) ? GL_RGB8 : GL_RGBA8;
+        GLenum format = (texture.colorChannels == 3) ? GL_RGB : GL_RGBA;
+        TextureArrays::TEXTURE_LOCATION location = m_textureArrays->AddTexture(
+            texture.width,
+            texture.height,
+            texture.levelCount,
+            internalFormat,
+            TextureResidency::GetStartLevel(texture.width, texture.height));
+
+        UploadTextureLevels(
+            location,
+            texture.levels.data(),
+            texture.width,
+            texture.height,
+            texture.levelCount,
+            format);
+        // the residency manager takes over the mip chain
+        m_textureResidency->AddTexture(location, texture.levels, format);
+
+        m_textures[texture.slot].location = location;
+    }
+
+    m_pendingTextures.clear();
+}
+
+/***********************************************************
+ *  UploadPackedTexture()
+ *
+ *  This method is used for writing a texture of the asset
+ *  pack into a texture array layer.  Every mip level is read
+ *  straight from the mapped file, so no image is decoded and
+ *  no mipmaps are generated.  Returns false when the entry
+ *  does not hold a whole mip chain.
+ ***********************************************************/
+bool SceneManager::UploadPackedTexture(const AssetPack::PACK_ENTRY& entry, TEXTURE_INFO& texture)
+{
+    uint32_t pixelSize = AssetPack::GetPixelSize(entry.format);
+    uint64_t chainBytes = 0;
+
+    if ((0 == pixelSize) ||
+        ((int)entry.levelCount != TextureArrays::GetFullLevelCount((int)entry.width, (int)entry.height)))
+    {
+        return(false);
+    }
+
+    for (uint32_t level = 0; level < entry.levelCount; level++)
+    {
+        uint64_t width = (entry.width >> level) ? (entry.width >> level) : 1;
+        uint64_t height = (entry.height >> level) ? (entry.height >> level) : 1;
+
+        chainBytes += width * height * pixelSize;
+    }
+    if (chainBytes > entry.size)
+    {
+        return(false);
+    }
+
+    bool bRGB = (AssetPack::FORMAT_RGB8 == entry.format);
+    GLenum format = bRGB ? GL_RGB : GL_RGBA;
+    const unsigned char* pLevel = m_assetPack.GetEntryData(entry);
+
+    texture.location = m_textureArrays->AddTexture(
+        (int)entry.width,
+        (int)entry.height,
+        (int)entry.levelCount,
+        bRGB ? GL_RGB8 : GL_RGBA8,
+        TextureResidency::GetStartLevel((int)entry.width, (int)entry.height));
+
+    UploadTextureLevels(
+        texture.location,
+        pLevel,
+        (int)entry.width,
+        (int)entry.height,
+        (int)entry.levelCount,
+        format);
+    // the finer levels are streamed straight from the mapping
+    m_textureResidency->AddTexture(texture.location, pLevel, format);
+
+    return(true);
+}
+
+/***********************************************************
+ *  UploadTextureLevels()
+ *
+ *  This method is used for writing the levels of a mip chain
+ *  that the array of a texture keeps.  The levels follow each
+ *  other from the full size down, and the levels finer than
+ *  the base level of the array are skipped.
+ ***********************************************************/
+void SceneManager::UploadTextureLevels(
+    const TextureArrays::TEXTURE_LOCATION& location,
+    const unsigned char* levels,
+    int width,
+    int height,
+    int levelCount,
+    GLenum format)
+{
+    GLenum internalFormat = (GL_RGB == format) ? GL_RGB8 : GL_RGBA8;
+    int baseLevel = m_textureArrays->GetBaseLevel(location.arrayIndex);
+    const unsigned char* pLevel = levels;
+
+    // the rows of the levels are not padded
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int level = 0; level < levelCount; level++)
+    {
+        if (level >= baseLevel)
+        {
+            m_textureArrays->UploadLevel(location, level, format, pLevel);
+        }
+        pLevel += TextureArrays::GetLevelBytes(width, height, level, internalFormat);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+/***********************************************************
+ *  BindGLTextures()
+ *
+ *  This method is used for uploading the queued textures into
+ *  their texture arrays.  The arrays are bound while the scene
+ *  is drawn, one for each run of draws, so any number of
+ *  textures can be loaded.
+ ***********************************************************/
+void SceneManager::BindGLTextures()
+{
+    // the scene binds the textures itself once it has started
+    // the other loading work
+    if (m_bDeferTextureBinds)
+    {
+        return;
+    }
+
+    UploadPendingTextures();
+}
+
+/***********************************************************
+ *  DestroyGLTextures()
+ *
+ *  This method is used for freeing the memory of all the
+ *  texture arrays.
+ ***********************************************************/
+void SceneManager::DestroyGLTextures()
+{
+    m_textureResidency->Clear();
+    m_textureArrays->Clear();
+    for (size_t i = 0; i < m_textures.size(); i++)
+    {
+        m_textures[i].location.arrayIndex = -1;
+    }
+}
+
+/***********************************************************
+ *  UploadObjectMaterials()
+ *
+ *  This method is used for packing all of the defined object
+ *  materials into one storage buffer.  The shader reads the
+ *  material for a draw from this table, so a draw only needs
+ *  to pass the index of its material.  A material whose tag
+ *  is already used or collides is left out of the table.
+ ***********************************************************/
+void SceneManager::UploadObjectMaterials()
+{
+    std::vector<GPU_MATERIAL> materials;
+
+    materials.reserve(m_objectMaterials.size());
+    m_materialTags.Clear();
+    for (size_t i = 0; i < m_objectMaterials.size(); i++)
+    {
+        const OBJECT_MATERIAL& material = m_objectMaterials[i];
+
+        // the handle of the interned tag is the table index, so
+        // a tag can only be used for one material
+        if (m_materialTags.Intern(material.tag) != (uint16_t)materials.size())
+        {
+            std::cout << "Material tag is already used or invalid:" << material.tag << std::endl;
+            continue;
+        }
+
+        GPU_MATERIAL gpuMaterial;
+        gpuMaterial.ambientColorStrength = glm::vec4(material.ambientColor, material.ambientStrength);
+        gpuMaterial.diffuseColor = glm::vec4(material.diffuseColor, 1.0f);
+        gpuMaterial.specularShininess = glm::vec4(material.specularColor, material.shininess);
+        materials.push_back(gpuMaterial);
+    }
 
-// declaration of global variables
-namespace
+    // the shader reads entry 0 by default, so the buffer always
+    // holds at least one material
+    if (materials.size() == 0)
+    {
+        GPU_MATERIAL defaultMaterial;
+        defaultMaterial.ambientColorStrength = glm::vec4(1.0f, 1.0f, 1.0f, 0.2f);
+        defaultMaterial.diffuseColor = glm::vec4(1.0f);
+        defaultMaterial.specularShininess = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        materials.push_back(defaultMaterial);
+    }
+
+    if (0 == m_materialSSBO)
+    {
+        glGenBuffers(1, &m_materialSSBO);
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_materialSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, materials.size() * sizeof(GPU_MATERIAL), materials.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // the buffer stays bound for the lifetime of the scene
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_BUFFER_BINDING, m_materialSSBO);
+}
+
+/***********************************************************
+ *  FindObjectTexture()
+ *
+ *  This method is used for finding the array and layer of the
+ *  texture an object is drawn with.  Returns NULL when the
+ *  object is drawn with its color, because it has no texture
+ *  or its texture failed to load.
+ ***********************************************************/
+const TextureArrays::TEXTURE_LOCATION* SceneManager::FindObjectTexture(const SCENE_OBJECT& object) const
 {
-    const char* g_ModelName = "model";
-    const char* g_ColorValueName = "objectColor";
-    const char* g_TextureValueName = "objectTexture";
-    const char* g_UseTextureName = "bUseTexture";
-    const char* g_UseLightingName = "bUseLighting";
+    if ((TagRegistry::INVALID_HANDLE == object.textureHandle) ||
+        (m_textures[object.textureHandle].location.arrayIndex < 0))
+    {
+        return(NULL);
+    }
+
+    return(&m_textures[object.textureHandle].location);
 }
 
 /***********************************************************
- *  SceneManager()
+ *  FindPackedMesh()
  *
- *  The constructor for the class
+ *  This method is used for finding the baked vertex and
+ *  index data of a mesh type at a tessellation level in the
+ *  asset pack.  Returns NULL when the mesh is not in the pack,
+ *  does not hold all of its data, or was built by an older
+ *  version of the shape geometry.
  ***********************************************************/
-SceneManager::SceneManager(ShaderManager* pShaderManager)
+const AssetPack::PACK_ENTRY* SceneManager::FindPackedMesh(MESH_TYPE meshType, int level) const
 {
-    m_pShaderManager = pShaderManager;
-    m_basicMeshes = new ShapeMeshes();
+    if (m_assetPack.GetGeometryVersion() != ShapeGeometry::GEOMETRY_VERSION)
+    {
+        return(NULL);
+    }
 
-    for (int i = 0; i < 16; i++)
+    const AssetPack::PACK_ENTRY* pEntry = m_assetPack.FindEntry(AssetPack::ENTRY_MESH, AssetPack::MakeMeshKey(meshType, level));
+    if ((NULL != pEntry) &&
+        (pEntry->size < (uint64_t)pEntry->vertexCount * sizeof(ShapeGeometry::MESH_VERTEX) + (uint64_t)pEntry->indexCount * sizeof(uint32_t)))
     {
-        m_textureIDs[i].tag = "/0";
-        m_textureIDs[i].ID = -1;
+        return(NULL);
     }
-    m_loadedTextures = 0;
+
+    return(pEntry);
 }
 
 /***********************************************************
- *  ~SceneManager()
+ *  PrebuildMeshes()
  *
- *  The destructor for the class
+ *  This method is used for building the data of every level
+ *  of the referenced mesh types on the worker threads, so the
+ *  first frames only upload the meshes they draw.  The caller
+ *  waits for the workers before any mesh is uploaded.
  ***********************************************************/
-SceneManager::~SceneManager()
+void SceneManager::PrebuildMeshes()
 {
-    m_pShaderManager = NULL;
-    delete m_basicMeshes;
-    m_basicMeshes = NULL;
+    for (int meshType = 0; meshType < MESH_COUNT; meshType++)
+    {
+        int levelCount = ShapeGeometry::HasLevels((ShapeGeometry::SHAPE)meshType) ? LOD_COUNT : 1;
 
-    DestroyGLTextures();
+        if (m_meshReferences[meshType] == 0)
+        {
+            continue;
+        }
+
+        for (int level = 0; level < levelCount; level++)
+        {
+            MESH_SLOT* pSlot = &m_meshSlots[meshType][level];
+
+            // the baked meshes are uploaded from the pack
+            if ((pSlot->meshIndex >= 0) || pSlot->bBuilt ||
+                (NULL != FindPackedMesh((MESH_TYPE)meshType, level)))
+            {
+                continue;
+            }
+
+            m_workerPool->Submit([pSlot, meshType, level]()
+                {
+                    ShapeGeometry::BuildShapeMesh((ShapeGeometry::SHAPE)meshType, level, pSlot->builtData);
+                    pSlot->bBuilt = true;
+                });
+        }
+    }
 }
 
 /***********************************************************
- *  CreateGLTexture()
+ *  ReferenceMesh()
  *
- *  This method is used for loading textures from image files,
- *  configuring the texture mapping parameters in OpenGL,
- *  generating the mipmaps, and loading the read texture into
- *  the next available texture slot in memory.
+ *  This method is used for counting one more object that is
+ *  drawn with a mesh type.  The bounds of the mesh type are
+ *  found the first time it is referenced, but the mesh is
+ *  only uploaded when an object using it is first drawn.
+ *  The bounds of the finest level hold the vertices of the
+ *  coarser levels, which lie on the same circles.
  ***********************************************************/
-bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
+void SceneManager::ReferenceMesh(MESH_TYPE meshType)
 {
-    int width = 0;
-    int height = 0;
-    int colorChannels = 0;
-    GLuint textureID = 0;
-
-    // indicate to always flip images vertically when loaded
-    stbi_set_flip_vertically_on_load(true);
+    if (m_bMeshBoundsFound[meshType] == false)
+    {
+        MESH_SLOT& slot = m_meshSlots[meshType][0];
+        const AssetPack::PACK_ENTRY* pPacked = FindPackedMesh(meshType, 0);
 
-    // try to parse the image data from the specified image file
-    unsigned char* image = stbi_load(
-        filename,
-        &width,
-        &height,
-        &colorChannels,
-        0);
-
-    // if the image was successfully read from the image file
-    if (image)
-    {
-        std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
-
-        glGenTextures(1, &textureID);
-        glBindTexture(GL_TEXTURE_2D, textureID);
-
-        // set the texture wrapping parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        // set texture filtering parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        // if the loaded image is in RGB format
-        if (colorChannels == 3)
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-        // if the loaded image is in RGBA format - it supports transparency
-        else if (colorChannels == 4)
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
+        if (NULL != pPacked)
+        {
+            m_meshBounds[meshType] = SceneBVH::ComputeMeshBounds(
+                (const ShapeGeometry::MESH_VERTEX*)m_assetPack.GetEntryData(*pPacked),
+                pPacked->vertexCount);
+        }
         else
         {
-            std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
-            return false;
+            // the data is kept for the upload of the mesh
+            ShapeGeometry::BuildShapeMesh((ShapeGeometry::SHAPE)meshType, 0, slot.builtData);
+            slot.bBuilt = true;
+            m_meshBounds[meshType] = SceneBVH::ComputeMeshBounds(slot.builtData);
         }
+        m_bMeshBoundsFound[meshType] = true;
+    }
+
+    m_meshReferences[meshType]++;
+}
 
-        // generate the texture mipmaps for mapping textures to lower resolutions
-        glGenerateMipmap(GL_TEXTURE_2D);
+/***********************************************************
+ *  ReleaseMesh()
+ *
+ *  This method is used for counting one less object that is
+ *  drawn with a mesh type.  A mesh type without references
+ *  stays uploaded until it is evicted for the memory budget.
+ ***********************************************************/
+void SceneManager::ReleaseMesh(MESH_TYPE meshType)
+{
+    if (m_meshReferences[meshType] > 0)
+    {
+        m_meshReferences[meshType]--;
+    }
+}
 
-        // free the image data from local memory
-        stbi_image_free(image);
-        glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+/***********************************************************
+ *  GetLevelMesh()
+ *
+ *  This method is used for finding the uploaded mesh of a
+ *  mesh type at a tessellation level for the current frame.
+ *  The mesh is built and uploaded the first time it is drawn
+ *  or when it was evicted.  Returns the mesh index.
+ ***********************************************************/
+int SceneManager::GetLevelMesh(MESH_TYPE meshType, int level)
+{
+    if (ShapeGeometry::HasLevels((ShapeGeometry::SHAPE)meshType) == false)
+    {
+        level = 0;
+    }
 
-        // register the loaded texture and associate it with the special tag string
-        m_textureIDs[m_loadedTextures].ID = textureID;
-        m_textureIDs[m_loadedTextures].tag = tag;
-        m_loadedTextures++;
+    MESH_SLOT& slot = m_meshSlots[meshType][level];
+    const AssetPack::PACK_ENTRY* pPacked = NULL;
+    if ((slot.meshIndex < 0) && (slot.bBuilt == false))
+    {
+        pPacked = FindPackedMesh(meshType, level);
+    }
 
-        return true;
+    if (NULL != pPacked)
+    {
+        const unsigned char* pData = m_assetPack.GetEntryData(*pPacked);
+
+        // the indices follow the vertices in the pack
+        slot.meshIndex = m_sceneMeshes->AddMesh(
+            (const ShapeGeometry::MESH_VERTEX*)pData,
+            pPacked->vertexCount,
+            (const uint32_t*)(pData + pPacked->vertexCount * sizeof(ShapeGeometry::MESH_VERTEX)),
+            pPacked->indexCount);
     }
+    else if (slot.meshIndex < 0)
+    {
+        if (slot.bBuilt == false)
+        {
+            ShapeGeometry::BuildShapeMesh((ShapeGeometry::SHAPE)meshType, level, slot.builtData);
+        }
+        slot.meshIndex = m_sceneMeshes->AddMesh(slot.builtData);
 
-    std::cout << "Could not load image:" << filename << std::endl;
+        // the data is built again if the mesh is evicted
+        slot.builtData = ShapeGeometry::MESH_DATA();
+        slot.bBuilt = false;
+    }
+    slot.lastUsedFrame = m_frameNumber;
 
-    // Error loading the image
-    return false;
+    return(slot.meshIndex);
 }
 
 /***********************************************************
- *  BindGLTextures()
+ *  EvictMeshes()
  *
- *  This method is used for binding the loaded textures to
- *  OpenGL texture memory slots.  There are up to 16 slots.
+ *  This method is used for removing uploaded meshes while
+ *  the mesh data is over the memory budget.  The meshes of
+ *  mesh types without references are removed first, then the
+ *  levels that were drawn the longest time ago.  A mesh drawn
+ *  in the current frame is never removed, so the budget can
+ *  be exceeded by what is on screen.
  ***********************************************************/
-void SceneManager::BindGLTextures()
+void SceneManager::EvictMeshes()
 {
-    for (int i = 0; i < m_loadedTextures; i++)
+    while (m_sceneMeshes->GetMeshBytes() > m_meshBudget)
     {
-        // bind textures on corresponding texture units
-        glActiveTexture(GL_TEXTURE0 + i);
-        glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
+        MESH_SLOT* pEvict = NULL;
+        bool bEvictReferenced = true;
+
+        for (int meshType = 0; meshType < MESH_COUNT; meshType++)
+        {
+            bool bReferenced = (m_meshReferences[meshType] > 0);
+
+            for (int level = 0; level < LOD_COUNT; level++)
+            {
+                MESH_SLOT& slot = m_meshSlots[meshType][level];
+
+                if ((slot.meshIndex < 0) || (slot.lastUsedFrame == m_frameNumber))
+                {
+                    continue;
+                }
+
+                if ((NULL == pEvict) ||
+                    (bEvictReferenced && (bReferenced == false)) ||
+                    ((bEvictReferenced == bReferenced) && (slot.lastUsedFrame < pEvict->lastUsedFrame)))
+                {
+                    pEvict = &slot;
+                    bEvictReferenced = bReferenced;
+                }
+            }
+        }
+
+        if (NULL == pEvict)
+        {
+            break;
+        }
+
+        m_sceneMeshes->RemoveMesh(pEvict->meshIndex);
+        pEvict->meshIndex = -1;
     }
 }
 
 /***********************************************************
- *  DestroyGLTextures()
+ *  DrawQueuedCommands()
  *
- *  This method is used for freeing the memory in all the
- *  used texture memory slots.
+ *  This method is used for submitting the draws queued since
+ *  the last submit as one draw group, which is timed by the
+ *  frame profiler.  Nothing is timed when no draws are queued.
  ***********************************************************/
-void SceneManager::DestroyGLTextures()
+void SceneManager::DrawQueuedCommands()
 {
-    for (int i = 0; i < m_loadedTextures; i++)
+    if (m_sceneMeshes->HasQueuedCommands() == false)
     {
-        glGenTextures(1, &m_textureIDs[i].ID);
+        return;
     }
+
+    ProfileScope scope(m_pProfiler, "DrawGroup");
+    m_sceneMeshes->DrawCommands();
 }
 
 /***********************************************************
- *  FindTextureID()
+ *  UpdateModelMatrices()
  *
- *  This method is used for getting an ID for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  This method is used for composing the model matrices of
+ *  all of the scene objects in one batch, which is only done
+ *  when an object was added or moved since the last frame.
+ *  The objects are split into ranges that are composed on
+ *  the threads of the job system.
  ***********************************************************/
-int SceneManager::FindTextureID(std::string tag)
+void SceneManager::UpdateModelMatrices()
 {
-    int textureID = -1;
-    int index = 0;
-    bool bFound = false;
-
-    while ((index < m_loadedTextures) && (bFound == false))
+    if (m_bTransformsDirty == false)
     {
-        if (m_textureIDs[index].tag.compare(tag) == 0)
-        {
-            textureID = m_textureIDs[index].ID;
-            bFound = true;
-        }
-        else
-            index++;
+        return;
     }
 
-    return(textureID);
+    m_modelMatrices.resize(m_objectTransforms.GetCount());
+    glm::mat4* models = m_modelMatrices.data();
+    m_jobSystem->ParallelFor(m_modelMatrices.size(), OBJECT_GRAIN_SIZE, [this, models](size_t first, size_t end)
+    {
+        m_objectTransforms.ComputeModelMatrices(first, end - first, models);
+    });
+    m_bTransformsDirty = false;
+
+    UpdateObjectBounds();
 }
 
 /***********************************************************
- *  FindTextureSlot()
+ *  UpdateObjectBounds()
  *
- *  This method is used for getting a slot index for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  This method is used for placing the mesh bounds of the
+ *  objects in the world with their model matrices.  The tree
+ *  is built again when objects were added, otherwise only the
+ *  objects that moved are refit.  The bounds are placed on
+ *  the threads of the job system, and the tree is changed by
+ *  the calling thread alone.
  ***********************************************************/
-int SceneManager::FindTextureSlot(std::string tag)
+void SceneManager::UpdateObjectBounds()
 {
-    int textureSlot = -1;
-    int index = 0;
-    bool bFound = false;
+    if (m_sceneBVH.GetObjectCount() != m_sceneObjects.size())
+    {
+        std::vector<SceneBVH::BOUNDS> objectBounds(m_sceneObjects.size());
+        SceneBVH::BOUNDS* bounds = objectBounds.data();
 
-    while ((index < m_loadedTextures) && (bFound == false))
+        m_jobSystem->ParallelFor(objectBounds.size(), OBJECT_GRAIN_SIZE, [this, bounds](size_t first, size_t end)
+        {
+            for (size_t i = first; i < end; i++)
+            {
+                bounds[i] = SceneBVH::TransformBounds(m_meshBounds[m_sceneObjects[i].mesh], m_modelMatrices[i]);
+            }
+        });
+        m_sceneBVH.Build(objectBounds.data(), objectBounds.size());
+    }
+    else
     {
-        if (m_textureIDs[index].tag.compare(tag) == 0)
+        m_movedBounds.resize(m_movedObjects.size());
+        SceneBVH::BOUNDS* bounds = m_movedBounds.data();
+
+        m_jobSystem->ParallelFor(m_movedObjects.size(), OBJECT_GRAIN_SIZE, [this, bounds](size_t first, size_t end)
         {
-            textureSlot = index;
-            bFound = true;
+            for (size_t i = first; i < end; i++)
+            {
+                uint32_t objectIndex = m_movedObjects[i];
+
+                bounds[i] = SceneBVH::TransformBounds(m_meshBounds[m_sceneObjects[objectIndex].mesh], m_modelMatrices[objectIndex]);
+            }
+        });
+        for (size_t i = 0; i < m_movedObjects.size(); i++)
+        {
+            m_sceneBVH.UpdateObject(m_movedObjects[i], m_movedBounds[i]);
         }
-        else
-            index++;
     }
 
-    return(textureSlot);
+    m_movedObjects.clear();
 }
 
 /***********************************************************
- *  FindMaterial()
+ *  CullSceneObjects()
  *
- *  This method is used for getting a material from the previously
- *  defined materials list that is associated with the passed in tag.
+ *  This method is used for finding the objects of the scene
+ *  that are inside the view frustum of the current frame,
+ *  and then removing the ones hidden behind the depth of an
+ *  earlier frame.  Only the remaining objects are queued for
+ *  drawing.  The occlusion tests run on the threads of the
+ *  job system, and the visible objects are then packed in
+ *  their order.
  ***********************************************************/
-bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
+void SceneManager::CullSceneObjects()
 {
-    if (m_objectMaterials.size() == 0)
+    glm::mat4 viewProjection = m_sceneView.projection * m_sceneView.view;
+    SceneBVH::FRUSTUM frustum = SceneBVH::ExtractFrustum(viewProjection);
+
+    m_sceneBVH.Cull(frustum, m_visibleObjects, m_cullStats);
+
+    if (m_occlusionCuller->BeginFrame(
+        viewProjection,
+        m_sceneView.viewportWidth,
+        m_sceneView.viewportHeight,
+        m_sceneVersion) == false)
     {
-        return(false);
+        return;
     }
 
-    int index = 0;
-    bool bFound = false;
-    while ((index < m_objectMaterials.size()) && (bFound == false))
+    m_occludedObjects.resize(m_visibleObjects.size());
+    uint8_t* occluded = m_occludedObjects.data();
+    m_jobSystem->ParallelFor(m_visibleObjects.size(), OBJECT_GRAIN_SIZE, [this, occluded](size_t first, size_t end)
     {
-        if (m_objectMaterials[index].tag.compare(tag) == 0)
+        for (size_t i = first; i < end; i++)
         {
-            bFound = true;
-            material.ambientColor = m_objectMaterials[index].ambientColor;
-            material.ambientStrength = m_objectMaterials[index].ambientStrength;
-            material.diffuseColor = m_objectMaterials[index].diffuseColor;
-            material.specularColor = m_objectMaterials[index].specularColor;
-            material.shininess = m_objectMaterials[index].shininess;
+            occluded[i] = m_occlusionCuller->IsOccluded(m_sceneBVH.GetObjectBounds(m_visibleObjects[i])) ? 1 : 0;
         }
-        else
+    });
+
+    size_t visibleCount = 0;
+    for (size_t i = 0; i < m_visibleObjects.size(); i++)
+    {
+        if (0 == occluded[i])
         {
-            index++;
+            m_visibleObjects[visibleCount] = m_visibleObjects[i];
+            visibleCount++;
         }
     }
+    m_occlusionCuller->AddTestCounts(
+        (uint32_t)m_visibleObjects.size(),
+        (uint32_t)(m_visibleObjects.size() - visibleCount));
+    m_visibleObjects.resize(visibleCount);
+}
 
-    return(true);
+/***********************************************************
+ *  CaptureSceneDepth()
+ *
+ *  This method is used for reading back the depth of the
+ *  opaque draws of the current frame, which hides objects
+ *  from the occlusion tests of the next frames.
+ ***********************************************************/
+void SceneManager::CaptureSceneDepth()
+{
+    m_occlusionCuller->CaptureDepth(
+        m_sceneView.projection * m_sceneView.view,
+        m_sceneView.viewportWidth,
+        m_sceneView.viewportHeight,
+        m_sceneVersion);
 }
 
 /***********************************************************
- *  SetTransformations()
+ *  SelectObjectLevels()
  *
- *  This method is used for setting the transform buffer
- *  using the passed in transformation values.
+ *  This method is used for picking the tessellation level of
+ *  every visible object from the diameter of its bounding
+ *  sphere on the screen.  An object only moves to a finer
+ *  level once it is clearly larger than the size of that
+ *  level, and to a coarser level once it is clearly smaller,
+ *  so an object close to a size keeps its level.  Every
+ *  object is picked on its own, on the threads of the job
+ *  system.
  ***********************************************************/
-void SceneManager::SetTransformations(
-    glm::vec3 scaleXYZ,
-    float XrotationDegrees,
-    float YrotationDegrees,
-    float ZrotationDegrees,
-    glm::vec3 positionXYZ)
+void SceneManager::SelectObjectLevels()
 {
-    // variables for this method
-    glm::mat4 modelView;
-    glm::mat4 scale;
-    glm::mat4 rotationX;
-    glm::mat4 rotationY;
-    glm::mat4 rotationZ;
-    glm::mat4 translation;
+    // the pixels covered by one unit at a distance of one, the
+    // projection of a perspective camera divides by the depth
+    float pixelsPerUnit = m_sceneView.projection[1][1] * m_sceneView.viewportHeight * 0.5f;
+    bool bPerspective = (m_sceneView.projection[2][3] != 0.0f);
 
-    // set the scale value in the transform buffer
-    scale = glm::scale(scaleXYZ);
-    // set the rotation values in the transform buffer
-    rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
-    rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
-    rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
-    // set the translation value in the transform buffer
-    translation = glm::translate(positionXYZ);
+    m_jobSystem->ParallelFor(m_visibleObjects.size(), OBJECT_GRAIN_SIZE, [this, pixelsPerUnit, bPerspective](size_t first, size_t end)
+    {
+        for (size_t v = first; v < end; v++)
+        {
+            uint32_t i = m_visibleObjects[v];
+            SCENE_OBJECT& object = m_sceneObjects[i];
+            const SceneBVH::BOUNDS& bounds = m_sceneBVH.GetObjectBounds(i);
+            float screenSize = bounds.radius * 2.0f * pixelsPerUnit;
+            int level = object.lodLevel;
+
+            if (bPerspective)
+            {
+                float viewDepth = -(m_sceneView.view * glm::vec4(bounds.center, 1.0f)).z;
+
+                // the camera is inside of the sphere
+                if (viewDepth <= bounds.radius)
+                {
+                    object.lodLevel = 0;
+                    continue;
+                }
+                screenSize /= viewDepth;
+            }
+
+            while ((level > 0) && (screenSize > LOD_SCREEN_SIZES[level - 1] * (1.0f + LOD_HYSTERESIS)))
+            {
+                level--;
+            }
+            while ((level < LOD_COUNT - 1) && (screenSize < LOD_SCREEN_SIZES[level] * (1.0f - LOD_HYSTERESIS)))
+            {
+                level++;
+            }
+
+            object.lodLevel = (uint8_t)level;
+        }
+    });
+}
 
-    modelView = translation * rotationX * rotationY * rotationZ * scale;
+/***********************************************************
+ *  RequestTextureLevels()
+ *
+ *  This method is used for requesting the mip level that every
+ *  visible textured object is drawn at, from the texels of its
+ *  texture across the object and the pixels of its bounding
+ *  sphere on the screen.  Every level halves the texels, so
+ *  the level is the one with about one texel for each pixel.
+ ***********************************************************/
+void SceneManager::RequestTextureLevels()
+{
+    float pixelsPerUnit = m_sceneView.projection[1][1] * m_sceneView.viewportHeight * 0.5f;
+    bool bPerspective = (m_sceneView.projection[2][3] != 0.0f);
 
-    if (NULL != m_pShaderManager)
+    for (size_t v = 0; v < m_visibleObjects.size(); v++)
     {
-        m_pShaderManager->setMat4Value(g_ModelName, modelView);
+        uint32_t i = m_visibleObjects[v];
+        const SCENE_OBJECT& object = m_sceneObjects[i];
+        const TextureArrays::TEXTURE_LOCATION* pTexture = FindObjectTexture(object);
+
+        if (NULL == pTexture)
+        {
+            continue;
+        }
+
+        const SceneBVH::BOUNDS& bounds = m_sceneBVH.GetObjectBounds(i);
+        int arrayIndex = pTexture->arrayIndex;
+        int width = m_textureArrays->GetArrayWidth(arrayIndex);
+        int height = m_textureArrays->GetArrayHeight(arrayIndex);
+        int levelCount = m_textureArrays->GetLevelCount(arrayIndex);
+        float texelsAcross = (float)((width > height) ? width : height) * glm::max(object.UVscale.x, object.UVscale.y);
+        float screenSize = bounds.radius * 2.0f * pixelsPerUnit;
+        int level = 0;
+
+        if (bPerspective)
+        {
+            float viewDepth = -(m_sceneView.view * glm::vec4(bounds.center, 1.0f)).z;
+
+            // the camera is inside of the sphere, so the object
+            // can cover the whole screen
+            screenSize = (viewDepth > bounds.radius) ? (screenSize / viewDepth) : texelsAcross;
+        }
+
+        while ((level < levelCount - 1) && (texelsAcross > screenSize * 2.0f))
+        {
+            texelsAcross *= 0.5f;
+            level++;
+        }
+
+        m_textureResidency->RequestLevel(arrayIndex, level, m_frameNumber);
     }
 }
 
 /***********************************************************
- *  SetShaderColor()
+ *  BuildRenderQueue()
+ *
+ *  This method is used for queueing one draw for every object
+ *  inside the view frustum and sorting the draws by their
+ *  keys.  Objects with a color that is not fully opaque are
+ *  queued as translucent so they are drawn last, back-to-front.
  *
- *  This method is used for setting the passed in color
- *  into the shader for the next draw command
+ *  The keys are built on the threads of the job system.  The
+ *  meshes are uploaded on the thread of the OpenGL context,
+ *  so the levels of the mesh types that are drawn are found
+ *  first, their meshes are found or uploaded by the calling
+ *  thread, and then every job writes the draws of its own
+ *  range of the queue.
  ***********************************************************/
-void SceneManager::SetShaderColor(
-    float redColorValue,
-    float greenColorValue,
-    float blueColorValue,
-    float alphaValue)
+void SceneManager::BuildRenderQueue()
 {
-    // variables for this method
-    glm::vec4 currentColor;
+    size_t visibleCount = m_visibleObjects.size();
+    std::atomic<uint32_t> usedLevels[MESH_COUNT];
+    int levelMeshes[MESH_COUNT][LOD_COUNT];
+
+    for (int meshType = 0; meshType < MESH_COUNT; meshType++)
+    {
+        usedLevels[meshType] = 0;
+    }
+
+    // every job collects the levels of its objects, and adds
+    // them to the shared masks one time
+    m_jobSystem->ParallelFor(visibleCount, OBJECT_GRAIN_SIZE, [this, &usedLevels](size_t first, size_t end)
+    {
+        uint32_t levels[MESH_COUNT] = {};
+
+        for (size_t v = first; v < end; v++)
+        {
+            const SCENE_OBJECT& object = m_sceneObjects[m_visibleObjects[v]];
+
+            levels[object.mesh] |= 1u << object.lodLevel;
+        }
+        for (int meshType = 0; meshType < MESH_COUNT; meshType++)
+        {
+            if (0 != levels[meshType])
+            {
+                usedLevels[meshType].fetch_or(levels[meshType]);
+            }
+        }
+    });
+
+    for (int meshType = 0; meshType < MESH_COUNT; meshType++)
+    {
+        for (int level = 0; level < LOD_COUNT; level++)
+        {
+            levelMeshes[meshType][level] = -1;
+            if (0 != (usedLevels[meshType].load() & (1u << level)))
+            {
+                levelMeshes[meshType][level] = GetLevelMesh((MESH_TYPE)meshType, level);
+            }
+        }
+    }
+
+    m_renderQueue.Resize(visibleCount);
+    m_jobSystem->ParallelFor(visibleCount, OBJECT_GRAIN_SIZE, [this, &levelMeshes](size_t first, size_t end)
+    {
+        for (size_t v = first; v < end; v++)
+        {
+            uint32_t i = m_visibleObjects[v];
+            SCENE_OBJECT& object = m_sceneObjects[i];
+            int meshIndex = levelMeshes[object.mesh][object.lodLevel];
+
+            // the run of draws of the object is found by this mesh
+            object.meshIndex = meshIndex;
+
+            // view space looks down the negative z axis, the last
+            // column of the model matrix is the object position
+            glm::vec4 viewPosition = m_sceneView.view * m_modelMatrices[i][3];
+            float viewDepth = -viewPosition.z;
+            uint64_t key = 0;
+
+            // the draws are grouped by texture array, the objects
+            // drawn with their color come first
+            const TextureArrays::TEXTURE_LOCATION* pTexture = FindObjectTexture(object);
+            uint32_t textureArray = (NULL != pTexture) ? (uint32_t)(pTexture->arrayIndex + 1) : 0;
+
+            // there is only the one shader program for now
+            if ((NULL == pTexture) && (object.color.a < 1.0f))
+            {
+                key = RenderQueue::MakeTranslucentKey(0, textureArray, meshIndex, object.materialHandle, viewDepth);
+            }
+            else
+            {
+                key = RenderQueue::MakeOpaqueKey(0, textureArray, meshIndex, object.materialHandle, viewDepth);
+            }
+
+            m_renderQueue.SetEntry(v, key, i);
+        }
+    });
+
+    m_renderQueue.Sort(m_jobSystem);
+}
 
-    currentColor.r = redColorValue;
-    currentColor.g = greenColorValue;
-    currentColor.b = blueColorValue;
-    currentColor.a = alphaValue;
+/***********************************************************
+ *  LoadSceneFileTextures()
+ *
+ *  This method is used for loading the textures of the scene
+ *  file, each one with the tag and image file of its entry.
+ ***********************************************************/
+void SceneManager::LoadSceneFileTextures()
+{
+    const SceneFile::SCENE_TEXTURE* textures = m_sceneFile.GetTextures();
 
-    if (NULL != m_pShaderManager)
+    for (uint32_t i = 0; i < m_sceneFile.GetTextureCount(); i++)
     {
-        m_pShaderManager->setIntValue(g_UseTextureName, false);
-        m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
+        CreateGLTexture(
+            m_sceneFile.GetString(textures[i].fileString),
+            m_sceneFile.GetString(textures[i].tagString));
     }
 }
 
 /***********************************************************
- *  SetShaderTexture()
+ *  DefineSceneFileMaterials()
  *
- *  This method is used for setting the texture data
- *  associated with the passed in ID into the shader.
+ *  This method is used for defining the materials of the
+ *  scene file.
  ***********************************************************/
-void SceneManager::SetShaderTexture(
-    std::string textureTag)
+void SceneManager::DefineSceneFileMaterials()
 {
-    if (NULL != m_pShaderManager)
+    const SceneFile::SCENE_MATERIAL* materials = m_sceneFile.GetMaterials();
+
+    m_objectMaterials.reserve(m_objectMaterials.size() + m_sceneFile.GetMaterialCount());
+    for (uint32_t i = 0; i < m_sceneFile.GetMaterialCount(); i++)
     {
-        m_pShaderManager->setIntValue(g_UseTextureName, true);
+        OBJECT_MATERIAL material;
 
-        int textureID = -1;
-        textureID = FindTextureSlot(textureTag);
-        m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
+        material.ambientColor = materials[i].ambientColor;
+        material.ambientStrength = materials[i].ambientStrength;
+        material.diffuseColor = materials[i].diffuseColor;
+        material.specularColor = materials[i].specularColor;
+        material.shininess = materials[i].shininess;
+        material.tag = m_sceneFile.GetString(materials[i].tagString);
+        m_objectMaterials.push_back(material);
     }
 }
 
 /***********************************************************
- *  SetTextureUVScale()
+ *  SetupSceneFileLights()
  *
- *  This method is used for setting the texture UV scale
- *  values into the shader.
+ *  This method is used for adding the lights of the scene
+ *  file to the scene lights.
  ***********************************************************/
-void SceneManager::SetTextureUVScale(float u, float v)
+void SceneManager::SetupSceneFileLights()
 {
-    if (NULL != m_pShaderManager)
+    const SceneFile::SCENE_LIGHT* lights = m_sceneFile.GetLights();
+
+    for (uint32_t i = 0; i < m_sceneFile.GetLightCount(); i++)
     {
-        m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
+        LightClusters::LIGHT_SOURCE light;
+
+        light.position = lights[i].position;
+        light.ambientColor = lights[i].ambientColor;
+        light.diffuseColor = lights[i].diffuseColor;
+        light.specularColor = lights[i].specularColor;
+        light.focalStrength = lights[i].focalStrength;
+        light.specularIntensity = lights[i].specularIntensity;
+        light.range = lights[i].range;
+        m_lightClusters->AddLight(light);
     }
 }
 
 /***********************************************************
- *  SetShaderMaterial()
+ *  DefineSceneFileObjects()
  *
- *  This method is used for passing the material values
- *  into the shader.
+ *  This method is used for adding the objects of the scene
+ *  file to the retained scene.  The object arrays are grown
+ *  one time for all of the objects, and an object with a
+ *  mesh that is not known is skipped.
  ***********************************************************/
-void SceneManager::SetShaderMaterial(
-    std::string materialTag)
+void SceneManager::DefineSceneFileObjects()
 {
-    if (m_objectMaterials.size() > 0)
+    const SceneFile::SCENE_OBJECT* objects = m_sceneFile.GetObjects();
+    size_t objectCount = m_sceneObjects.size() + m_sceneFile.GetObjectCount();
+
+    m_sceneObjects.reserve(objectCount);
+    m_objectTransforms.Reserve(objectCount);
+    for (uint32_t i = 0; i < m_sceneFile.GetObjectCount(); i++)
     {
-        OBJECT_MATERIAL material;
-        bool bReturn = false;
+        const SceneFile::SCENE_OBJECT& fileObject = objects[i];
+
+        if (fileObject.mesh >= (uint32_t)MESH_COUNT)
+        {
+            continue;
+        }
 
-        bReturn = FindMaterial(materialTag, material);
-        if (bReturn == true)
+        int object = AddSceneObject(
+            (MESH_TYPE)fileObject.mesh,
+            fileObject.scaleXYZ,
+            fileObject.rotationDegrees.x,
+            fileObject.rotationDegrees.y,
+            fileObject.rotationDegrees.z,
+            fileObject.positionXYZ);
+        SetObjectColor(object, fileObject.color.r, fileObject.color.g, fileObject.color.b, fileObject.color.a);
+        if (SceneFile::NO_TAG != fileObject.textureTag)
         {
-            m_pShaderManager->setVec3Value("material.ambientColor", material.ambientColor);
-            m_pShaderManager->setFloatValue("material.ambientStrength", material.ambientStrength);
-            m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-            m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-            m_pShaderManager->setFloatValue("material.shininess", material.shininess);
+            SetObjectTexture(object, fileObject.textureTag);
         }
+        if (SceneFile::NO_TAG != fileObject.materialTag)
+        {
+            SetObjectMaterial(object, fileObject.materialTag);
+        }
+        SetObjectUVScale(object, fileObject.UVscale.x, fileObject.UVscale.y);
     }
 }
 
@@ -390,9 +1597,17 @@ void SceneManager::SetShaderMaterial(
 void SceneManager::LoadSceneTextures()
 {
     /*** STUDENTS - add the code BELOW for loading the textures that ***/
-    /*** will be used for mapping to objects in the 3D scene. Up to  ***/
-    /*** 16 textures can be loaded per scene. Refer to the code in   ***/
-    /*** the OpenGL Sample for help.                                 ***/
+    /*** will be used for mapping to objects in the 3D scene. Any    ***/
+    /*** number of textures can be loaded per scene. Refer to the    ***/
+    /*** code in the OpenGL Sample for help.                         ***/
+
+    // the textures of a scene file replace the ones below
+    if (m_sceneFile.IsOpen())
+    {
+        LoadSceneFileTextures();
+        BindGLTextures();
+        return;
+    }
 
     CreateGLTexture("Source/Brick.jpg", "brickTexture");
     CreateGLTexture("Source/Wood.jpg", "woodTexture");
@@ -405,8 +1620,8 @@ void SceneManager::LoadSceneTextures()
 
 
     // after the texture image data is loaded into memory, the
-    // loaded textures need to be bound to texture slots - there
-    // are a total of 16 available slots for scene textures
+    // loaded textures need to be written into their texture
+    // arrays, which are bound while the scene is drawn
     BindGLTextures();
 }
 
@@ -419,22 +1634,102 @@ void SceneManager::LoadSceneTextures()
  ***********************************************************/
 void SceneManager::PrepareScene()
 {
-    // only one instance of a particular mesh needs to be
-    // loaded in memory no matter how many times it is drawn
-    // in the rendered 3D scene
-    LoadSceneTextures();
+    if (m_bLoadingStarted == false)
+    {
+        StartSceneLoading();
+    }
+
+    // the shader program is in use by now, so the uniforms
+    // that are written for every draw can be looked up once
+    ResolveShaderUniforms();
+    LightClusters::BindClusterBlock(GetActiveShaderProgram());
+
+    // build the material table once for the whole scene
+    DefineObjectMaterials();
+    UploadObjectMaterials();
 
     SetupSceneLights();
 
-    m_basicMeshes->LoadBoxMesh();
-    m_basicMeshes->LoadPlaneMesh();
-    m_basicMeshes->LoadCylinderMesh();
-    m_basicMeshes->LoadConeMesh();
-    m_basicMeshes->LoadPrismMesh();
-    m_basicMeshes->LoadPyramid4Mesh();
-    m_basicMeshes->LoadSphereMesh();
-    m_basicMeshes->LoadTaperedCylinderMesh();
-    m_basicMeshes->LoadTorusMesh();
+    // the meshes are uploaded when the objects using them are
+    // first drawn, the objects reference the textures and
+    // materials by their tags, so they are added after those
+    // are loaded
+    DefineSceneObjects();
+
+    // the workers build the meshes of the scene while the
+    // decoded textures are uploaded
+    PrebuildMeshes();
+    BindGLTextures();
+    m_workerPool->Wait();
+}
+
+/***********************************************************
+ *  OpenSceneFile()
+ *
+ *  This method is used for loading a scene file, which is
+ *  either the compiled binary form or the text form.  The
+ *  textures, materials, lights and objects of the file are
+ *  used instead of the ones defined in the code, so it must
+ *  be called before StartSceneLoading().  Returns false when
+ *  the file is missing or not valid.
+ ***********************************************************/
+bool SceneManager::OpenSceneFile(const char* filename)
+{
+    if (m_sceneFile.Open(filename) == false)
+    {
+        return(false);
+    }
+
+    std::cout << "Using scene file:" << filename << ", objects:" << m_sceneFile.GetObjectCount() << std::endl;
+
+    return(true);
+}
+
+/***********************************************************
+ *  StartSceneLoading()
+ *
+ *  This method is used for opening the asset pack and queueing
+ *  the scene textures, which the worker threads start to
+ *  decode right away.  It needs no shader program, so it can
+ *  be called before the shaders are compiled to decode the
+ *  images at the same time.  The textures are uploaded and
+ *  bound by PrepareScene().
+ ***********************************************************/
+void SceneManager::StartSceneLoading()
+{
+    m_bLoadingStarted = true;
+
+    // the baked assets are used when the packer has been run,
+    // otherwise the source images are decoded and the meshes
+    // are built
+    if (m_assetPack.Open(g_AssetPackName))
+    {
+        std::cout << "Using asset pack:" << g_AssetPackName << std::endl;
+    }
+
+    // the compiled scene is used when the packer has been run
+    // since the text form last changed, then the text form,
+    // and the scene defined in the code when there is no scene
+    // file at all
+    if (m_sceneFile.IsOpen() == false)
+    {
+        uint32_t textHash = 0;
+        bool bHasText = SceneFile::HashTextFile(g_SceneTextName, textHash);
+
+        if (OpenSceneFile(g_SceneFileName) && bHasText && (m_sceneFile.GetSourceHash() != textHash))
+        {
+            std::cout << "Compiled scene is older than " << g_SceneTextName << ", using the text form" << std::endl;
+            m_sceneFile.Close();
+        }
+        if (m_sceneFile.IsOpen() == false)
+        {
+            OpenSceneFile(g_SceneTextName);
+        }
+    }
+
+    m_bDeferTextureBinds = true;
+    LoadSceneTextures();
+    m_bDeferTextureBinds = false;
 }
 /***********************************************************
  *  RenderScene()
@@ -444,77 +1739,194 @@ void SceneManager::PrepareScene()
  ***********************************************************/
 void SceneManager::RenderScene()
 {
-    glm::vec3 scaleXYZ;
-    glm::vec3 positionXYZ;
-
-    // Draw the plane mesh (granite countertop)
-    scaleXYZ = glm::vec3(20.0f, 1.0f, 10.0f);
-    positionXYZ = glm::vec3(0.0f, 0.0f, 0.0f); 
-    SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-    SetShaderTexture("graniteTexture");
-    SetShaderMaterial("granite");
-    m_basicMeshes->DrawPlaneMesh();
-
-    // Draw the black box
-    scaleXYZ = glm::vec3(2.0f, 0.5f, 3.0f);
-    positionXYZ = glm::vec3(-8.0f, 0.5f, 2.5f); 
-    SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-    SetShaderTexture("blackboxTexture");
-    SetShaderMaterial("wood");
-    m_basicMeshes->DrawBoxMesh();
-
-    // Draw the cylinder for the crayon body
-    scaleXYZ = glm::vec3(0.7f, 3.0f, 0.7f);
-    positionXYZ = glm::vec3(-3.5f, 0.25f, -0.5f); 
-    SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-    SetShaderTexture("orangeTexture");
-    SetShaderMaterial("wood");
-    m_basicMeshes->DrawCylinderMesh();
-
-    // Draw the cone for the crayon tip
-    scaleXYZ = glm::vec3(0.7f, 1.0f, 0.7f);
-    positionXYZ = glm::vec3(-3.5f, 3.25f, -0.5f); 
-    SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-    SetShaderTexture("orangeTexture");
-    SetShaderMaterial("metal");
-    m_basicMeshes->DrawConeMesh();
-
-    // Draw the Monster can body
-    scaleXYZ = glm::vec3(0.7f, 3.0f, 0.7f);
-    positionXYZ = glm::vec3(2.0f, 0.0f, 0.0f);  
-    SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-    SetShaderTexture("monsterTexture");
-    SetShaderMaterial("wood");
-    m_basicMeshes->DrawCylinderMesh();
-
-    // Draw the top of the Monster can with the top texture
-    scaleXYZ = glm::vec3(0.7f, 0.01f, 0.7f);
-    positionXYZ = glm::vec3(2.0f, 3.0f, 0.0f);  
-    SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-    SetShaderTexture("monsterTopTexture");
-    m_basicMeshes->DrawCylinderMesh();
-
-
-    // Draw the mug body
-    scaleXYZ = glm::vec3(1.0f, 2.0f, 1.0f);
-    positionXYZ = glm::vec3(6.5f, 0.25f, 2.0f); 
-    SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-    SetShaderTexture("mugTexture");
-    SetShaderMaterial("ceramicMaterial");
-    m_basicMeshes->DrawCylinderMesh();
-
-    // Draw the mug handle
-    scaleXYZ = glm::vec3(0.5f, 0.5f, 0.5f); 
-    positionXYZ = glm::vec3(7.5f, 1.25f, 2.0f); 
-    SetTransformations(scaleXYZ, 0.0f, 0.0f, 90.0f, positionXYZ);
-    SetShaderTexture("mugTexture");
-    m_basicMeshes->DrawTorusMesh();
-
-    scaleXYZ = glm::vec3(1.01f, 0.01f, 1.01f); 
-    positionXYZ = glm::vec3(6.5f, 2.25f, 2.0f); 
-    SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-    SetShaderColor(0.0f, 0.0f, 0.0f, 1.0f); 
-    m_basicMeshes->DrawCylinderMesh(); 
+    m_frameNumber++;
+
+    // the scene program is normally still in use, which the
+    // state cache finds without a call to the driver
+    if (0 != m_shaderProgram)
+    {
+        GetGLStateCache().UseProgram(m_shaderProgram);
+    }
+
+    // assign the scene lights to the clusters of this view
+    m_lightClusters->BuildClusters(
+        m_sceneView.view,
+        m_sceneView.projection,
+        m_sceneView.viewportWidth,
+        m_sceneView.viewportHeight);
+
+    // culled objects are never queued, so they are never drawn,
+    // and the stages split their objects over the job threads
+    {
+        ProfileScope scope(m_pProfiler, "PrepareFrame");
+
+        UpdateModelMatrices();
+        CullSceneObjects();
+        SelectObjectLevels();
+        BuildRenderQueue();
+    }
+
+    // stream the texture levels before the arrays are bound,
+    // a streamed level replaces the storage of its array
+    RequestTextureLevels();
+    m_textureResidency->Update(m_frameNumber);
+
+    // write the per-instance data in sorted order straight into
+    // the mapped instance buffer, so every run of draws with the
+    // same texture array and mesh is one range of instances, and
+    // the job threads write their ranges of the mapped buffer
+    const RenderQueue::DRAW_ENTRY* entries = m_renderQueue.GetEntries();
+    size_t drawCount = m_renderQueue.GetCount();
+
+    SceneMeshes::INSTANCE_DATA* instances = m_sceneMeshes->BeginFrame(drawCount);
+    m_jobSystem->ParallelFor(drawCount, OBJECT_GRAIN_SIZE, [this, entries, instances](size_t first, size_t end)
+    {
+        for (size_t i = first; i < end; i++)
+        {
+            const SCENE_OBJECT& object = m_sceneObjects[entries[i].objectIndex];
+            const TextureArrays::TEXTURE_LOCATION* pTexture = FindObjectTexture(object);
+            SceneMeshes::INSTANCE_DATA& instance = instances[i];
+
+            instance.model = m_modelMatrices[entries[i].objectIndex];
+            instance.color = object.color;
+            instance.UVscale = object.UVscale;
+            instance.materialIndex = object.materialHandle;
+            instance.textureLayer = (NULL != pTexture) ? (GLuint)pTexture->layer : SceneMeshes::NO_TEXTURE_LAYER;
+        }
+    });
+
+    // one draw command for each run, the commands between two
+    // texture array changes are submitted with one multi-draw
+    // call, and the objects drawn with their color can join a
+    // run with any array bound
+    bool bDepthCaptured = false;
+    int boundArray = -1;
+    size_t runStart = 0;
+    int runArray = -1;
+    m_occlusionCuller->BeginSampleQuery();
+    for (size_t i = 1; i <= drawCount; i++)
+    {
+        const SCENE_OBJECT& first = m_sceneObjects[entries[runStart].objectIndex];
+        bool bTranslucent = RenderQueue::IsTranslucentKey(entries[runStart].key);
+        const TextureArrays::TEXTURE_LOCATION* pFirstTexture = FindObjectTexture(first);
+
+        if ((runArray < 0) && (NULL != pFirstTexture))
+        {
+            runArray = pFirstTexture->arrayIndex;
+        }
+
+        if (i < drawCount)
+        {
+            const SCENE_OBJECT& object = m_sceneObjects[entries[i].objectIndex];
+            const TextureArrays::TEXTURE_LOCATION* pTexture = FindObjectTexture(object);
+
+            if ((object.meshIndex == first.meshIndex) &&
+                ((NULL == pTexture) || (runArray < 0) || (pTexture->arrayIndex == runArray)) &&
+                (RenderQueue::IsTranslucentKey(entries[i].key) == bTranslucent))
+            {
+                if (NULL != pTexture)
+                {
+                    runArray = pTexture->arrayIndex;
+                }
+                continue;
+            }
+        }
+
+        // the depth of the opaque draws is captured before the
+        // first translucent draw, which must not hide anything
+        if (bTranslucent && (bDepthCaptured == false))
+        {
+            DrawQueuedCommands();
+            CaptureSceneDepth();
+            bDepthCaptured = true;
+        }
+
+        if ((runArray >= 0) && (runArray != boundArray))
+        {
+            DrawQueuedCommands();
+            m_textureArrays->BindArray(runArray, TEXTURE_UNIT);
+            boundArray = runArray;
+        }
+        m_sceneMeshes->AddDrawCommand(first.meshIndex, (GLuint)runStart, (GLuint)(i - runStart));
+
+        runStart = i;
+        runArray = -1;
+    }
+
+    DrawQueuedCommands();
+    m_sceneMeshes->EndFrame();
+    if (bDepthCaptured == false)
+    {
+        CaptureSceneDepth();
+    }
+    m_occlusionCuller->EndSampleQuery();
+
+    // the meshes drawn in this frame are kept
+    EvictMeshes();
+}
+
+/***********************************************************
+ *  DefineSceneObjects()
+ *
+ *  This method is used for adding all of the objects of the
+ *  3D scene to the retained scene, which draws them every
+ *  frame.  The textures and materials must be loaded first.
+ ***********************************************************/
+void SceneManager::DefineSceneObjects()
+{
+    // the objects of a scene file replace the ones below
+    if (m_sceneFile.IsOpen())
+    {
+        DefineSceneFileObjects();
+        return;
+    }
+
+    int object = -1;
+
+    // the plane mesh (granite countertop)
+    object = AddSceneObject(MESH_PLANE, glm::vec3(20.0f, 1.0f, 10.0f), 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, 0.0f, 0.0f));
+    SetObjectTexture(object, HashTag("graniteTexture"));
+    SetObjectMaterial(object, HashTag("granite"));
+
+    // the black box
+    object = AddSceneObject(MESH_BOX, glm::vec3(2.0f, 0.5f, 3.0f), 0.0f, 0.0f, 0.0f, glm::vec3(-8.0f, 0.5f, 2.5f));
+    SetObjectTexture(object, HashTag("blackboxTexture"));
+    SetObjectMaterial(object, HashTag("wood"));
+
+    // the cylinder for the crayon body
+    object = AddSceneObject(MESH_CYLINDER, glm::vec3(0.7f, 3.0f, 0.7f), 0.0f, 0.0f, 0.0f, glm::vec3(-3.5f, 0.25f, -0.5f));
+    SetObjectTexture(object, HashTag("orangeTexture"));
+    SetObjectMaterial(object, HashTag("wood"));
+
+    // the cone for the crayon tip
+    object = AddSceneObject(MESH_CONE, glm::vec3(0.7f, 1.0f, 0.7f), 0.0f, 0.0f, 0.0f, glm::vec3(-3.5f, 3.25f, -0.5f));
+    SetObjectTexture(object, HashTag("orangeTexture"));
+    SetObjectMaterial(object, HashTag("metal"));
+
+    // the Monster can body
+    object = AddSceneObject(MESH_CYLINDER, glm::vec3(0.7f, 3.0f, 0.7f), 0.0f, 0.0f, 0.0f, glm::vec3(2.0f, 0.0f, 0.0f));
+    SetObjectTexture(object, HashTag("monsterTexture"));
+    SetObjectMaterial(object, HashTag("wood"));
+
+    // the top of the Monster can with the top texture
+    object = AddSceneObject(MESH_CYLINDER, glm::vec3(0.7f, 0.01f, 0.7f), 0.0f, 0.0f, 0.0f, glm::vec3(2.0f, 3.0f, 0.0f));
+    SetObjectTexture(object, HashTag("monsterTopTexture"));
+    SetObjectMaterial(object, HashTag("wood"));
+
+    // the mug body
+    object = AddSceneObject(MESH_CYLINDER, glm::vec3(1.0f, 2.0f, 1.0f), 0.0f, 0.0f, 0.0f, glm::vec3(6.5f, 0.25f, 2.0f));
+    SetObjectTexture(object, HashTag("mugTexture"));
+    SetObjectMaterial(object, HashTag("ceramicMaterial"));
+
+    // the mug handle
+    object = AddSceneObject(MESH_TORUS, glm::vec3(0.5f, 0.5f, 0.5f), 0.0f, 0.0f, 90.0f, glm::vec3(7.5f, 1.25f, 2.0f));
+    SetObjectTexture(object, HashTag("mugTexture"));
+    SetObjectMaterial(object, HashTag("ceramicMaterial"));
+
+    // the black rim of the mug
+    object = AddSceneObject(MESH_CYLINDER, glm::vec3(1.01f, 0.01f, 1.01f), 0.0f, 0.0f, 0.0f, glm::vec3(6.5f, 2.25f, 2.0f));
+    SetObjectColor(object, 0.0f, 0.0f, 0.0f, 1.0f);
+    SetObjectMaterial(object, HashTag("ceramicMaterial"));
 }
 /***********************************************************
  *  DefineObjectMaterials()
@@ -524,6 +1936,13 @@ void SceneManager::RenderScene()
  ***********************************************************/
 void SceneManager::DefineObjectMaterials()
 {
+    // the materials of a scene file replace the ones below
+    if (m_sceneFile.IsOpen())
+    {
+        DefineSceneFileMaterials();
+        return;
+    }
+
     OBJECT_MATERIAL goldMaterial;
     goldMaterial.ambientColor = glm::vec3(0.2f, 0.2f, 0.2f);
     goldMaterial.ambientStrength = 0.3f;
@@ -586,7 +2005,9 @@ void SceneManager::DefineObjectMaterials()
  *  SetupSceneLights()
  *
  *  This method is called to add and configure the light
- *  sources for the 3D scene.  There are up to 4 light sources.
+ *  sources for the 3D scene.  There is no limit on the number
+ *  of light sources - each one only lights the view clusters
+ *  that fall within its range.
  ***********************************************************/
 void SceneManager::SetupSceneLights()
 {
@@ -597,41 +2018,59 @@ void SceneManager::SetupSceneLights()
     //m_pShaderManager->setBoolValue(g_UseLightingName, true);
 
     /*** STUDENTS - add the code BELOW for setting up light sources ***/
-    /*** Up to four light sources can be defined. Refer to the code ***/
-    /*** in the OpenGL Sample for help                              ***/
+    /*** Any number of light sources can be defined. Each light  ***/
+    /*** needs a range, the distance where it fades out fully.   ***/
+    /*** Refer to the code in the OpenGL Sample for help         ***/
 
 
     m_pShaderManager->setBoolValue(g_UseLightingName, true);
 
+    // the lights of a scene file replace the ones below
+    if (m_sceneFile.IsOpen())
+    {
+        SetupSceneFileLights();
+        return;
+    }
+
+    LightClusters::LIGHT_SOURCE light;
+
     // Light Source 1 - Bright Yellow
-    m_pShaderManager->setVec3Value("lightSources[0].position", -5.0f, 5.0f, 5.0f);
-    m_pShaderManager->setVec3Value("lightSources[0].ambientColor", 0.3f, 0.3f, 0.1f); // Yellow ambient
-    m_pShaderManager->setVec3Value("lightSources[0].diffuseColor", 0.8f, 0.8f, 0.4f); // Bright yellow diffuse
-    m_pShaderManager->setVec3Value("lightSources[0].specularColor", 0.6f, 0.6f, 0.3f); // Yellow specular
-    m_pShaderManager->setFloatValue("lightSources[0].focalStrength", 40.0f);
-    m_pShaderManager->setFloatValue("lightSources[0].specularIntensity", 0.7f);
+    light.position = glm::vec3(-5.0f, 5.0f, 5.0f);
+    light.ambientColor = glm::vec3(0.3f, 0.3f, 0.1f); // Yellow ambient
+    light.diffuseColor = glm::vec3(0.8f, 0.8f, 0.4f); // Bright yellow diffuse
+    light.specularColor = glm::vec3(0.6f, 0.6f, 0.3f); // Yellow specular
+    light.focalStrength = 40.0f;
+    light.specularIntensity = 0.7f;
+    light.range = 40.0f;
+    m_lightClusters->AddLight(light);
 
     // Light Source 2 - Bright Yellow
-    m_pShaderManager->setVec3Value("lightSources[1].position", 5.0f, 5.0f, 5.0f);
-    m_pShaderManager->setVec3Value("lightSources[1].ambientColor", 0.3f, 0.3f, 0.1f); // Yellow ambient
-    m_pShaderManager->setVec3Value("lightSources[1].diffuseColor", 0.8f, 0.8f, 0.4f); // Bright yellow diffuse
-    m_pShaderManager->setVec3Value("lightSources[1].specularColor", 0.6f, 0.6f, 0.3f); // Yellow specular
-    m_pShaderManager->setFloatValue("lightSources[1].focalStrength", 40.0f);
-    m_pShaderManager->setFloatValue("lightSources[1].specularIntensity", 0.7f);
+    light.position = glm::vec3(5.0f, 5.0f, 5.0f);
+    light.ambientColor = glm::vec3(0.3f, 0.3f, 0.1f); // Yellow ambient
+    light.diffuseColor = glm::vec3(0.8f, 0.8f, 0.4f); // Bright yellow diffuse
+    light.specularColor = glm::vec3(0.6f, 0.6f, 0.3f); // Yellow specular
+    light.focalStrength = 40.0f;
+    light.specularIntensity = 0.7f;
+    light.range = 40.0f;
+    m_lightClusters->AddLight(light);
 
     // Light Source 3 - Brighter Blue-Yellow Mix
-    m_pShaderManager->setVec3Value("lightSources[2].position", 0.0f, 10.0f, 0.0f);
-    m_pShaderManager->setVec3Value("lightSources[2].ambientColor", 0.2f, 0.2f, 0.1f); // Yellowish ambient
-    m_pShaderManager->setVec3Value("lightSources[2].diffuseColor", 0.6f, 0.6f, 0.4f); // Mix of yellow and blue
-    m_pShaderManager->setVec3Value("lightSources[2].specularColor", 0.4f, 0.4f, 0.3f); // Yellow specular with some blue
-    m_pShaderManager->setFloatValue("lightSources[2].focalStrength", 20.0f);
-    m_pShaderManager->setFloatValue("lightSources[2].specularIntensity", 0.5f);
+    light.position = glm::vec3(0.0f, 10.0f, 0.0f);
+    light.ambientColor = glm::vec3(0.2f, 0.2f, 0.1f); // Yellowish ambient
+    light.diffuseColor = glm::vec3(0.6f, 0.6f, 0.4f); // Mix of yellow and blue
+    light.specularColor = glm::vec3(0.4f, 0.4f, 0.3f); // Yellow specular with some blue
+    light.focalStrength = 20.0f;
+    light.specularIntensity = 0.5f;
+    light.range = 40.0f;
+    m_lightClusters->AddLight(light);
 
     // Light Source 4 - Bright Yellow
-    m_pShaderManager->setVec3Value("lightSources[3].position", 0.0f, 5.0f, -5.0f);
-    m_pShaderManager->setVec3Value("lightSources[3].ambientColor", 0.3f, 0.3f, 0.1f); // Yellow ambient
-    m_pShaderManager->setVec3Value("lightSources[3].diffuseColor", 0.8f, 0.8f, 0.4f); // Bright yellow diffuse
-    m_pShaderManager->setVec3Value("lightSources[3].specularColor", 0.6f, 0.6f, 0.3f); // Yellow specular
-    m_pShaderManager->setFloatValue("lightSources[3].focalStrength", 40.0f);
-    m_pShaderManager->setFloatValue("lightSources[3].specularIntensity", 0.7f);
+    light.position = glm::vec3(0.0f, 5.0f, -5.0f);
+    light.ambientColor = glm::vec3(0.3f, 0.3f, 0.1f); // Yellow ambient
+    light.diffuseColor = glm::vec3(0.8f, 0.8f, 0.4f); // Bright yellow diffuse
+    light.specularColor = glm::vec3(0.6f, 0.6f, 0.3f); // Yellow specular
+    light.focalStrength = 40.0f;
+    light.specularIntensity = 0.7f;
+    light.range = 40.0f;
+    m_lightClusters->AddLight(light);
 }
\ No newline at end of file
@@ -10,8 +10,23 @@
 #pragma once
 
 #include "ShaderManager.h"
-#include "ShapeMeshes.h"
+#include "SceneMeshes.h"
+#include "ShaderUniform.h"
+#include "LightClusters.h"
+#include "TagRegistry.h"
+#include "RenderQueue.h"
+#include "TransformArrays.h"
+#include "SceneBVH.h"
+#include "OcclusionCuller.h"
+#include "WorkerPool.h"
+#include "JobSystem.h"
+#include "AssetPack.h"
+#include "TextureArrays.h"
+#include "TextureResidency.h"
+#include "FrameProfiler.h"
+#include "SceneFile.h"
 
+#include <deque>
 #include <string>
 #include <vector>
 #include <glm/glm.hpp>
@@ -33,7 +48,9 @@ public:
     struct TEXTURE_INFO
     {
         std::string tag;
-        uint32_t ID;
+        // array and layer, the array index is -1 until the
+        // texture is uploaded and when it failed to load
+        TextureArrays::TEXTURE_LOCATION location;
     };
 
     struct OBJECT_MATERIAL
@@ -46,65 +63,318 @@ public:
         std::string tag;
     };
 
+    // uniform handles of the scene shader, the sampler is set
+    // one time and all object settings are per-instance data
+    struct SHADER_UNIFORMS
+    {
+        ShaderUniform<int> objectTextures;
+    };
+
+    // basic shape meshes that scene objects are drawn with,
+    // the shapes of the shared geometry builder
+    enum MESH_TYPE
+    {
+        MESH_BOX = ShapeGeometry::SHAPE_BOX,
+        MESH_PLANE = ShapeGeometry::SHAPE_PLANE,
+        MESH_CYLINDER = ShapeGeometry::SHAPE_CYLINDER,
+        MESH_CONE = ShapeGeometry::SHAPE_CONE,
+        MESH_PRISM = ShapeGeometry::SHAPE_PRISM,
+        MESH_PYRAMID4 = ShapeGeometry::SHAPE_PYRAMID4,
+        MESH_SPHERE = ShapeGeometry::SHAPE_SPHERE,
+        MESH_TAPERED_CYLINDER = ShapeGeometry::SHAPE_TAPERED_CYLINDER,
+        MESH_TORUS = ShapeGeometry::SHAPE_TORUS,
+        MESH_COUNT = ShapeGeometry::SHAPE_COUNT
+    };
+
+    // tessellation levels of the round shapes, 0 is the finest
+    static const int LOD_COUNT = ShapeGeometry::LEVEL_COUNT;
+
+    // one object of the retained scene
+    struct SCENE_OBJECT
+    {
+        MESH_TYPE mesh;
+        // tessellation level picked from the size on the screen
+        uint8_t lodLevel;
+        // uploaded mesh of the level, set when the object is queued
+        int meshIndex;
+        // texture slot handle, INVALID_HANDLE draws with the color
+        uint16_t textureHandle;
+        uint16_t materialHandle;
+        glm::vec4 color;
+        glm::vec2 UVscale;
+    };
+
+    // new transform of one object, for moving many objects
+    struct OBJECT_TRANSFORM
+    {
+        int objectIndex;
+        glm::vec3 scaleXYZ;
+        glm::vec3 rotationDegrees;
+        glm::vec3 positionXYZ;
+    };
+
+    // camera settings of the frame being rendered
+    struct SCENE_VIEW
+    {
+        glm::mat4 view;
+        glm::mat4 projection;
+        int viewportWidth;
+        int viewportHeight;
+    };
+
 private:
     // pointer to shader manager object
     ShaderManager* m_pShaderManager;
-    // pointer to basic shapes object
-    ShapeMeshes* m_basicMeshes;
-    // total number of loaded textures
-    int m_loadedTextures;
-    // loaded textures info
-    TEXTURE_INFO m_textureIDs[16];
+    // pointer to the scene meshes object
+    SceneMeshes* m_sceneMeshes;
+    // loaded textures info, indexed by texture handle
+    std::vector<TEXTURE_INFO> m_textures;
+    // texture arrays holding the loaded textures
+    TextureArrays* m_textureArrays;
+    // streams the mip levels of the arrays under a budget
+    TextureResidency* m_textureResidency;
     // defined object materials
     std::vector<OBJECT_MATERIAL> m_objectMaterials;
+    // storage buffer holding the table of object materials
+    GLuint m_materialSSBO;
+    // texture tags, the handle of a tag is its texture slot
+    TagRegistry m_textureTags;
+    // material tags, the handle of a tag is its table index
+    TagRegistry m_materialTags;
+    // cached shader uniform locations
+    SHADER_UNIFORMS m_uniforms;
+    // shader program the uniforms were looked up in
+    GLuint m_shaderProgram;
+    // scene lights and their view clusters
+    LightClusters* m_lightClusters;
+    // camera settings of the current frame
+    SCENE_VIEW m_sceneView;
+    // residency of a mesh type at one tessellation level
+    struct MESH_SLOT
+    {
+        // uploaded mesh, -1 when it is not uploaded
+        int meshIndex;
+        uint64_t lastUsedFrame;
+        // mesh data built ahead of the upload
+        bool bBuilt;
+        ShapeGeometry::MESH_DATA builtData;
+    };
+
+    // texture image decoded by a worker thread
+    struct PENDING_TEXTURE
+    {
+        std::string filename;
+        int slot;
+        // decoded image followed by its mip levels
+        std::vector<unsigned char> levels;
+        int levelCount;
+        int width;
+        int height;
+        int colorChannels;
+    };
+
+    // retained list of the objects in the scene
+    std::vector<SCENE_OBJECT> m_sceneObjects;
+    // transforms of the scene objects, indexed like the objects
+    TransformArrays m_objectTransforms;
+    // model matrices composed from the transforms
+    std::vector<glm::mat4> m_modelMatrices;
+    // set when a transform changed since the matrices were composed
+    bool m_bTransformsDirty;
+    // objects moved since the bounds were last refit
+    std::vector<uint32_t> m_movedObjects;
+    // model space bounds of the meshes, indexed by mesh type
+    SceneBVH::BOUNDS m_meshBounds[MESH_COUNT];
+    // set when the bounds of a mesh type have been found
+    bool m_bMeshBoundsFound[MESH_COUNT];
+    // number of objects drawn with each mesh type
+    int m_meshReferences[MESH_COUNT];
+    // uploaded mesh of each mesh type and tessellation level
+    MESH_SLOT m_meshSlots[MESH_COUNT][LOD_COUNT];
+    // bytes of mesh data kept uploaded
+    size_t m_meshBudget;
+    // number of the frame being rendered
+    uint64_t m_frameNumber;
+    // threads that decode images and build meshes
+    WorkerPool* m_workerPool;
+    // threads that share the CPU stages of every frame
+    JobSystem* m_jobSystem;
+    // textures waiting for their images to be uploaded
+    std::deque<PENDING_TEXTURE> m_pendingTextures;
+    // set once the scene has started loading
+    bool m_bLoadingStarted;
+    // set while the textures are bound later by the scene
+    bool m_bDeferTextureBinds;
+    // baked textures and meshes, used instead of the source
+    // assets when the pack file is present
+    AssetPack m_assetPack;
+    // scene description, used instead of the scene defined in
+    // the code when a scene file is present
+    SceneFile m_sceneFile;
+    // world space bounds of the scene objects
+    SceneBVH m_sceneBVH;
+    // objects inside the view frustum of the current frame
+    std::vector<uint32_t> m_visibleObjects;
+    // occlusion result of every object inside the frustum
+    std::vector<uint8_t> m_occludedObjects;
+    // world bounds of the moved objects, before they are refit
+    std::vector<SceneBVH::BOUNDS> m_movedBounds;
+    // culling results of the current frame
+    SceneBVH::CULL_STATS m_cullStats;
+    // hides objects behind the depth of earlier frames
+    OcclusionCuller* m_occlusionCuller;
+    // changed with every object change that can move depth
+    uint64_t m_sceneVersion;
+    // sorted draw list rebuilt every frame
+    RenderQueue m_renderQueue;
+    // times the draw groups, NULL when they are not timed
+    FrameProfiler* m_pProfiler;
 
+    // look up the shader uniform locations one time
+    void ResolveShaderUniforms();
     // load texture images and convert to OpenGL texture data
-    bool CreateGLTexture(const char* filename, std::string tag);
+    bool CreateGLTexture(const char* filename, const std::string& tag);
     // bind loaded OpenGL textures to slots in memory
     void BindGLTextures();
+    // upload the decoded images of the queued textures
+    void UploadPendingTextures();
+    // upload a texture with its mip chain from the pack
+    bool UploadPackedTexture(const AssetPack::PACK_ENTRY& entry, TEXTURE_INFO& texture);
+    // upload the levels of a mip chain that its array keeps
+    void UploadTextureLevels(
+        const TextureArrays::TEXTURE_LOCATION& location,
+        const unsigned char* levels,
+        int width,
+        int height,
+        int levelCount,
+        GLenum format);
     // free the loaded OpenGL textures
     void DestroyGLTextures();
-    // find a loaded texture by tag
-    int FindTextureID(std::string tag);
-    int FindTextureSlot(std::string tag);
-    // find a defined material by tag
-    bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
-
-    // set the transformation values 
-    // into the transform buffer
-    void SetTransformations(
+    // pack the defined materials into the material buffer
+    void UploadObjectMaterials();
+
+    // find the loaded texture an object is drawn with
+    const TextureArrays::TEXTURE_LOCATION* FindObjectTexture(const SCENE_OBJECT& object) const;
+
+    // find the baked data of a mesh type and level in the pack
+    const AssetPack::PACK_ENTRY* FindPackedMesh(MESH_TYPE meshType, int level) const;
+    // build the meshes of the referenced mesh types on the workers
+    void PrebuildMeshes();
+    // count the objects drawn with a mesh type
+    void ReferenceMesh(MESH_TYPE meshType);
+    void ReleaseMesh(MESH_TYPE meshType);
+    // find or upload the mesh of a mesh type and level
+    int GetLevelMesh(MESH_TYPE meshType, int level);
+    // remove meshes that are not drawn while over the budget
+    void EvictMeshes();
+    // submit the queued draws as one timed draw group
+    void DrawQueuedCommands();
+    // request the texture levels the visible objects are drawn at
+    void RequestTextureLevels();
+    // compose the model matrices of the moved objects
+    void UpdateModelMatrices();
+    // refit the world bounds of the moved objects
+    void UpdateObjectBounds();
+    // find the visible objects inside the view frustum
+    void CullSceneObjects();
+    // read back the depth of the opaque draws of the frame
+    void CaptureSceneDepth();
+    // pick the tessellation level of the visible objects
+    void SelectObjectLevels();
+    // queue a sort key for every visible scene object
+    void BuildRenderQueue();
+
+    // add the items of the scene file to the scene
+    void LoadSceneFileTextures();
+    void DefineSceneFileMaterials();
+    void SetupSceneFileLights();
+    void DefineSceneFileObjects();
+
+public:
+
+    // set the camera settings for the next rendered frame
+    void SetSceneView(
+        const glm::mat4& view,
+        const glm::mat4& projection,
+        int viewportWidth,
+        int viewportHeight);
+
+    // add an object to the retained scene
+    int AddSceneObject(
+        MESH_TYPE mesh,
         glm::vec3 scaleXYZ,
         float XrotationDegrees,
         float YrotationDegrees,
         float ZrotationDegrees,
         glm::vec3 positionXYZ);
+    // move an object of the retained scene
+    void SetObjectTransform(
+        int objectIndex,
+        glm::vec3 scaleXYZ,
+        float XrotationDegrees,
+        float YrotationDegrees,
+        float ZrotationDegrees,
+        glm::vec3 positionXYZ);
+    // move many different objects of the retained scene
+    void SetObjectTransforms(const OBJECT_TRANSFORM* transforms, size_t count);
+    // set the basic shape mesh an object is drawn with
+    void SetObjectMesh(int objectIndex, MESH_TYPE mesh);
+    // set the texture an object is drawn with
+    void SetObjectTexture(int objectIndex, uint32_t textureTag);
+    // set the color an untextured object is drawn with
+    void SetObjectColor(int objectIndex, float red, float green, float blue, float alpha);
+    // set the material an object is drawn with
+    void SetObjectMaterial(int objectIndex, uint32_t materialTag);
+    // set the texture UV scale of an object
+    void SetObjectUVScale(int objectIndex, float u, float v);
+    // number of objects in the retained scene
+    size_t GetSceneObjectCount() const;
 
-    // set the color values into the shader
-    void SetShaderColor(
-        float redColorValue,
-        float greenColorValue,
-        float blueColorValue,
-        float alphaValue);
-
-    // set the texture data into the shader
-    void SetShaderTexture(
-        std::string textureTag);
-
-    // set the UV scale for the texture mapping
-    void SetTextureUVScale(
-        float u, float v);
+    // loaded textures and defined materials, and the tag hash
+    // that objects are given them by
+    int GetTextureCount() const;
+    uint32_t GetTextureTagHash(int textureSlot) const;
+    int GetMaterialCount() const;
+    uint32_t GetMaterialTagHash(int materialIndex) const;
 
-    // set the object material into the shader
-    void SetShaderMaterial(
-        std::string materialTag);
+    // culling results of the last rendered frame
+    const SceneBVH::CULL_STATS& GetCullStats() const;
+    // set how hidden objects are culled
+    void SetOcclusionMode(OcclusionCuller::OCCLUSION_MODE mode);
+    // occlusion results of the last rendered frame
+    const OcclusionCuller::OCCLUSION_STATS& GetOcclusionStats() const;
+    // number of triangles drawn by the last rendered frame
+    size_t GetFrameTriangleCount() const;
+    // set the bytes of mesh data kept uploaded
+    void SetMeshMemoryBudget(size_t bytes);
+    // bytes of the uploaded mesh data
+    size_t GetMeshMemoryUsage() const;
+    // set the bytes of texture levels kept in video memory
+    void SetTextureMemoryBudget(size_t bytes);
+    // texture streaming counters of the last rendered frame
+    const TextureResidency::RESIDENCY_STATS& GetTextureStats() const;
+    // set the profiler that times the draw groups, or NULL
+    void SetFrameProfiler(FrameProfiler* pProfiler);
+    // set the number of threads of the frame stages, with the
+    // calling thread, zero uses one for each core
+    void SetJobThreadCount(unsigned int threadCount);
+    // threads that run the frame stages, which can also be
+    // used for the work of a frame outside of the scene
+    JobSystem* GetJobSystem() const;
 
-public:
+    // load a scene file in the binary or the text form, which
+    // replaces the scene defined in the code
+    bool OpenSceneFile(const char* filename);
+    // start decoding the scene textures on the worker threads
+    void StartSceneLoading();
 
     // The following methods are for the students to 
     // customize for their own 3D scene
     void PrepareScene();
     void RenderScene();
 
+    void DefineSceneObjects();
+
     void DefineObjectMaterials();
 
     void SetupSceneLights();
@@ -0,0 +1,415 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenemeshes.cpp
+// ============
+// upload scene meshes and draw them with per-instance data
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneMeshes.h"
+#include "GLStateCache.h"
+
+#include <cstddef>
+
+// declaration of the global variables and defines
+namespace
+{
+    // vertex attribute locations used by the vertex shader
+    const GLuint POSITION_LOCATION = 0;
+    const GLuint NORMAL_LOCATION = 1;
+    const GLuint TEXTURE_COORDINATE_LOCATION = 2;
+    // the shared vertex buffer is bound to this binding index
+    const GLuint VERTEX_BUFFER_BINDING = 0;
+    // storage buffer binding point of the instance data
+    const GLuint INSTANCE_BUFFER_BINDING = 4;
+
+    // starting sizes of the shared buffers
+    const size_t INITIAL_VERTEX_CAPACITY = 16 * 1024;
+    const size_t INITIAL_INDEX_CAPACITY = 64 * 1024;
+}
+
+/***********************************************************
+ *  SceneMeshes()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneMeshes::SceneMeshes()
+{
+    GLsizei vertexStride = sizeof(ShapeGeometry::MESH_VERTEX);
+
+    m_vertexCount = 0;
+    m_vertexCapacity = INITIAL_VERTEX_CAPACITY;
+    m_indexCount = 0;
+    m_indexCapacity = INITIAL_INDEX_CAPACITY;
+    m_uploadedVertexCount = 0;
+    m_uploadedIndexCount = 0;
+    m_commands = NULL;
+    m_commandCount = 0;
+    m_submittedCount = 0;
+    m_commandCapacity = 0;
+    m_triangleCount = 0;
+
+    glGenBuffers(1, &m_vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, m_vertexCapacity * vertexStride, NULL, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenVertexArrays(1, &m_vao);
+    GetGLStateCache().BindVertexArray(m_vao);
+
+    glGenBuffers(1, &m_indexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indexCapacity * sizeof(uint32_t), NULL, GL_STATIC_DRAW);
+
+    // the vertex format is described one time, the buffer is
+    // attached to the binding index and can be swapped later
+    glEnableVertexAttribArray(POSITION_LOCATION);
+    glVertexAttribFormat(POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, offsetof(ShapeGeometry::MESH_VERTEX, position));
+    glVertexAttribBinding(POSITION_LOCATION, VERTEX_BUFFER_BINDING);
+    glEnableVertexAttribArray(NORMAL_LOCATION);
+    glVertexAttribFormat(NORMAL_LOCATION, 3, GL_FLOAT, GL_FALSE, offsetof(ShapeGeometry::MESH_VERTEX, normal));
+    glVertexAttribBinding(NORMAL_LOCATION, VERTEX_BUFFER_BINDING);
+    glEnableVertexAttribArray(TEXTURE_COORDINATE_LOCATION);
+    glVertexAttribFormat(TEXTURE_COORDINATE_LOCATION, 2, GL_FLOAT, GL_FALSE, offsetof(ShapeGeometry::MESH_VERTEX, textureCoordinate));
+    glVertexAttribBinding(TEXTURE_COORDINATE_LOCATION, VERTEX_BUFFER_BINDING);
+    glBindVertexBuffer(VERTEX_BUFFER_BINDING, m_vertexBuffer, 0, vertexStride);
+
+    GetGLStateCache().BindVertexArray(0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  ~SceneMeshes()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneMeshes::~SceneMeshes()
+{
+    GetGLStateCache().DeleteVertexArray(m_vao);
+    glDeleteBuffers(1, &m_vertexBuffer);
+    glDeleteBuffers(1, &m_indexBuffer);
+    m_meshes.clear();
+}
+
+/***********************************************************
+ *  RepackBuffers()
+ *
+ *  This method is used for replacing the shared buffers with
+ *  new ones of the passed in sizes.  The uploaded meshes are
+ *  copied on the GPU to the start of the new buffers, which
+ *  closes the gaps left by removed meshes, so the mesh data
+ *  never goes back to the CPU.  Draws already issued keep
+ *  reading the old buffers until they are done.
+ ***********************************************************/
+void SceneMeshes::RepackBuffers(size_t vertexCapacity, size_t indexCapacity)
+{
+    size_t vertexStride = sizeof(ShapeGeometry::MESH_VERTEX);
+    GLuint vertexBuffer = 0;
+    GLuint indexBuffer = 0;
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+
+    glGenBuffers(1, &vertexBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, vertexCapacity * vertexStride, NULL, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, m_vertexBuffer);
+    for (size_t i = 0; i < m_meshes.size(); i++)
+    {
+        MESH_RANGE& range = m_meshes[i];
+
+        if (range.bUploaded)
+        {
+            glCopyBufferSubData(
+                GL_COPY_READ_BUFFER,
+                GL_COPY_WRITE_BUFFER,
+                range.baseVertex * vertexStride,
+                vertexCount * vertexStride,
+                range.vertexCount * vertexStride);
+            range.baseVertex = (GLint)vertexCount;
+            vertexCount += range.vertexCount;
+        }
+    }
+
+    // the indices are relative to the base vertex, so they
+    // are copied without changes
+    glGenBuffers(1, &indexBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, indexCapacity * sizeof(uint32_t), NULL, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, m_indexBuffer);
+    for (size_t i = 0; i < m_meshes.size(); i++)
+    {
+        MESH_RANGE& range = m_meshes[i];
+
+        if (range.bUploaded)
+        {
+            glCopyBufferSubData(
+                GL_COPY_READ_BUFFER,
+                GL_COPY_WRITE_BUFFER,
+                range.firstIndex * sizeof(uint32_t),
+                indexCount * sizeof(uint32_t),
+                range.indexCount * sizeof(uint32_t));
+            range.firstIndex = (GLuint)indexCount;
+            indexCount += range.indexCount;
+        }
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    glDeleteBuffers(1, &m_vertexBuffer);
+    glDeleteBuffers(1, &m_indexBuffer);
+    m_vertexBuffer = vertexBuffer;
+    m_indexBuffer = indexBuffer;
+    m_vertexCount = vertexCount;
+    m_vertexCapacity = vertexCapacity;
+    m_indexCount = indexCount;
+    m_indexCapacity = indexCapacity;
+
+    // attach the new buffers to the shared vertex array object
+    GetGLStateCache().BindVertexArray(m_vao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+    glBindVertexBuffer(VERTEX_BUFFER_BINDING, m_vertexBuffer, 0, (GLsizei)vertexStride);
+    GetGLStateCache().BindVertexArray(0);
+}
+
+/***********************************************************
+ *  AddMesh()
+ *
+ *  This method is used for appending the vertex and index
+ *  data of a mesh to the shared buffers.  The indices of the
+ *  mesh stay relative to its first vertex, the base vertex of
+ *  the draw command adds the offset.  When the mesh does not
+ *  fit after the last mesh, the buffers are repacked, and
+ *  grown if the gaps of removed meshes are not enough.
+ ***********************************************************/
+int SceneMeshes::AddMesh(const ShapeGeometry::MESH_DATA& mesh)
+{
+    return(AddMesh(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size()));
+}
+
+/***********************************************************
+ *  AddMesh()
+ *
+ *  This method is used for appending a mesh from arrays of
+ *  vertices and indices, such as the data of a mapped asset
+ *  pack, which is uploaded without a copy.
+ ***********************************************************/
+int SceneMeshes::AddMesh(
+    const ShapeGeometry::MESH_VERTEX* vertices,
+    size_t vertexCount,
+    const uint32_t* indices,
+    size_t indexCount)
+{
+    size_t vertexStride = sizeof(ShapeGeometry::MESH_VERTEX);
+
+    if ((m_vertexCount + vertexCount > m_vertexCapacity) ||
+        (m_indexCount + indexCount > m_indexCapacity))
+    {
+        size_t vertexCapacity = m_vertexCapacity;
+        size_t indexCapacity = m_indexCapacity;
+
+        if (m_uploadedVertexCount + vertexCount > vertexCapacity)
+        {
+            vertexCapacity = (m_uploadedVertexCount + vertexCount) * 2;
+        }
+        if (m_uploadedIndexCount + indexCount > indexCapacity)
+        {
+            indexCapacity = (m_uploadedIndexCount + indexCount) * 2;
+        }
+        RepackBuffers(vertexCapacity, indexCapacity);
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_vertexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, m_vertexCount * vertexStride, vertexCount * vertexStride, vertices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_indexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, m_indexCount * sizeof(uint32_t), indexCount * sizeof(uint32_t), indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    MESH_RANGE range;
+    range.firstIndex = (GLuint)m_indexCount;
+    range.indexCount = (GLuint)indexCount;
+    range.baseVertex = (GLint)m_vertexCount;
+    range.vertexCount = (GLuint)vertexCount;
+    range.bUploaded = true;
+
+    m_vertexCount += vertexCount;
+    m_indexCount += indexCount;
+    m_uploadedVertexCount += vertexCount;
+    m_uploadedIndexCount += indexCount;
+
+    if (m_freeMeshes.empty() == false)
+    {
+        int meshIndex = m_freeMeshes.back();
+        m_freeMeshes.pop_back();
+        m_meshes[meshIndex] = range;
+
+        return(meshIndex);
+    }
+
+    m_meshes.push_back(range);
+
+    return((int)m_meshes.size() - 1);
+}
+
+/***********************************************************
+ *  RemoveMesh()
+ *
+ *  This method is used for freeing the space of a mesh.  The
+ *  data stays in the buffers until the next repack, so draws
+ *  already issued with the mesh are not affected, and the
+ *  mesh index is given to the next added mesh.
+ ***********************************************************/
+void SceneMeshes::RemoveMesh(int meshIndex)
+{
+    if ((meshIndex < 0) || (meshIndex >= (int)m_meshes.size()) ||
+        (m_meshes[meshIndex].bUploaded == false))
+    {
+        return;
+    }
+
+    m_meshes[meshIndex].bUploaded = false;
+    m_uploadedVertexCount -= m_meshes[meshIndex].vertexCount;
+    m_uploadedIndexCount -= m_meshes[meshIndex].indexCount;
+    m_freeMeshes.push_back(meshIndex);
+}
+
+/***********************************************************
+ *  GetMeshBytes()
+ *
+ *  This method returns the bytes of vertex and index data of
+ *  the uploaded meshes.
+ ***********************************************************/
+size_t SceneMeshes::GetMeshBytes() const
+{
+    return(m_uploadedVertexCount * sizeof(ShapeGeometry::MESH_VERTEX) + m_uploadedIndexCount * sizeof(uint32_t));
+}
+
+/***********************************************************
+ *  GetMeshCount()
+ *
+ *  This method returns the number of uploaded meshes.
+ ***********************************************************/
+int SceneMeshes::GetMeshCount() const
+{
+    return((int)(m_meshes.size() - m_freeMeshes.size()));
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting a frame of draws.  It
+ *  returns the mapped memory where the caller writes the
+ *  instance data of the frame, and binds the state that is
+ *  shared by every draw of the frame.
+ ***********************************************************/
+SceneMeshes::INSTANCE_DATA* SceneMeshes::BeginFrame(size_t instanceCount)
+{
+    // every instance is drawn by at most one command
+    size_t capacity = (instanceCount > 0) ? instanceCount : 1;
+    size_t instanceBytes = capacity * sizeof(INSTANCE_DATA);
+
+    INSTANCE_DATA* instances = (INSTANCE_DATA*)m_instanceBuffer.BeginRegion(instanceBytes);
+    m_commands = (DRAW_COMMAND*)m_commandBuffer.BeginRegion(capacity * sizeof(DRAW_COMMAND));
+    m_commandCount = 0;
+    m_submittedCount = 0;
+    m_commandCapacity = capacity;
+    m_triangleCount = 0;
+
+    glBindBufferRange(
+        GL_SHADER_STORAGE_BUFFER,
+        INSTANCE_BUFFER_BINDING,
+        m_instanceBuffer.GetBuffer(),
+        m_instanceBuffer.GetRegionOffset(),
+        instanceBytes);
+    GetGLStateCache().BindVertexArray(m_vao);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer.GetBuffer());
+
+    return(instances);
+}
+
+/***********************************************************
+ *  AddDrawCommand()
+ *
+ *  This method is used for queueing a draw of a mesh for each
+ *  of the passed in range of the frame instances.
+ ***********************************************************/
+void SceneMeshes::AddDrawCommand(int meshIndex, GLuint firstInstance, GLuint instanceCount)
+{
+    if ((meshIndex < 0) || (meshIndex >= (int)m_meshes.size()) || (m_meshes[meshIndex].bUploaded == false) ||
+        (instanceCount == 0) || (m_commandCount >= m_commandCapacity))
+    {
+        return;
+    }
+
+    DRAW_COMMAND& command = m_commands[m_commandCount];
+    command.count = m_meshes[meshIndex].indexCount;
+    command.instanceCount = instanceCount;
+    command.firstIndex = m_meshes[meshIndex].firstIndex;
+    command.baseVertex = m_meshes[meshIndex].baseVertex;
+    command.baseInstance = firstInstance;
+
+    m_commandCount++;
+    m_triangleCount += (size_t)(command.count / 3) * instanceCount;
+}
+
+/***********************************************************
+ *  DrawCommands()
+ *
+ *  This method is used for submitting all of the commands
+ *  queued since the last submit with a single multi-draw
+ *  call.  The caller changes shader state between submits.
+ ***********************************************************/
+void SceneMeshes::DrawCommands()
+{
+    if (m_commandCount <= m_submittedCount)
+    {
+        return;
+    }
+
+    GLintptr offset = m_commandBuffer.GetRegionOffset() + m_submittedCount * sizeof(DRAW_COMMAND);
+
+    glMultiDrawElementsIndirect(
+        GL_TRIANGLES,
+        GL_UNSIGNED_INT,
+        (const void*)offset,
+        (GLsizei)(m_commandCount - m_submittedCount),
+        0);
+
+    m_submittedCount = m_commandCount;
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for submitting the last queued draws
+ *  and fencing the frame regions of the mapped buffers.
+ ***********************************************************/
+void SceneMeshes::EndFrame()
+{
+    DrawCommands();
+
+    m_instanceBuffer.EndRegion();
+    m_commandBuffer.EndRegion();
+    m_commands = NULL;
+}
+
+/***********************************************************
+ *  HasQueuedCommands()
+ *
+ *  This method returns whether draw commands were queued
+ *  since the last submit.
+ ***********************************************************/
+bool SceneMeshes::HasQueuedCommands() const
+{
+    return(m_commandCount > m_submittedCount);
+}
+
+/***********************************************************
+ *  GetFrameTriangleCount()
+ *
+ *  This method returns the number of triangles of the draw
+ *  commands queued since the frame started.  It is kept after
+ *  the frame ends until the next frame starts.
+ ***********************************************************/
+size_t SceneMeshes::GetFrameTriangleCount() const
+{
+    return(m_triangleCount);
+}
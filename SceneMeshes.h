@@ -0,0 +1,134 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenemeshes.h
+// ============
+// upload scene meshes and draw them with per-instance data
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShapeGeometry.h"
+#include "PersistentBuffer.h"
+
+#include <GL/glew.h>
+#include <vector>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  SceneMeshes
+ *
+ *  This class keeps every mesh of the scene in one shared
+ *  vertex buffer and one shared index buffer, so all meshes
+ *  are drawn with the same vertex array object.  Everything
+ *  that differs between the objects - the transform, color,
+ *  material, texture layer and UV scale - is read by the vertex
+ *  shader from a storage buffer of instance data, and the
+ *  draws of a frame are submitted with multi-draw indirect
+ *  commands.  The instance data and the commands are written
+ *  straight into persistently mapped buffers.
+ ***********************************************************/
+class SceneMeshes
+{
+public:
+    // constructor
+    SceneMeshes();
+    // destructor
+    ~SceneMeshes();
+
+    // per-instance data, packed to match the std430 buffer
+    struct INSTANCE_DATA
+    {
+        glm::mat4 model;
+        glm::vec4 color;
+        glm::vec2 UVscale;
+        GLuint materialIndex;
+        // layer of the bound texture array, NO_TEXTURE_LAYER
+        // draws with the color
+        GLuint textureLayer;
+    };
+
+    // texture layer of the instances without a texture
+    static const GLuint NO_TEXTURE_LAYER = 0xFFFFFFFF;
+
+    // upload a mesh and return its mesh index
+    int AddMesh(const ShapeGeometry::MESH_DATA& mesh);
+    int AddMesh(
+        const ShapeGeometry::MESH_VERTEX* vertices,
+        size_t vertexCount,
+        const uint32_t* indices,
+        size_t indexCount);
+    // free the space of a mesh, its index can be reused
+    void RemoveMesh(int meshIndex);
+    // number of uploaded meshes
+    int GetMeshCount() const;
+    // bytes of vertex and index data of the uploaded meshes
+    size_t GetMeshBytes() const;
+
+    // start a frame, returns where its instance data is written
+    INSTANCE_DATA* BeginFrame(size_t instanceCount);
+    // queue a draw of a range of the frame instances
+    void AddDrawCommand(int meshIndex, GLuint firstInstance, GLuint instanceCount);
+    // submit the queued draws with one multi-draw call
+    void DrawCommands();
+    // set when draws are queued that are not submitted yet
+    bool HasQueuedCommands() const;
+    // finish the frame once all of its draws are submitted
+    void EndFrame();
+    // number of triangles queued since the frame started
+    size_t GetFrameTriangleCount() const;
+
+private:
+    // location of a mesh in the shared buffers
+    struct MESH_RANGE
+    {
+        GLuint firstIndex;
+        GLuint indexCount;
+        GLint baseVertex;
+        GLuint vertexCount;
+        // false once the mesh is removed
+        bool bUploaded;
+    };
+
+    // indirect draw command, laid out as OpenGL reads it
+    struct DRAW_COMMAND
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    // vertex array object shared by every mesh
+    GLuint m_vao;
+    // shared vertex and index buffers
+    GLuint m_vertexBuffer;
+    GLuint m_indexBuffer;
+    // used and allocated sizes of the shared buffers
+    size_t m_vertexCount;
+    size_t m_vertexCapacity;
+    size_t m_indexCount;
+    size_t m_indexCapacity;
+    // uploaded meshes, indexed by mesh index
+    std::vector<MESH_RANGE> m_meshes;
+    // indices of removed meshes that can be reused
+    std::vector<int> m_freeMeshes;
+    // vertices and indices of the uploaded meshes
+    size_t m_uploadedVertexCount;
+    size_t m_uploadedIndexCount;
+
+    // instance data and draw commands of the frames in flight
+    PersistentBuffer m_instanceBuffer;
+    PersistentBuffer m_commandBuffer;
+    // draw commands of the current frame
+    DRAW_COMMAND* m_commands;
+    // commands written, submitted and that fit in the frame
+    size_t m_commandCount;
+    size_t m_submittedCount;
+    size_t m_commandCapacity;
+    // triangles of the draw commands of the current frame
+    size_t m_triangleCount;
+
+    // move the uploaded meshes into new packed shared buffers
+    void RepackBuffers(size_t vertexCapacity, size_t indexCapacity);
+};
@@ -0,0 +1,116 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderuniform.h
+// ============
+// typed handles for shader uniform locations
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "GLStateCache.h"
+
+/***********************************************************
+ *  ShaderUniform
+ *
+ *  This template holds the location of one uniform in a
+ *  linked shader program.  The location is looked up by name
+ *  a single time, and every Set() call afterwards writes the
+ *  value straight to that location with no string handling
+ *  and no driver lookup.  The values go through the state
+ *  cache, which drops a write of the value a uniform has.
+ ***********************************************************/
+template<typename T>
+class ShaderUniform
+{
+public:
+    // constructor
+    ShaderUniform()
+        : m_programID(0), m_location(-1)
+    {
+    }
+
+    // look up the uniform location in the passed in program
+    bool Resolve(GLuint programID, const char* name)
+    {
+        m_programID = programID;
+        m_location = glGetUniformLocation(programID, name);
+        return(m_location != -1);
+    }
+
+    // the uniform was found in the shader program
+    bool IsValid() const
+    {
+        return(m_location != -1);
+    }
+
+    // write the passed in value into the active shader program
+    void Set(const T& value) const;
+
+private:
+    // program the location was resolved in
+    GLuint m_programID;
+    // resolved uniform location, -1 when not found
+    GLint m_location;
+};
+
+template<>
+inline void ShaderUniform<bool>::Set(const bool& value) const
+{
+    GetGLStateCache().SetUniform(m_programID, m_location, (int)value);
+}
+
+template<>
+inline void ShaderUniform<int>::Set(const int& value) const
+{
+    GetGLStateCache().SetUniform(m_programID, m_location, value);
+}
+
+template<>
+inline void ShaderUniform<float>::Set(const float& value) const
+{
+    GetGLStateCache().SetUniform(m_programID, m_location, value);
+}
+
+template<>
+inline void ShaderUniform<glm::vec2>::Set(const glm::vec2& value) const
+{
+    GetGLStateCache().SetUniform(m_programID, m_location, value);
+}
+
+template<>
+inline void ShaderUniform<glm::vec3>::Set(const glm::vec3& value) const
+{
+    GetGLStateCache().SetUniform(m_programID, m_location, value);
+}
+
+template<>
+inline void ShaderUniform<glm::vec4>::Set(const glm::vec4& value) const
+{
+    GetGLStateCache().SetUniform(m_programID, m_location, value);
+}
+
+template<>
+inline void ShaderUniform<glm::mat4>::Set(const glm::mat4& value) const
+{
+    GetGLStateCache().SetUniform(m_programID, m_location, value);
+}
+
+/***********************************************************
+ *  GetActiveShaderProgram()
+ *
+ *  This function returns the ID of the shader program that
+ *  is currently in use, which is the program the uniform
+ *  handles are resolved against.
+ ***********************************************************/
+inline GLuint GetActiveShaderProgram()
+{
+    GLint programID = 0;
+
+    glGetIntegerv(GL_CURRENT_PROGRAM, &programID);
+
+    return((GLuint)programID);
+}
@@ -0,0 +1,460 @@
+///////////////////////////////////////////////////////////////////////////////
+// shapegeometry.cpp
+// ============
+// build the vertex and index data of the basic 3D shapes
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShapeGeometry.h"
+
+#include <cmath>
+
+// declaration of the global variables and defines
+namespace
+{
+    const float TWO_PI = 6.28318530718f;
+    const float PI = 3.14159265359f;
+
+    // radius of the top of the tapered cylinder
+    const float TAPERED_TOP_RADIUS = 0.5f;
+    // distance from the center of the torus to the tube center
+    const float TORUS_MAIN_RADIUS = 1.0f;
+
+    // tessellation of the round shapes at each level of detail,
+    // the segments around the shape and the sphere and torus rings
+    const int LEVEL_SEGMENTS[ShapeGeometry::LEVEL_COUNT] = { 36, 18, 10, 6 };
+    const int LEVEL_RINGS[ShapeGeometry::LEVEL_COUNT] = { 18, 9, 6, 4 };
+}
+
+/***********************************************************
+ *  AddVertex()
+ *
+ *  This method is used for appending one vertex to the mesh
+ *  and returns the index of the new vertex.
+ ***********************************************************/
+uint32_t ShapeGeometry::AddVertex(
+    MESH_DATA& mesh,
+    glm::vec3 position,
+    glm::vec3 normal,
+    glm::vec2 textureCoordinate)
+{
+    MESH_VERTEX vertex;
+
+    vertex.position = position;
+    vertex.normal = normal;
+    vertex.textureCoordinate = textureCoordinate;
+    mesh.vertices.push_back(vertex);
+
+    return((uint32_t)mesh.vertices.size() - 1);
+}
+
+/***********************************************************
+ *  AddTriangle()
+ *
+ *  This method is used for appending the indices of one
+ *  triangle to the mesh.
+ ***********************************************************/
+void ShapeGeometry::AddTriangle(MESH_DATA& mesh, uint32_t a, uint32_t b, uint32_t c)
+{
+    mesh.indices.push_back(a);
+    mesh.indices.push_back(b);
+    mesh.indices.push_back(c);
+}
+
+/***********************************************************
+ *  AddFlatTriangle()
+ *
+ *  This method is used for appending a triangle with its own
+ *  vertices, so it is lit with the normal of its face.
+ ***********************************************************/
+void ShapeGeometry::AddFlatTriangle(
+    MESH_DATA& mesh,
+    glm::vec3 a,
+    glm::vec3 b,
+    glm::vec3 c)
+{
+    glm::vec3 normal = glm::normalize(glm::cross(b - a, c - a));
+
+    uint32_t first = AddVertex(mesh, a, normal, glm::vec2(0.0f, 0.0f));
+    AddVertex(mesh, b, normal, glm::vec2(1.0f, 0.0f));
+    AddVertex(mesh, c, normal, glm::vec2(0.5f, 1.0f));
+
+    AddTriangle(mesh, first, first + 1, first + 2);
+}
+
+/***********************************************************
+ *  AddQuad()
+ *
+ *  This method is used for appending a quad with its own
+ *  vertices, so it is lit with the normal of its face.  The
+ *  whole texture is mapped across the quad.
+ ***********************************************************/
+void ShapeGeometry::AddQuad(
+    MESH_DATA& mesh,
+    glm::vec3 a,
+    glm::vec3 b,
+    glm::vec3 c,
+    glm::vec3 d)
+{
+    glm::vec3 normal = glm::normalize(glm::cross(b - a, c - a));
+
+    uint32_t first = AddVertex(mesh, a, normal, glm::vec2(0.0f, 0.0f));
+    AddVertex(mesh, b, normal, glm::vec2(1.0f, 0.0f));
+    AddVertex(mesh, c, normal, glm::vec2(1.0f, 1.0f));
+    AddVertex(mesh, d, normal, glm::vec2(0.0f, 1.0f));
+
+    AddTriangle(mesh, first, first + 1, first + 2);
+    AddTriangle(mesh, first, first + 2, first + 3);
+}
+
+/***********************************************************
+ *  AddRoundShape()
+ *
+ *  This method is used for appending a cylinder, cone or
+ *  tapered cylinder that stands on the XZ plane with a
+ *  height of 1.  A cone is a round shape with a top radius
+ *  of zero.
+ ***********************************************************/
+void ShapeGeometry::AddRoundShape(
+    MESH_DATA& mesh,
+    int segments,
+    float bottomRadius,
+    float topRadius,
+    bool bCapTop,
+    bool bCapBottom)
+{
+    // the sides - the first and last column of vertices are at
+    // the same place with different texture coordinates, so the
+    // texture wraps around once
+    uint32_t firstSide = (uint32_t)mesh.vertices.size();
+    for (int i = 0; i <= segments; i++)
+    {
+        float angle = TWO_PI * (float)i / (float)segments;
+        float x = std::cos(angle);
+        float z = std::sin(angle);
+        float u = (float)i / (float)segments;
+        // the slope of the sides tilts the normal upwards
+        glm::vec3 normal = glm::normalize(glm::vec3(x, bottomRadius - topRadius, z));
+
+        AddVertex(mesh, glm::vec3(x * bottomRadius, 0.0f, z * bottomRadius), normal, glm::vec2(u, 0.0f));
+        AddVertex(mesh, glm::vec3(x * topRadius, 1.0f, z * topRadius), normal, glm::vec2(u, 1.0f));
+    }
+    for (int i = 0; i < segments; i++)
+    {
+        uint32_t bottom = firstSide + i * 2;
+        uint32_t top = bottom + 1;
+        uint32_t nextBottom = bottom + 2;
+        uint32_t nextTop = bottom + 3;
+
+        AddTriangle(mesh, nextBottom, bottom, top);
+        AddTriangle(mesh, nextBottom, top, nextTop);
+    }
+
+    // the caps are fans around their center vertex
+    for (int cap = 0; cap < 2; cap++)
+    {
+        bool bTop = (cap == 0);
+        float radius = bTop ? topRadius : bottomRadius;
+        float y = bTop ? 1.0f : 0.0f;
+        glm::vec3 normal(0.0f, bTop ? 1.0f : -1.0f, 0.0f);
+
+        if ((bTop && !bCapTop) || (!bTop && !bCapBottom))
+        {
+            continue;
+        }
+
+        uint32_t center = AddVertex(mesh, glm::vec3(0.0f, y, 0.0f), normal, glm::vec2(0.5f, 0.5f));
+        for (int i = 0; i <= segments; i++)
+        {
+            float angle = TWO_PI * (float)i / (float)segments;
+            float x = std::cos(angle);
+            float z = std::sin(angle);
+
+            AddVertex(mesh, glm::vec3(x * radius, y, z * radius), normal, glm::vec2(0.5f + x * 0.5f, 0.5f + z * 0.5f));
+        }
+        for (int i = 0; i < segments; i++)
+        {
+            uint32_t ring = center + 1 + i;
+
+            if (bTop)
+            {
+                AddTriangle(mesh, center, ring + 1, ring);
+            }
+            else
+            {
+                AddTriangle(mesh, center, ring, ring + 1);
+            }
+        }
+    }
+}
+
+/***********************************************************
+ *  BuildBoxMesh()
+ *
+ *  This method is used for building a cube with a size of 1
+ *  around the origin.  Each face maps the whole texture.
+ ***********************************************************/
+void ShapeGeometry::BuildBoxMesh(MESH_DATA& mesh)
+{
+    mesh.vertices.clear();
+    mesh.indices.clear();
+
+    // front and back
+    AddQuad(mesh, glm::vec3(-0.5f, -0.5f, 0.5f), glm::vec3(0.5f, -0.5f, 0.5f), glm::vec3(0.5f, 0.5f, 0.5f), glm::vec3(-0.5f, 0.5f, 0.5f));
+    AddQuad(mesh, glm::vec3(0.5f, -0.5f, -0.5f), glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3(-0.5f, 0.5f, -0.5f), glm::vec3(0.5f, 0.5f, -0.5f));
+    // right and left
+    AddQuad(mesh, glm::vec3(0.5f, -0.5f, 0.5f), glm::vec3(0.5f, -0.5f, -0.5f), glm::vec3(0.5f, 0.5f, -0.5f), glm::vec3(0.5f, 0.5f, 0.5f));
+    AddQuad(mesh, glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3(-0.5f, -0.5f, 0.5f), glm::vec3(-0.5f, 0.5f, 0.5f), glm::vec3(-0.5f, 0.5f, -0.5f));
+    // top and bottom
+    AddQuad(mesh, glm::vec3(-0.5f, 0.5f, 0.5f), glm::vec3(0.5f, 0.5f, 0.5f), glm::vec3(0.5f, 0.5f, -0.5f), glm::vec3(-0.5f, 0.5f, -0.5f));
+    AddQuad(mesh, glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3(0.5f, -0.5f, -0.5f), glm::vec3(0.5f, -0.5f, 0.5f), glm::vec3(-0.5f, -0.5f, 0.5f));
+}
+
+/***********************************************************
+ *  BuildPlaneMesh()
+ *
+ *  This method is used for building a plane facing up that
+ *  spans from -1 to 1 in X and Z.
+ ***********************************************************/
+void ShapeGeometry::BuildPlaneMesh(MESH_DATA& mesh)
+{
+    mesh.vertices.clear();
+    mesh.indices.clear();
+
+    AddQuad(mesh, glm::vec3(-1.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, -1.0f), glm::vec3(-1.0f, 0.0f, -1.0f));
+}
+
+/***********************************************************
+ *  BuildCylinderMesh()
+ *
+ *  This method is used for building a capped cylinder with a
+ *  radius of 1 and a height of 1.
+ ***********************************************************/
+void ShapeGeometry::BuildCylinderMesh(MESH_DATA& mesh, int segments)
+{
+    mesh.vertices.clear();
+    mesh.indices.clear();
+
+    AddRoundShape(mesh, segments, 1.0f, 1.0f, true, true);
+}
+
+/***********************************************************
+ *  BuildConeMesh()
+ *
+ *  This method is used for building a cone with a base
+ *  radius of 1 and a height of 1.
+ ***********************************************************/
+void ShapeGeometry::BuildConeMesh(MESH_DATA& mesh, int segments)
+{
+    mesh.vertices.clear();
+    mesh.indices.clear();
+
+    AddRoundShape(mesh, segments, 1.0f, 0.0f, false, true);
+}
+
+/***********************************************************
+ *  BuildPrismMesh()
+ *
+ *  This method is used for building a triangular prism with
+ *  a size of 1 around the origin, its ends facing along Z.
+ ***********************************************************/
+void ShapeGeometry::BuildPrismMesh(MESH_DATA& mesh)
+{
+    mesh.vertices.clear();
+    mesh.indices.clear();
+
+    // the triangle ends
+    AddFlatTriangle(mesh, glm::vec3(-0.5f, -0.5f, 0.5f), glm::vec3(0.5f, -0.5f, 0.5f), glm::vec3(0.0f, 0.5f, 0.5f));
+    AddFlatTriangle(mesh, glm::vec3(0.5f, -0.5f, -0.5f), glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3(0.0f, 0.5f, -0.5f));
+    // the bottom and the two slanted sides
+    AddQuad(mesh, glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3(0.5f, -0.5f, -0.5f), glm::vec3(0.5f, -0.5f, 0.5f), glm::vec3(-0.5f, -0.5f, 0.5f));
+    AddQuad(mesh, glm::vec3(0.5f, -0.5f, 0.5f), glm::vec3(0.5f, -0.5f, -0.5f), glm::vec3(0.0f, 0.5f, -0.5f), glm::vec3(0.0f, 0.5f, 0.5f));
+    AddQuad(mesh, glm::vec3(0.0f, 0.5f, 0.5f), glm::vec3(0.0f, 0.5f, -0.5f), glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3(-0.5f, -0.5f, 0.5f));
+}
+
+/***********************************************************
+ *  BuildPyramid4Mesh()
+ *
+ *  This method is used for building a pyramid with a square
+ *  base, with a size of 1 around the origin.
+ ***********************************************************/
+void ShapeGeometry::BuildPyramid4Mesh(MESH_DATA& mesh)
+{
+    glm::vec3 apex(0.0f, 0.5f, 0.0f);
+
+    mesh.vertices.clear();
+    mesh.indices.clear();
+
+    AddQuad(mesh, glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3(0.5f, -0.5f, -0.5f), glm::vec3(0.5f, -0.5f, 0.5f), glm::vec3(-0.5f, -0.5f, 0.5f));
+    AddFlatTriangle(mesh, glm::vec3(-0.5f, -0.5f, 0.5f), glm::vec3(0.5f, -0.5f, 0.5f), apex);
+    AddFlatTriangle(mesh, glm::vec3(0.5f, -0.5f, 0.5f), glm::vec3(0.5f, -0.5f, -0.5f), apex);
+    AddFlatTriangle(mesh, glm::vec3(0.5f, -0.5f, -0.5f), glm::vec3(-0.5f, -0.5f, -0.5f), apex);
+    AddFlatTriangle(mesh, glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3(-0.5f, -0.5f, 0.5f), apex);
+}
+
+/***********************************************************
+ *  BuildSphereMesh()
+ *
+ *  This method is used for building a sphere with a radius
+ *  of 1 around the origin from rings of vertices.
+ ***********************************************************/
+void ShapeGeometry::BuildSphereMesh(MESH_DATA& mesh, int slices, int stacks)
+{
+    mesh.vertices.clear();
+    mesh.indices.clear();
+
+    for (int stack = 0; stack <= stacks; stack++)
+    {
+        float polar = PI * (float)stack / (float)stacks;
+
+        for (int slice = 0; slice <= slices; slice++)
+        {
+            float azimuth = TWO_PI * (float)slice / (float)slices;
+            glm::vec3 position(
+                std::sin(polar) * std::cos(azimuth),
+                std::cos(polar),
+                std::sin(polar) * std::sin(azimuth));
+
+            AddVertex(mesh, position, position, glm::vec2((float)slice / (float)slices, 1.0f - (float)stack / (float)stacks));
+        }
+    }
+
+    int rowLength = slices + 1;
+    for (int stack = 0; stack < stacks; stack++)
+    {
+        for (int slice = 0; slice < slices; slice++)
+        {
+            uint32_t upper = stack * rowLength + slice;
+            uint32_t lower = upper + rowLength;
+
+            // the rings at the poles collapse to a point, so one
+            // triangle of each quad there has no area
+            if (stack < stacks - 1)
+            {
+                AddTriangle(mesh, lower + 1, lower, upper);
+            }
+            if (stack > 0)
+            {
+                AddTriangle(mesh, lower + 1, upper, upper + 1);
+            }
+        }
+    }
+}
+
+/***********************************************************
+ *  BuildTaperedCylinderMesh()
+ *
+ *  This method is used for building a capped cylinder with a
+ *  bottom radius of 1 that narrows towards its top.
+ ***********************************************************/
+void ShapeGeometry::BuildTaperedCylinderMesh(MESH_DATA& mesh, int segments)
+{
+    mesh.vertices.clear();
+    mesh.indices.clear();
+
+    AddRoundShape(mesh, segments, 1.0f, TAPERED_TOP_RADIUS, true, true);
+}
+
+/***********************************************************
+ *  BuildTorusMesh()
+ *
+ *  This method is used for building a torus in the XY plane
+ *  with a radius of 1 to the center of its tube.
+ ***********************************************************/
+void ShapeGeometry::BuildTorusMesh(MESH_DATA& mesh, int mainSegments, int tubeSegments, float thickness)
+{
+    mesh.vertices.clear();
+    mesh.indices.clear();
+
+    for (int i = 0; i <= mainSegments; i++)
+    {
+        float mainAngle = TWO_PI * (float)i / (float)mainSegments;
+        glm::vec3 outward(std::cos(mainAngle), std::sin(mainAngle), 0.0f);
+
+        for (int j = 0; j <= tubeSegments; j++)
+        {
+            float tubeAngle = TWO_PI * (float)j / (float)tubeSegments;
+            glm::vec3 normal = outward * std::cos(tubeAngle) + glm::vec3(0.0f, 0.0f, std::sin(tubeAngle));
+
+            AddVertex(
+                mesh,
+                outward * TORUS_MAIN_RADIUS + normal * thickness,
+                normal,
+                glm::vec2((float)i / (float)mainSegments, (float)j / (float)tubeSegments));
+        }
+    }
+
+    int rowLength = tubeSegments + 1;
+    for (int i = 0; i < mainSegments; i++)
+    {
+        for (int j = 0; j < tubeSegments; j++)
+        {
+            uint32_t current = i * rowLength + j;
+            uint32_t next = current + rowLength;
+
+            AddTriangle(mesh, current, next, next + 1);
+            AddTriangle(mesh, current, next + 1, current + 1);
+        }
+    }
+}
+
+/***********************************************************
+ *  HasLevels()
+ *
+ *  This method returns true when a shape is built at every
+ *  tessellation level.  The flat shapes only have the one
+ *  level.
+ ***********************************************************/
+bool ShapeGeometry::HasLevels(SHAPE shape)
+{
+    return((SHAPE_BOX != shape) && (SHAPE_PLANE != shape) &&
+        (SHAPE_PRISM != shape) && (SHAPE_PYRAMID4 != shape));
+}
+
+/***********************************************************
+ *  BuildShapeMesh()
+ *
+ *  This method is used for building the vertex and index data
+ *  of a shape at a tessellation level.  The flat shapes are
+ *  the same at every level.
+ ***********************************************************/
+void ShapeGeometry::BuildShapeMesh(SHAPE shape, int level, MESH_DATA& mesh)
+{
+    int segments = LEVEL_SEGMENTS[level];
+    int rings = LEVEL_RINGS[level];
+
+    switch (shape)
+    {
+    case SHAPE_BOX:
+        BuildBoxMesh(mesh);
+        break;
+    case SHAPE_PLANE:
+        BuildPlaneMesh(mesh);
+        break;
+    case SHAPE_CYLINDER:
+        BuildCylinderMesh(mesh, segments);
+        break;
+    case SHAPE_CONE:
+        BuildConeMesh(mesh, segments);
+        break;
+    case SHAPE_PRISM:
+        BuildPrismMesh(mesh);
+        break;
+    case SHAPE_PYRAMID4:
+        BuildPyramid4Mesh(mesh);
+        break;
+    case SHAPE_SPHERE:
+        BuildSphereMesh(mesh, segments, rings);
+        break;
+    case SHAPE_TAPERED_CYLINDER:
+        BuildTaperedCylinderMesh(mesh, segments);
+        break;
+    case SHAPE_TORUS:
+        BuildTorusMesh(mesh, segments, rings);
+        break;
+    default:
+        mesh.vertices.clear();
+        mesh.indices.clear();
+        break;
+    }
+}
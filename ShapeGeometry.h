@@ -0,0 +1,111 @@
+///////////////////////////////////////////////////////////////////////////////
+// shapegeometry.h
+// ============
+// build the vertex and index data of the basic 3D shapes
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  ShapeGeometry
+ *
+ *  This class builds indexed triangle lists for the basic 3D
+ *  shapes on the CPU.  It makes no OpenGL calls, so the data
+ *  can be built by the application and by offline tools.
+ *  The shapes follow the same conventions as the shapes of
+ *  the ShapeMeshes library - the plane spans -1 to 1 in X
+ *  and Z, the box is a unit cube around the origin, the round
+ *  shapes stand on the XZ plane with a radius of 1 and a
+ *  height of 1, and the torus lies in the XY plane.
+ ***********************************************************/
+class ShapeGeometry
+{
+public:
+    // one vertex of a mesh
+    struct MESH_VERTEX
+    {
+        glm::vec3 position;
+        glm::vec3 normal;
+        glm::vec2 textureCoordinate;
+    };
+
+    // vertex and index data of one mesh
+    struct MESH_DATA
+    {
+        std::vector<MESH_VERTEX> vertices;
+        std::vector<uint32_t> indices;
+    };
+
+    // basic shapes, in the order of the scene mesh types
+    enum SHAPE
+    {
+        SHAPE_BOX,
+        SHAPE_PLANE,
+        SHAPE_CYLINDER,
+        SHAPE_CONE,
+        SHAPE_PRISM,
+        SHAPE_PYRAMID4,
+        SHAPE_SPHERE,
+        SHAPE_TAPERED_CYLINDER,
+        SHAPE_TORUS,
+        SHAPE_COUNT
+    };
+
+    // tessellation levels of the round shapes, 0 is the finest
+    static const int LEVEL_COUNT = 4;
+    // changed whenever the data built for a shape and level
+    // changes, so stored copies of the data can be checked
+    static const uint32_t GEOMETRY_VERSION = 1;
+
+    // check if a shape has more than one tessellation level
+    static bool HasLevels(SHAPE shape);
+    // build the data of a shape at a tessellation level
+    static void BuildShapeMesh(SHAPE shape, int level, MESH_DATA& mesh);
+
+    // build the data of the basic shapes
+    static void BuildBoxMesh(MESH_DATA& mesh);
+    static void BuildPlaneMesh(MESH_DATA& mesh);
+    static void BuildCylinderMesh(MESH_DATA& mesh, int segments = 36);
+    static void BuildConeMesh(MESH_DATA& mesh, int segments = 36);
+    static void BuildPrismMesh(MESH_DATA& mesh);
+    static void BuildPyramid4Mesh(MESH_DATA& mesh);
+    static void BuildSphereMesh(MESH_DATA& mesh, int slices = 36, int stacks = 18);
+    static void BuildTaperedCylinderMesh(MESH_DATA& mesh, int segments = 36);
+    static void BuildTorusMesh(MESH_DATA& mesh, int mainSegments = 36, int tubeSegments = 18, float thickness = 0.1f);
+
+private:
+    // append one vertex and return its index
+    static uint32_t AddVertex(
+        MESH_DATA& mesh,
+        glm::vec3 position,
+        glm::vec3 normal,
+        glm::vec2 textureCoordinate);
+    // append one triangle, counter-clockwise from the front
+    static void AddTriangle(MESH_DATA& mesh, uint32_t a, uint32_t b, uint32_t c);
+    // append a flat triangle, counter-clockwise from the front
+    static void AddFlatTriangle(
+        MESH_DATA& mesh,
+        glm::vec3 a,
+        glm::vec3 b,
+        glm::vec3 c);
+    // append a flat quad, counter-clockwise from the front
+    static void AddQuad(
+        MESH_DATA& mesh,
+        glm::vec3 a,
+        glm::vec3 b,
+        glm::vec3 c,
+        glm::vec3 d);
+    // append the sides and caps of a round shape
+    static void AddRoundShape(
+        MESH_DATA& mesh,
+        int segments,
+        float bottomRadius,
+        float topRadius,
+        bool bCapTop,
+        bool bCapBottom);
+};
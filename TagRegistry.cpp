@@ -0,0 +1,158 @@
+///////////////////////////////////////////////////////////////////////////////
+// tagregistry.cpp
+// ============
+// intern string tags into small integer handles
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TagRegistry.h"
+
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+    // starting size of the open addressing table
+    const size_t INITIAL_SLOTS = 32;
+}
+
+/***********************************************************
+ *  TagRegistry()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TagRegistry::TagRegistry()
+{
+    Clear();
+}
+
+/***********************************************************
+ *  Intern()
+ *
+ *  This method is used for interning a tag string.  A tag
+ *  that was interned before keeps its handle, otherwise the
+ *  tag gets the next handle in order.  Two different tags
+ *  with the same hash are reported, since handles are only
+ *  found by hash on the draw path.
+ ***********************************************************/
+uint16_t TagRegistry::Intern(const std::string& tag)
+{
+    uint32_t tagHash = HashTag(tag.c_str());
+    uint16_t handle = Find(tagHash);
+
+    if (INVALID_HANDLE != handle)
+    {
+        if (m_tags[handle].compare(tag) != 0)
+        {
+            std::cout << "Tag hash collision between " << m_tags[handle] << " and " << tag << std::endl;
+            return(INVALID_HANDLE);
+        }
+        return(handle);
+    }
+
+    if (m_tags.size() >= INVALID_HANDLE)
+    {
+        std::cout << "Too many tags to intern " << tag << std::endl;
+        return(INVALID_HANDLE);
+    }
+
+    // keep the table at most half full so probes stay short
+    if ((m_tags.size() + 1) * 2 > m_slots.size())
+    {
+        Grow();
+    }
+
+    handle = (uint16_t)m_tags.size();
+    m_tags.push_back(tag);
+    Insert(tagHash, handle);
+
+    return(handle);
+}
+
+/***********************************************************
+ *  Find()
+ *
+ *  This method is used for finding the handle of a tag from
+ *  its hash.  INVALID_HANDLE is returned when the tag was
+ *  never interned.
+ ***********************************************************/
+uint16_t TagRegistry::Find(uint32_t tagHash) const
+{
+    size_t mask = m_slots.size() - 1;
+    size_t index = tagHash & mask;
+
+    while (INVALID_HANDLE != m_slots[index].handle)
+    {
+        if (m_slots[index].hash == tagHash)
+        {
+            return(m_slots[index].handle);
+        }
+        index = (index + 1) & mask;
+    }
+
+    return(INVALID_HANDLE);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the interned tags.
+ ***********************************************************/
+void TagRegistry::Clear()
+{
+    TAG_SLOT emptySlot;
+    emptySlot.hash = 0;
+    emptySlot.handle = INVALID_HANDLE;
+
+    m_tags.clear();
+    m_slots.assign(INITIAL_SLOTS, emptySlot);
+}
+
+/***********************************************************
+ *  GetCount()
+ *
+ *  This method returns the number of interned tags.
+ ***********************************************************/
+int TagRegistry::GetCount() const
+{
+    return((int)m_tags.size());
+}
+
+/***********************************************************
+ *  Grow()
+ *
+ *  This method is used for doubling the size of the table
+ *  and inserting all of the interned tags again.
+ ***********************************************************/
+void TagRegistry::Grow()
+{
+    TAG_SLOT emptySlot;
+    emptySlot.hash = 0;
+    emptySlot.handle = INVALID_HANDLE;
+
+    m_slots.assign(m_slots.size() * 2, emptySlot);
+    for (size_t i = 0; i < m_tags.size(); i++)
+    {
+        Insert(HashTag(m_tags[i].c_str()), (uint16_t)i);
+    }
+}
+
+/***********************************************************
+ *  Insert()
+ *
+ *  This method is used for placing a hash and handle pair in
+ *  the first free slot at or after the home slot of the hash.
+ ***********************************************************/
+void TagRegistry::Insert(uint32_t tagHash, uint16_t handle)
+{
+    size_t mask = m_slots.size() - 1;
+    size_t index = tagHash & mask;
+
+    while (INVALID_HANDLE != m_slots[index].handle)
+    {
+        index = (index + 1) & mask;
+    }
+
+    m_slots[index].hash = tagHash;
+    m_slots[index].handle = handle;
+}
@@ -0,0 +1,69 @@
+///////////////////////////////////////////////////////////////////////////////
+// tagregistry.h
+// ============
+// intern string tags into small integer handles
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  HashTag()
+ *
+ *  This function returns the 32-bit FNV-1a hash of a tag
+ *  string.  It is constexpr, so the hash of a tag that is
+ *  known at compile time costs nothing at run time.
+ ***********************************************************/
+constexpr uint32_t HashTag(const char* tag, uint32_t hash = 2166136261u)
+{
+    return((*tag == 0) ? hash : HashTag(tag + 1, (hash ^ (uint32_t)(unsigned char)*tag) * 16777619u));
+}
+
+/***********************************************************
+ *  TagRegistry
+ *
+ *  This class maps tag hashes to small integer handles.  The
+ *  tags are interned one time at load time, each one getting
+ *  the next handle in order, and afterwards a handle is found
+ *  from a tag hash with one probe into an open addressing
+ *  table - no string compares and no allocations.
+ ***********************************************************/
+class TagRegistry
+{
+public:
+    // constructor
+    TagRegistry();
+
+    // handle returned for tags that were never interned
+    static const uint16_t INVALID_HANDLE = 0xFFFF;
+
+    // intern a tag and return its handle
+    uint16_t Intern(const std::string& tag);
+    // find the handle of a previously interned tag
+    uint16_t Find(uint32_t tagHash) const;
+    // remove all of the interned tags
+    void Clear();
+    // number of interned tags
+    int GetCount() const;
+
+private:
+    struct TAG_SLOT
+    {
+        uint32_t hash;
+        uint16_t handle;
+    };
+
+    // open addressing table, its size is a power of two
+    std::vector<TAG_SLOT> m_slots;
+    // interned tag strings, indexed by handle
+    std::vector<std::string> m_tags;
+
+    // double the table size and insert the tags again
+    void Grow();
+    // insert a hash and handle pair into the table
+    void Insert(uint32_t tagHash, uint16_t handle);
+};
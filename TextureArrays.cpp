@@ -0,0 +1,413 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturearrays.cpp
+// ============
+// store the scene textures as layers of shared texture arrays
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureArrays.h"
+#include "GLStateCache.h"
+
+// declaration of the global variables and defines
+namespace
+{
+    // layers of a new array, doubled whenever it is full
+    const int INITIAL_LAYER_CAPACITY = 4;
+}
+
+/***********************************************************
+ *  TextureArrays()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureArrays::TextureArrays()
+{
+}
+
+/***********************************************************
+ *  ~TextureArrays()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureArrays::~TextureArrays()
+{
+    Clear();
+}
+
+/***********************************************************
+ *  AddTexture()
+ *
+ *  This method is used for reserving a layer for a texture.
+ *  The texture goes into the array with the same size, format
+ *  and number of mip levels, which is created or grown when
+ *  needed.  An existing array keeps its own base level.  The
+ *  layer is written with UploadLevel().
+ ***********************************************************/
+TextureArrays::TEXTURE_LOCATION TextureArrays::AddTexture(
+    int width,
+    int height,
+    int levelCount,
+    GLenum internalFormat,
+    int baseLevel)
+{
+    TEXTURE_LOCATION location;
+    int arrayIndex = -1;
+
+    for (size_t i = 0; i < m_arrays.size(); i++)
+    {
+        const TEXTURE_ARRAY& array = m_arrays[i];
+
+        if ((array.width == width) && (array.height == height) &&
+            (array.levelCount == levelCount) && (array.internalFormat == internalFormat))
+        {
+            arrayIndex = (int)i;
+            break;
+        }
+    }
+
+    if (arrayIndex < 0)
+    {
+        TEXTURE_ARRAY array;
+
+        array.texture = 0;
+        array.width = width;
+        array.height = height;
+        array.levelCount = levelCount;
+        array.internalFormat = internalFormat;
+        array.layerCount = 0;
+        array.layerCapacity = 0;
+        array.baseLevel = (baseLevel < levelCount) ? baseLevel : (levelCount - 1);
+        m_arrays.push_back(array);
+        arrayIndex = (int)m_arrays.size() - 1;
+    }
+
+    TEXTURE_ARRAY& array = m_arrays[arrayIndex];
+    if (array.layerCount == array.layerCapacity)
+    {
+        ResizeArray(
+            array,
+            (array.layerCapacity > 0) ? (array.layerCapacity * 2) : INITIAL_LAYER_CAPACITY,
+            array.baseLevel);
+    }
+
+    location.arrayIndex = arrayIndex;
+    location.layer = array.layerCount;
+    array.layerCount++;
+
+    return(location);
+}
+
+/***********************************************************
+ *  UploadLevel()
+ *
+ *  This method is used for writing one mip level of a
+ *  texture.  The level is numbered from the full size, and
+ *  its size follows from the size of the array.  The pixels
+ *  are read with the current unpack settings.
+ ***********************************************************/
+void TextureArrays::UploadLevel(
+    const TEXTURE_LOCATION& location,
+    int level,
+    GLenum format,
+    const void* pixels)
+{
+    const TEXTURE_ARRAY& array = m_arrays[location.arrayIndex];
+    int width = array.width >> level;
+    int height = array.height >> level;
+
+    if ((level < array.baseLevel) || (level >= array.levelCount))
+    {
+        return;
+    }
+
+    GetGLStateCache().BindTexture(GL_TEXTURE_2D_ARRAY, array.texture);
+    glTexSubImage3D(
+        GL_TEXTURE_2D_ARRAY,
+        level - array.baseLevel,
+        0,
+        0,
+        location.layer,
+        (width > 0) ? width : 1,
+        (height > 0) ? height : 1,
+        1,
+        format,
+        GL_UNSIGNED_BYTE,
+        pixels);
+    GetGLStateCache().BindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+/***********************************************************
+ *  SetBaseLevel()
+ *
+ *  This method is used for changing the finest level that
+ *  an array keeps.  A finer base level must be written for
+ *  every layer with UploadLevel() before the array is drawn,
+ *  and a coarser one frees the storage of the dropped levels.
+ ***********************************************************/
+void TextureArrays::SetBaseLevel(int arrayIndex, int baseLevel)
+{
+    TEXTURE_ARRAY& array = m_arrays[arrayIndex];
+
+    if ((baseLevel < 0) || (baseLevel >= array.levelCount) || (baseLevel == array.baseLevel))
+    {
+        return;
+    }
+
+    ResizeArray(array, array.layerCapacity, baseLevel);
+}
+
+/***********************************************************
+ *  BindArray()
+ *
+ *  This method is used for binding an array to a texture
+ *  unit for the next draws.
+ ***********************************************************/
+void TextureArrays::BindArray(int arrayIndex, GLuint textureUnit) const
+{
+    GetGLStateCache().BindTexture(textureUnit, GL_TEXTURE_2D_ARRAY, m_arrays[arrayIndex].texture);
+}
+
+/***********************************************************
+ *  GetArrayCount()
+ *
+ *  This method returns the number of texture arrays.
+ ***********************************************************/
+int TextureArrays::GetArrayCount() const
+{
+    return((int)m_arrays.size());
+}
+
+/***********************************************************
+ *  GetArrayTexture()
+ *
+ *  This method returns the OpenGL texture of an array.
+ ***********************************************************/
+GLuint TextureArrays::GetArrayTexture(int arrayIndex) const
+{
+    return(m_arrays[arrayIndex].texture);
+}
+
+/***********************************************************
+ *  GetArrayWidth()
+ *
+ *  This method returns the full width of the textures of an
+ *  array, before any levels are dropped.
+ ***********************************************************/
+int TextureArrays::GetArrayWidth(int arrayIndex) const
+{
+    return(m_arrays[arrayIndex].width);
+}
+
+/***********************************************************
+ *  GetArrayHeight()
+ *
+ *  This method returns the full height of the textures of an
+ *  array, before any levels are dropped.
+ ***********************************************************/
+int TextureArrays::GetArrayHeight(int arrayIndex) const
+{
+    return(m_arrays[arrayIndex].height);
+}
+
+/***********************************************************
+ *  GetLevelCount()
+ *
+ *  This method returns the number of mip levels of the full
+ *  size textures of an array.
+ ***********************************************************/
+int TextureArrays::GetLevelCount(int arrayIndex) const
+{
+    return(m_arrays[arrayIndex].levelCount);
+}
+
+/***********************************************************
+ *  GetLayerCount()
+ *
+ *  This method returns the number of textures in an array.
+ ***********************************************************/
+int TextureArrays::GetLayerCount(int arrayIndex) const
+{
+    return(m_arrays[arrayIndex].layerCount);
+}
+
+/***********************************************************
+ *  GetBaseLevel()
+ *
+ *  This method returns the finest level kept by an array.
+ ***********************************************************/
+int TextureArrays::GetBaseLevel(int arrayIndex) const
+{
+    return(m_arrays[arrayIndex].baseLevel);
+}
+
+/***********************************************************
+ *  GetArrayBytes()
+ *
+ *  This method returns the bytes of storage allocated for an
+ *  array, including the layers not used yet.
+ ***********************************************************/
+size_t TextureArrays::GetArrayBytes(int arrayIndex) const
+{
+    return(GetLayerBytes(m_arrays[arrayIndex]) * m_arrays[arrayIndex].layerCapacity);
+}
+
+/***********************************************************
+ *  GetArrayLevelBytes()
+ *
+ *  This method returns the bytes that one level of an array
+ *  takes for all of its allocated layers.
+ ***********************************************************/
+size_t TextureArrays::GetArrayLevelBytes(int arrayIndex, int level) const
+{
+    const TEXTURE_ARRAY& array = m_arrays[arrayIndex];
+
+    return(GetLevelBytes(array.width, array.height, level, array.internalFormat) * array.layerCapacity);
+}
+
+/***********************************************************
+ *  GetTextureBytes()
+ *
+ *  This method returns the bytes of storage allocated for
+ *  all of the arrays.
+ ***********************************************************/
+size_t TextureArrays::GetTextureBytes() const
+{
+    size_t bytes = 0;
+
+    for (size_t i = 0; i < m_arrays.size(); i++)
+    {
+        bytes += GetArrayBytes((int)i);
+    }
+
+    return(bytes);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for deleting all of the arrays and
+ *  the textures in them.
+ ***********************************************************/
+void TextureArrays::Clear()
+{
+    for (size_t i = 0; i < m_arrays.size(); i++)
+    {
+        GetGLStateCache().DeleteTexture(m_arrays[i].texture);
+    }
+    m_arrays.clear();
+}
+
+/***********************************************************
+ *  GetFullLevelCount()
+ *
+ *  This method returns the number of mip levels from a size
+ *  down to 1 by 1.
+ ***********************************************************/
+int TextureArrays::GetFullLevelCount(int width, int height)
+{
+    int size = (width > height) ? width : height;
+    int levelCount = 1;
+
+    while (size > 1)
+    {
+        size /= 2;
+        levelCount++;
+    }
+
+    return(levelCount);
+}
+
+/***********************************************************
+ *  GetLevelBytes()
+ *
+ *  This method returns the bytes of one mip level of a
+ *  texture of a full size and format.
+ ***********************************************************/
+size_t TextureArrays::GetLevelBytes(int width, int height, int level, GLenum internalFormat)
+{
+    size_t pixelSize = (GL_RGB8 == internalFormat) ? 3 : 4;
+
+    width >>= level;
+    height >>= level;
+
+    return((size_t)((width > 0) ? width : 1) * ((height > 0) ? height : 1) * pixelSize);
+}
+
+/***********************************************************
+ *  ResizeArray()
+ *
+ *  This method is used for replacing the storage of an array
+ *  with storage for a number of layers from a base level.
+ *  The written layers are copied on the GPU into the new
+ *  storage with the mip levels that both storages keep, so
+ *  the pixels never go back to the CPU.
+ ***********************************************************/
+void TextureArrays::ResizeArray(TEXTURE_ARRAY& array, int layerCapacity, int baseLevel)
+{
+    GLuint texture = 0;
+    int baseWidth = array.width >> baseLevel;
+    int baseHeight = array.height >> baseLevel;
+
+    glGenTextures(1, &texture);
+    GetGLStateCache().BindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexStorage3D(
+        GL_TEXTURE_2D_ARRAY,
+        array.levelCount - baseLevel,
+        array.internalFormat,
+        (baseWidth > 0) ? baseWidth : 1,
+        (baseHeight > 0) ? baseHeight : 1,
+        layerCapacity);
+
+    // set the texture wrapping parameters
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    // set texture filtering parameters, the mip levels are
+    // sampled so a distant texture reads its smaller levels
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    GetGLStateCache().BindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    if ((0 != array.texture) && (array.layerCount > 0))
+    {
+        int firstLevel = (baseLevel > array.baseLevel) ? baseLevel : array.baseLevel;
+
+        for (int level = firstLevel; level < array.levelCount; level++)
+        {
+            int width = array.width >> level;
+            int height = array.height >> level;
+
+            glCopyImageSubData(
+                array.texture, GL_TEXTURE_2D_ARRAY, level - array.baseLevel, 0, 0, 0,
+                texture, GL_TEXTURE_2D_ARRAY, level - baseLevel, 0, 0, 0,
+                (width > 0) ? width : 1,
+                (height > 0) ? height : 1,
+                array.layerCount);
+        }
+    }
+
+    if (0 != array.texture)
+    {
+        GetGLStateCache().DeleteTexture(array.texture);
+    }
+    array.texture = texture;
+    array.layerCapacity = layerCapacity;
+    array.baseLevel = baseLevel;
+}
+
+/***********************************************************
+ *  GetLayerBytes()
+ *
+ *  This method returns the bytes of one layer of an array
+ *  with the mip levels it keeps.
+ ***********************************************************/
+size_t TextureArrays::GetLayerBytes(const TEXTURE_ARRAY& array)
+{
+    size_t bytes = 0;
+
+    for (int level = array.baseLevel; level < array.levelCount; level++)
+    {
+        bytes += GetLevelBytes(array.width, array.height, level, array.internalFormat);
+    }
+
+    return(bytes);
+}
@@ -0,0 +1,113 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturearrays.h
+// ============
+// store the scene textures as layers of shared texture arrays
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <vector>
+
+/***********************************************************
+ *  TextureArrays
+ *
+ *  This class keeps every scene texture as one layer of a
+ *  2D texture array, and the textures with the same size,
+ *  format and number of mip levels share one array.  A draw
+ *  selects its texture by the layer in its instance data, so
+ *  all of the objects textured from one array are drawn
+ *  without changing any texture binding or sampler uniform,
+ *  and the number of textures is not limited by the texture
+ *  units.  An array grows on the GPU when it runs out of
+ *  layers.
+ *
+ *  The storage of an array can start below the full size.
+ *  Its base level is the finest mip level that is kept, and
+ *  the shader samples the kept levels as a smaller texture,
+ *  so the residency of the finer levels can change without
+ *  the draws knowing.
+ ***********************************************************/
+class TextureArrays
+{
+public:
+    // constructor
+    TextureArrays();
+    // destructor
+    ~TextureArrays();
+
+    // array and layer that hold one texture
+    struct TEXTURE_LOCATION
+    {
+        int arrayIndex;
+        int layer;
+    };
+
+    // reserve a layer for a texture of a size and format, a new
+    // array keeps the levels from the passed in base level
+    TEXTURE_LOCATION AddTexture(
+        int width,
+        int height,
+        int levelCount,
+        GLenum internalFormat,
+        int baseLevel = 0);
+    // write one mip level of a texture, levels finer than the
+    // base level of the array are not kept and are skipped
+    void UploadLevel(
+        const TEXTURE_LOCATION& location,
+        int level,
+        GLenum format,
+        const void* pixels);
+    // keep the levels of an array from another base level, the
+    // levels both storages keep are copied on the GPU
+    void SetBaseLevel(int arrayIndex, int baseLevel);
+
+    // bind an array to a texture unit
+    void BindArray(int arrayIndex, GLuint textureUnit) const;
+    // number of arrays and their OpenGL textures
+    int GetArrayCount() const;
+    GLuint GetArrayTexture(int arrayIndex) const;
+    // full size and levels of the textures in an array
+    int GetArrayWidth(int arrayIndex) const;
+    int GetArrayHeight(int arrayIndex) const;
+    int GetLevelCount(int arrayIndex) const;
+    int GetLayerCount(int arrayIndex) const;
+    int GetBaseLevel(int arrayIndex) const;
+    // bytes of the kept levels of the allocated layers
+    size_t GetArrayBytes(int arrayIndex) const;
+    // bytes of one level of the allocated layers of an array
+    size_t GetArrayLevelBytes(int arrayIndex, int level) const;
+    size_t GetTextureBytes() const;
+    // delete all of the arrays
+    void Clear();
+
+    // number of mip levels of a full chain for a size
+    static int GetFullLevelCount(int width, int height);
+    // bytes of one mip level of a texture
+    static size_t GetLevelBytes(int width, int height, int level, GLenum internalFormat);
+
+private:
+    // one texture array and the format of its layers
+    struct TEXTURE_ARRAY
+    {
+        GLuint texture;
+        int width;
+        int height;
+        int levelCount;
+        GLenum internalFormat;
+        int layerCount;
+        int layerCapacity;
+        // finest level kept in the storage
+        int baseLevel;
+    };
+
+    std::vector<TEXTURE_ARRAY> m_arrays;
+
+    // allocate the storage of an array for a number of layers
+    // from a base level and copy the existing layers into it
+    void ResizeArray(TEXTURE_ARRAY& array, int layerCapacity, int baseLevel);
+    // bytes of one layer with its kept mip levels
+    static size_t GetLayerBytes(const TEXTURE_ARRAY& array);
+};
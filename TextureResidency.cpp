@@ -0,0 +1,320 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureresidency.cpp
+// ============
+// stream the mip levels of the scene textures under a memory budget
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureResidency.h"
+
+// declaration of the global variables and defines
+namespace
+{
+    // largest side of the finest level a new array keeps
+    const int STREAM_START_SIZE = 64;
+    // bytes of texture levels kept before levels are dropped
+    const size_t DEFAULT_TEXTURE_BUDGET = 64 * 1024 * 1024;
+    // bytes streamed in during one frame, at least one level
+    // is streamed in a frame when any level is requested
+    const size_t MAX_UPLOAD_BYTES_PER_FRAME = 4 * 1024 * 1024;
+}
+
+/***********************************************************
+ *  TextureResidency()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureResidency::TextureResidency(TextureArrays* pTextureArrays)
+{
+    m_pTextureArrays = pTextureArrays;
+    m_stats.residentBytes = 0;
+    m_stats.budgetBytes = DEFAULT_TEXTURE_BUDGET;
+    m_stats.pendingUploads = 0;
+    m_stats.uploadedLevels = 0;
+    m_stats.evictedLevels = 0;
+}
+
+/***********************************************************
+ *  GetStartLevel()
+ *
+ *  This method returns the finest level a new array keeps,
+ *  the first level that is not larger than the start size.
+ ***********************************************************/
+int TextureResidency::GetStartLevel(int width, int height)
+{
+    int size = (width > height) ? width : height;
+    int level = 0;
+
+    while (size > STREAM_START_SIZE)
+    {
+        size /= 2;
+        level++;
+    }
+
+    return(level);
+}
+
+/***********************************************************
+ *  SetBudget()
+ *
+ *  This method is used for setting how many bytes of texture
+ *  levels are kept in video memory.  The levels over the
+ *  budget are dropped by the next update.
+ ***********************************************************/
+void TextureResidency::SetBudget(size_t bytes)
+{
+    m_stats.budgetBytes = bytes;
+}
+
+/***********************************************************
+ *  AddTexture()
+ *
+ *  This method is used for keeping the mip chain of a texture
+ *  that the finer levels are streamed from.  The levels follow
+ *  each other from the full size down, with unpadded rows, and
+ *  are used in place, like the levels of the mapped pack.
+ ***********************************************************/
+void TextureResidency::AddTexture(
+    const TextureArrays::TEXTURE_LOCATION& location,
+    const unsigned char* levels,
+    GLenum format)
+{
+    ARRAY_STATE& state = GetArrayState(location.arrayIndex);
+
+    if ((int)state.layers.size() <= location.layer)
+    {
+        state.layers.resize(location.layer + 1);
+    }
+
+    LAYER_SOURCE& source = state.layers[location.layer];
+    source.levels = levels;
+    source.ownedLevels.clear();
+    source.format = format;
+}
+
+/***********************************************************
+ *  AddTexture()
+ *
+ *  This method is used for keeping the mip chain of a texture
+ *  that was decoded at load time.  The data is taken over and
+ *  the passed in vector is left empty.
+ ***********************************************************/
+void TextureResidency::AddTexture(
+    const TextureArrays::TEXTURE_LOCATION& location,
+    std::vector<unsigned char>& levels,
+    GLenum format)
+{
+    ARRAY_STATE& state = GetArrayState(location.arrayIndex);
+
+    if ((int)state.layers.size() <= location.layer)
+    {
+        state.layers.resize(location.layer + 1);
+    }
+
+    LAYER_SOURCE& source = state.layers[location.layer];
+    source.levels = NULL;
+    source.ownedLevels.swap(levels);
+    source.format = format;
+    levels.clear();
+}
+
+/***********************************************************
+ *  RequestLevel()
+ *
+ *  This method is used for requesting the level that an array
+ *  is sampled at by a visible object.  The finest request of
+ *  the frame is kept, and the array counts as drawn.
+ ***********************************************************/
+void TextureResidency::RequestLevel(int arrayIndex, int level, uint64_t frameNumber)
+{
+    ARRAY_STATE& state = GetArrayState(arrayIndex);
+    int coarsestLevel = m_pTextureArrays->GetLevelCount(arrayIndex) - 1;
+
+    level = (level < 0) ? 0 : ((level > coarsestLevel) ? coarsestLevel : level);
+    if ((state.lastUsedFrame != frameNumber) || (level < state.requestedLevel))
+    {
+        state.requestedLevel = level;
+    }
+    state.lastUsedFrame = frameNumber;
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for dropping levels while the kept
+ *  levels are over the budget, and then streaming in one
+ *  finer level for every array drawn this frame that needs
+ *  one, until the upload limit of the frame is reached.
+ ***********************************************************/
+void TextureResidency::Update(uint64_t frameNumber)
+{
+    size_t uploadedBytes = 0;
+
+    m_stats.residentBytes = m_pTextureArrays->GetTextureBytes();
+    m_stats.pendingUploads = 0;
+
+    while ((m_stats.residentBytes > m_stats.budgetBytes) && EvictLevel(frameNumber))
+    {
+    }
+
+    for (size_t i = 0; i < m_arrays.size(); i++)
+    {
+        const ARRAY_STATE& state = m_arrays[i];
+        int baseLevel = m_pTextureArrays->GetBaseLevel((int)i);
+
+        if ((state.lastUsedFrame != frameNumber) || (state.requestedLevel >= baseLevel))
+        {
+            continue;
+        }
+
+        size_t growth = m_pTextureArrays->GetArrayLevelBytes((int)i, baseLevel - 1);
+        bool bStream = (uploadedBytes == 0) || (uploadedBytes + growth <= MAX_UPLOAD_BYTES_PER_FRAME);
+
+        // make room by dropping the levels of arrays that were
+        // not drawn, never the levels drawn this frame
+        while (bStream && (m_stats.residentBytes + growth > m_stats.budgetBytes) && EvictLevel(frameNumber))
+        {
+        }
+
+        if (bStream && (m_stats.residentBytes + growth <= m_stats.budgetBytes))
+        {
+            StreamLevel((int)i);
+            uploadedBytes += growth;
+            m_stats.residentBytes = m_pTextureArrays->GetTextureBytes();
+            m_stats.uploadedLevels++;
+            baseLevel--;
+        }
+
+        m_stats.pendingUploads += (uint32_t)(baseLevel - state.requestedLevel);
+    }
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for forgetting the mip chains of all
+ *  of the textures, when their arrays are deleted.
+ ***********************************************************/
+void TextureResidency::Clear()
+{
+    m_arrays.clear();
+    m_stats.residentBytes = 0;
+    m_stats.pendingUploads = 0;
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method returns the counters of the last update.
+ ***********************************************************/
+const TextureResidency::RESIDENCY_STATS& TextureResidency::GetStats() const
+{
+    return(m_stats);
+}
+
+/***********************************************************
+ *  GetArrayState()
+ *
+ *  This method is used for finding the residency state of an
+ *  array.  The arrays are numbered in the order they were
+ *  created, so new states are added at the end.
+ ***********************************************************/
+TextureResidency::ARRAY_STATE& TextureResidency::GetArrayState(int arrayIndex)
+{
+    while ((int)m_arrays.size() <= arrayIndex)
+    {
+        ARRAY_STATE state;
+
+        state.requestedLevel = 0;
+        state.lastUsedFrame = 0;
+        m_arrays.push_back(state);
+    }
+
+    return(m_arrays[arrayIndex]);
+}
+
+/***********************************************************
+ *  StreamLevel()
+ *
+ *  This method is used for keeping the next finer level of
+ *  an array and writing that level of every layer from its
+ *  mip chain in system memory.
+ ***********************************************************/
+void TextureResidency::StreamLevel(int arrayIndex)
+{
+    const ARRAY_STATE& state = m_arrays[arrayIndex];
+    int level = m_pTextureArrays->GetBaseLevel(arrayIndex) - 1;
+    int width = m_pTextureArrays->GetArrayWidth(arrayIndex);
+    int height = m_pTextureArrays->GetArrayHeight(arrayIndex);
+
+    m_pTextureArrays->SetBaseLevel(arrayIndex, level);
+
+    // the rows of the levels are not padded
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (size_t layer = 0; layer < state.layers.size(); layer++)
+    {
+        const LAYER_SOURCE& source = state.layers[layer];
+        const unsigned char* pLevel = (NULL != source.levels) ? source.levels : source.ownedLevels.data();
+        GLenum internalFormat = (GL_RGB == source.format) ? GL_RGB8 : GL_RGBA8;
+        TextureArrays::TEXTURE_LOCATION location;
+
+        if (NULL == pLevel)
+        {
+            continue;
+        }
+
+        // the finer levels come first in the chain
+        for (int finer = 0; finer < level; finer++)
+        {
+            pLevel += TextureArrays::GetLevelBytes(width, height, finer, internalFormat);
+        }
+
+        location.arrayIndex = arrayIndex;
+        location.layer = (int)layer;
+        m_pTextureArrays->UploadLevel(location, level, source.format, pLevel);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+/***********************************************************
+ *  EvictLevel()
+ *
+ *  This method is used for dropping the finest level of the
+ *  array that was drawn the longest time ago.  An array is
+ *  never dropped below its start level or while it is drawn
+ *  in the current frame.  Returns false when no level can be
+ *  dropped.
+ ***********************************************************/
+bool TextureResidency::EvictLevel(uint64_t frameNumber)
+{
+    int evictArray = -1;
+
+    for (size_t i = 0; i < m_arrays.size(); i++)
+    {
+        int startLevel = GetStartLevel(
+            m_pTextureArrays->GetArrayWidth((int)i),
+            m_pTextureArrays->GetArrayHeight((int)i));
+
+        if ((m_arrays[i].lastUsedFrame == frameNumber) ||
+            (m_pTextureArrays->GetBaseLevel((int)i) >= startLevel))
+        {
+            continue;
+        }
+
+        if ((evictArray < 0) || (m_arrays[i].lastUsedFrame < m_arrays[evictArray].lastUsedFrame))
+        {
+            evictArray = (int)i;
+        }
+    }
+
+    if (evictArray < 0)
+    {
+        return(false);
+    }
+
+    m_pTextureArrays->SetBaseLevel(evictArray, m_pTextureArrays->GetBaseLevel(evictArray) + 1);
+    m_stats.residentBytes = m_pTextureArrays->GetTextureBytes();
+    m_stats.evictedLevels++;
+
+    return(true);
+}
@@ -0,0 +1,104 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureresidency.h
+// ============
+// stream the mip levels of the scene textures under a memory budget
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TextureArrays.h"
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  TextureResidency
+ *
+ *  This class decides which mip levels of the texture arrays
+ *  are kept in video memory.  The whole mip chain of every
+ *  texture stays in system memory, either in the mapped asset
+ *  pack or in a decoded copy, and a new array only keeps its
+ *  small levels.  Every frame the visible objects request the
+ *  level that matches their size on the screen, and the finer
+ *  levels are streamed in one level at a time, with a limit
+ *  on the bytes uploaded in one frame.
+ *
+ *  When the kept levels are over the memory budget, the
+ *  finest level of the array that was drawn the longest time
+ *  ago is dropped.  The arrays drawn in the current frame are
+ *  never dropped, so the budget can be exceeded by what is on
+ *  screen, and a level is only streamed in when it fits.
+ ***********************************************************/
+class TextureResidency
+{
+public:
+    // constructor
+    TextureResidency(TextureArrays* pTextureArrays);
+
+    // counters for tuning the budget
+    struct RESIDENCY_STATS
+    {
+        // bytes of the kept levels of all of the arrays
+        size_t residentBytes;
+        size_t budgetBytes;
+        // levels requested by the visible objects and not kept yet
+        uint32_t pendingUploads;
+        // levels streamed in and dropped since the start
+        uint64_t uploadedLevels;
+        uint64_t evictedLevels;
+    };
+
+    // finest level that a new array keeps for a full size
+    static int GetStartLevel(int width, int height);
+
+    // set the bytes of texture levels kept in video memory
+    void SetBudget(size_t bytes);
+    // keep the mip chain of a texture to stream its levels from,
+    // the data is used in place and must stay valid
+    void AddTexture(const TextureArrays::TEXTURE_LOCATION& location, const unsigned char* levels, GLenum format);
+    // keep the mip chain of a texture, taking over the data
+    void AddTexture(const TextureArrays::TEXTURE_LOCATION& location, std::vector<unsigned char>& levels, GLenum format);
+    // request the finest level an array is sampled at this frame
+    void RequestLevel(int arrayIndex, int level, uint64_t frameNumber);
+    // stream in and drop levels for the requests of this frame
+    void Update(uint64_t frameNumber);
+    // forget the mip chains of all of the textures
+    void Clear();
+
+    // counters of the last update
+    const RESIDENCY_STATS& GetStats() const;
+
+private:
+    // mip chain of one texture in system memory
+    struct LAYER_SOURCE
+    {
+        // levels used in place, NULL when the levels are owned
+        const unsigned char* levels;
+        std::vector<unsigned char> ownedLevels;
+        GLenum format;
+    };
+
+    // residency state of one texture array
+    struct ARRAY_STATE
+    {
+        // sources of the layers, indexed by layer
+        std::vector<LAYER_SOURCE> layers;
+        // finest level requested in the last frame it was drawn
+        int requestedLevel;
+        uint64_t lastUsedFrame;
+    };
+
+    TextureArrays* m_pTextureArrays;
+    std::vector<ARRAY_STATE> m_arrays;
+    RESIDENCY_STATS m_stats;
+
+    // find the state of an array, adding it when it is new
+    ARRAY_STATE& GetArrayState(int arrayIndex);
+    // keep the next finer level of every layer of an array
+    void StreamLevel(int arrayIndex);
+    // drop the finest level of the least recently drawn array
+    bool EvictLevel(uint64_t frameNumber);
+};
@@ -0,0 +1,382 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformarrays.cpp
+// ============
+// object transforms stored as arrays and composed in batches
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TransformArrays.h"
+
+#include <cmath>
+#include <cstdint>
+
+// SSE2 is part of every x64 target, 32-bit targets need it enabled
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define TRANSFORM_ARRAYS_SSE2
+#include <emmintrin.h>
+#endif
+
+// declaration of the global variables and defines
+namespace
+{
+    const float DEGREES_TO_RADIANS = 0.0174532925199f;
+
+    // sine and cosine of the Cephes library - the angle is
+    // reduced to an octant, split in three parts so the
+    // reduction stays exact, and the two polynomials are
+    // evaluated on the remainder
+    const float FOUR_OVER_PI = 1.27323954473516f;
+    const float REDUCE_1 = -0.78515625f;
+    const float REDUCE_2 = -2.4187564849853515625e-4f;
+    const float REDUCE_3 = -3.77489497744594108e-8f;
+    const float SIN_P0 = -1.9515295891e-4f;
+    const float SIN_P1 = 8.3321608736e-3f;
+    const float SIN_P2 = -1.6666654611e-1f;
+    const float COS_P0 = 2.443315711809948e-5f;
+    const float COS_P1 = -1.388731625493765e-3f;
+    const float COS_P2 = 4.166664568298827e-2f;
+
+    /***********************************************************
+     *  SinCos()
+     *
+     *  This function computes the sine and cosine of an angle in
+     *  radians.  SinCos4() below is the same function for four
+     *  angles, and every operation here has its match there.
+     ***********************************************************/
+    void SinCos(float angle, float& sine, float& cosine)
+    {
+        bool bSineNegative = std::signbit(angle);
+        float x = std::fabs(angle);
+
+        // round the octant up to an even number
+        int32_t octant = (int32_t)(x * FOUR_OVER_PI);
+        octant = (octant + 1) & ~1;
+        float y = (float)octant;
+
+        bool bSwapSign = ((octant & 4) != 0);
+        bool bUseCosinePolynomial = ((octant & 2) != 0);
+        bool bCosineNegative = ((~(octant - 2) & 4) != 0);
+
+        x = x + y * REDUCE_1;
+        x = x + y * REDUCE_2;
+        x = x + y * REDUCE_3;
+
+        float z = x * x;
+
+        float cosinePolynomial = COS_P0;
+        cosinePolynomial = cosinePolynomial * z + COS_P1;
+        cosinePolynomial = cosinePolynomial * z + COS_P2;
+        cosinePolynomial = cosinePolynomial * z * z;
+        cosinePolynomial = cosinePolynomial - z * 0.5f;
+        cosinePolynomial = cosinePolynomial + 1.0f;
+
+        float sinePolynomial = SIN_P0;
+        sinePolynomial = sinePolynomial * z + SIN_P1;
+        sinePolynomial = sinePolynomial * z + SIN_P2;
+        sinePolynomial = sinePolynomial * z * x;
+        sinePolynomial = sinePolynomial + x;
+
+        sine = bUseCosinePolynomial ? cosinePolynomial : sinePolynomial;
+        cosine = bUseCosinePolynomial ? sinePolynomial : cosinePolynomial;
+
+        if (bSineNegative != bSwapSign)
+        {
+            sine = -sine;
+        }
+        if (bCosineNegative)
+        {
+            cosine = -cosine;
+        }
+    }
+
+#ifdef TRANSFORM_ARRAYS_SSE2
+    /***********************************************************
+     *  SinCos4()
+     *
+     *  This function computes the sine and cosine of four angles
+     *  in radians, with the same steps as SinCos().
+     ***********************************************************/
+    void SinCos4(__m128 angle, __m128& sine, __m128& cosine)
+    {
+        const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+
+        __m128 sineSign = _mm_and_ps(angle, signMask);
+        __m128 x = _mm_andnot_ps(signMask, angle);
+
+        __m128i octant = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(FOUR_OVER_PI)));
+        octant = _mm_and_si128(_mm_add_epi32(octant, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+        __m128 y = _mm_cvtepi32_ps(octant);
+
+        __m128 swapSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(octant, _mm_set1_epi32(4)), 29));
+        __m128 useSinePolynomial = _mm_castsi128_ps(
+            _mm_cmpeq_epi32(_mm_and_si128(octant, _mm_set1_epi32(2)), _mm_setzero_si128()));
+        __m128 cosineSign = _mm_castsi128_ps(
+            _mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(octant, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+
+        x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(REDUCE_1)));
+        x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(REDUCE_2)));
+        x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(REDUCE_3)));
+
+        __m128 z = _mm_mul_ps(x, x);
+
+        __m128 cosinePolynomial = _mm_set1_ps(COS_P0);
+        cosinePolynomial = _mm_add_ps(_mm_mul_ps(cosinePolynomial, z), _mm_set1_ps(COS_P1));
+        cosinePolynomial = _mm_add_ps(_mm_mul_ps(cosinePolynomial, z), _mm_set1_ps(COS_P2));
+        cosinePolynomial = _mm_mul_ps(_mm_mul_ps(cosinePolynomial, z), z);
+        cosinePolynomial = _mm_sub_ps(cosinePolynomial, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+        cosinePolynomial = _mm_add_ps(cosinePolynomial, _mm_set1_ps(1.0f));
+
+        __m128 sinePolynomial = _mm_set1_ps(SIN_P0);
+        sinePolynomial = _mm_add_ps(_mm_mul_ps(sinePolynomial, z), _mm_set1_ps(SIN_P1));
+        sinePolynomial = _mm_add_ps(_mm_mul_ps(sinePolynomial, z), _mm_set1_ps(SIN_P2));
+        sinePolynomial = _mm_mul_ps(_mm_mul_ps(sinePolynomial, z), x);
+        sinePolynomial = _mm_add_ps(sinePolynomial, x);
+
+        sine = _mm_or_ps(
+            _mm_and_ps(useSinePolynomial, sinePolynomial),
+            _mm_andnot_ps(useSinePolynomial, cosinePolynomial));
+        cosine = _mm_or_ps(
+            _mm_and_ps(useSinePolynomial, cosinePolynomial),
+            _mm_andnot_ps(useSinePolynomial, sinePolynomial));
+
+        sine = _mm_xor_ps(sine, _mm_xor_ps(sineSign, swapSign));
+        cosine = _mm_xor_ps(cosine, cosineSign);
+    }
+#endif
+}
+
+/***********************************************************
+ *  TransformArrays()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TransformArrays::TransformArrays()
+{
+}
+
+/***********************************************************
+ *  Add()
+ *
+ *  This method is used for adding the transform of an object
+ *  and returns the index of the transform.
+ ***********************************************************/
+int TransformArrays::Add(glm::vec3 scaleXYZ, glm::vec3 rotationDegrees, glm::vec3 positionXYZ)
+{
+    m_scaleX.push_back(scaleXYZ.x);
+    m_scaleY.push_back(scaleXYZ.y);
+    m_scaleZ.push_back(scaleXYZ.z);
+    m_rotationX.push_back(rotationDegrees.x);
+    m_rotationY.push_back(rotationDegrees.y);
+    m_rotationZ.push_back(rotationDegrees.z);
+    m_positionX.push_back(positionXYZ.x);
+    m_positionY.push_back(positionXYZ.y);
+    m_positionZ.push_back(positionXYZ.z);
+
+    return((int)m_positionX.size() - 1);
+}
+
+/***********************************************************
+ *  Set()
+ *
+ *  This method is used for changing the transform of an object.
+ ***********************************************************/
+void TransformArrays::Set(int index, glm::vec3 scaleXYZ, glm::vec3 rotationDegrees, glm::vec3 positionXYZ)
+{
+    m_scaleX[index] = scaleXYZ.x;
+    m_scaleY[index] = scaleXYZ.y;
+    m_scaleZ[index] = scaleXYZ.z;
+    m_rotationX[index] = rotationDegrees.x;
+    m_rotationY[index] = rotationDegrees.y;
+    m_rotationZ[index] = rotationDegrees.z;
+    m_positionX[index] = positionXYZ.x;
+    m_positionY[index] = positionXYZ.y;
+    m_positionZ[index] = positionXYZ.z;
+}
+
+/***********************************************************
+ *  Reserve()
+ *
+ *  This method is used for making room for a number of
+ *  transforms, so adding that many does not reallocate.
+ ***********************************************************/
+void TransformArrays::Reserve(size_t count)
+{
+    m_scaleX.reserve(count);
+    m_scaleY.reserve(count);
+    m_scaleZ.reserve(count);
+    m_rotationX.reserve(count);
+    m_rotationY.reserve(count);
+    m_rotationZ.reserve(count);
+    m_positionX.reserve(count);
+    m_positionY.reserve(count);
+    m_positionZ.reserve(count);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the transforms.
+ ***********************************************************/
+void TransformArrays::Clear()
+{
+    m_scaleX.clear();
+    m_scaleY.clear();
+    m_scaleZ.clear();
+    m_rotationX.clear();
+    m_rotationY.clear();
+    m_rotationZ.clear();
+    m_positionX.clear();
+    m_positionY.clear();
+    m_positionZ.clear();
+}
+
+/***********************************************************
+ *  GetCount()
+ *
+ *  This method returns the number of transforms.
+ ***********************************************************/
+size_t TransformArrays::GetCount() const
+{
+    return(m_positionX.size());
+}
+
+/***********************************************************
+ *  ComputeRangeScalar()
+ *
+ *  This method is used for composing the model matrices of a
+ *  range of the objects, one object at a time.  The matrix is
+ *  translation * rotationX * rotationY * rotationZ * scale,
+ *  written out so each element is a few products of the
+ *  sines and cosines.
+ ***********************************************************/
+void TransformArrays::ComputeRangeScalar(size_t first, size_t count, glm::mat4* models) const
+{
+    for (size_t i = first; i < first + count; i++)
+    {
+        float sinX, cosX, sinY, cosY, sinZ, cosZ;
+
+        SinCos(m_rotationX[i] * DEGREES_TO_RADIANS, sinX, cosX);
+        SinCos(m_rotationY[i] * DEGREES_TO_RADIANS, sinY, cosY);
+        SinCos(m_rotationZ[i] * DEGREES_TO_RADIANS, sinZ, cosZ);
+
+        float sinXsinY = sinX * sinY;
+        float cosXsinY = cosX * sinY;
+        glm::mat4& model = models[i];
+
+        model[0][0] = (cosY * cosZ) * m_scaleX[i];
+        model[0][1] = (cosX * sinZ + sinXsinY * cosZ) * m_scaleX[i];
+        model[0][2] = (sinX * sinZ - cosXsinY * cosZ) * m_scaleX[i];
+        model[0][3] = 0.0f;
+
+        model[1][0] = -(cosY * sinZ) * m_scaleY[i];
+        model[1][1] = (cosX * cosZ - sinXsinY * sinZ) * m_scaleY[i];
+        model[1][2] = (sinX * cosZ + cosXsinY * sinZ) * m_scaleY[i];
+        model[1][3] = 0.0f;
+
+        model[2][0] = sinY * m_scaleZ[i];
+        model[2][1] = -(sinX * cosY) * m_scaleZ[i];
+        model[2][2] = (cosX * cosY) * m_scaleZ[i];
+        model[2][3] = 0.0f;
+
+        model[3][0] = m_positionX[i];
+        model[3][1] = m_positionY[i];
+        model[3][2] = m_positionZ[i];
+        model[3][3] = 1.0f;
+    }
+}
+
+/***********************************************************
+ *  ComputeModelMatricesScalar()
+ *
+ *  This method is used for composing the model matrices of
+ *  all of the objects without SIMD instructions.
+ ***********************************************************/
+void TransformArrays::ComputeModelMatricesScalar(glm::mat4* models) const
+{
+    ComputeRangeScalar(0, GetCount(), models);
+}
+
+/***********************************************************
+ *  ComputeModelMatrices()
+ *
+ *  This method is used for composing the model matrices of
+ *  all of the objects.
+ ***********************************************************/
+void TransformArrays::ComputeModelMatrices(glm::mat4* models) const
+{
+    ComputeModelMatrices(0, GetCount(), models);
+}
+
+/***********************************************************
+ *  ComputeModelMatrices()
+ *
+ *  This method is used for composing the model matrices of a
+ *  range of the objects, so the ranges can be composed on
+ *  different threads.  With SSE2 four objects are composed
+ *  at a time, each register holding one matrix element of
+ *  the four objects, and the elements are transposed into
+ *  matrix columns when they are stored.
+ ***********************************************************/
+void TransformArrays::ComputeModelMatrices(size_t first, size_t count, glm::mat4* models) const
+{
+    size_t end = first + count;
+
+#ifdef TRANSFORM_ARRAYS_SSE2
+    const __m128 degreesToRadians = _mm_set1_ps(DEGREES_TO_RADIANS);
+    const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    for (; first + 4 <= end; first += 4)
+    {
+        __m128 sinX, cosX, sinY, cosY, sinZ, cosZ;
+
+        SinCos4(_mm_mul_ps(_mm_loadu_ps(&m_rotationX[first]), degreesToRadians), sinX, cosX);
+        SinCos4(_mm_mul_ps(_mm_loadu_ps(&m_rotationY[first]), degreesToRadians), sinY, cosY);
+        SinCos4(_mm_mul_ps(_mm_loadu_ps(&m_rotationZ[first]), degreesToRadians), sinZ, cosZ);
+
+        __m128 scaleX = _mm_loadu_ps(&m_scaleX[first]);
+        __m128 scaleY = _mm_loadu_ps(&m_scaleY[first]);
+        __m128 scaleZ = _mm_loadu_ps(&m_scaleZ[first]);
+        __m128 sinXsinY = _mm_mul_ps(sinX, sinY);
+        __m128 cosXsinY = _mm_mul_ps(cosX, sinY);
+
+        // the three rotation and scale columns, and the
+        // translation column, for the four objects
+        __m128 column[4][4];
+
+        column[0][0] = _mm_mul_ps(_mm_mul_ps(cosY, cosZ), scaleX);
+        column[0][1] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(cosX, sinZ), _mm_mul_ps(sinXsinY, cosZ)), scaleX);
+        column[0][2] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(sinX, sinZ), _mm_mul_ps(cosXsinY, cosZ)), scaleX);
+        column[0][3] = zero;
+
+        column[1][0] = _mm_mul_ps(_mm_xor_ps(_mm_mul_ps(cosY, sinZ), signMask), scaleY);
+        column[1][1] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(cosX, cosZ), _mm_mul_ps(sinXsinY, sinZ)), scaleY);
+        column[1][2] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(sinX, cosZ), _mm_mul_ps(cosXsinY, sinZ)), scaleY);
+        column[1][3] = zero;
+
+        column[2][0] = _mm_mul_ps(sinY, scaleZ);
+        column[2][1] = _mm_mul_ps(_mm_xor_ps(_mm_mul_ps(sinX, cosY), signMask), scaleZ);
+        column[2][2] = _mm_mul_ps(_mm_mul_ps(cosX, cosY), scaleZ);
+        column[2][3] = zero;
+
+        column[3][0] = _mm_loadu_ps(&m_positionX[first]);
+        column[3][1] = _mm_loadu_ps(&m_positionY[first]);
+        column[3][2] = _mm_loadu_ps(&m_positionZ[first]);
+        column[3][3] = one;
+
+        for (int c = 0; c < 4; c++)
+        {
+            // after the transpose register k holds column c of object k
+            _MM_TRANSPOSE4_PS(column[c][0], column[c][1], column[c][2], column[c][3]);
+            for (int k = 0; k < 4; k++)
+            {
+                _mm_storeu_ps(&models[first + k][c][0], column[c][k]);
+            }
+        }
+    }
+#endif
+
+    // the objects left over, or all of them without SSE2
+    ComputeRangeScalar(first, end - first, models);
+}
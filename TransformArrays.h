@@ -0,0 +1,64 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformarrays.h
+// ============
+// object transforms stored as arrays and composed in batches
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  TransformArrays
+ *
+ *  This class keeps the scale, rotation and position of many
+ *  objects with one array for each component, so the model
+ *  matrices can be composed four objects at a time with SSE.
+ *  The matrices are written in closed form - the product of
+ *  the translation, the X, Y and Z rotations and the scale -
+ *  instead of multiplying five matrices.  The scalar path
+ *  makes the same operations in the same order, so both paths
+ *  give identical results.
+ ***********************************************************/
+class TransformArrays
+{
+public:
+    // constructor
+    TransformArrays();
+
+    // add the transform of an object and return its index
+    int Add(glm::vec3 scaleXYZ, glm::vec3 rotationDegrees, glm::vec3 positionXYZ);
+    // change the transform of an object
+    void Set(int index, glm::vec3 scaleXYZ, glm::vec3 rotationDegrees, glm::vec3 positionXYZ);
+    // make room for a number of transforms
+    void Reserve(size_t count);
+    // remove all of the transforms
+    void Clear();
+    // number of transforms
+    size_t GetCount() const;
+
+    // compose the model matrices of all of the objects
+    void ComputeModelMatrices(glm::mat4* models) const;
+    // compose the model matrices of a range of the objects
+    void ComputeModelMatrices(size_t first, size_t count, glm::mat4* models) const;
+    // compose the model matrices without SIMD instructions
+    void ComputeModelMatricesScalar(glm::mat4* models) const;
+
+private:
+    std::vector<float> m_scaleX;
+    std::vector<float> m_scaleY;
+    std::vector<float> m_scaleZ;
+    // rotations in degrees
+    std::vector<float> m_rotationX;
+    std::vector<float> m_rotationY;
+    std::vector<float> m_rotationZ;
+    std::vector<float> m_positionX;
+    std::vector<float> m_positionY;
+    std::vector<float> m_positionZ;
+
+    // compose the model matrices of a range of the objects
+    void ComputeRangeScalar(size_t first, size_t count, glm::mat4* models) const;
+};
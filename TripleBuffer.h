@@ -0,0 +1,87 @@
+///////////////////////////////////////////////////////////////////////////////
+// triplebuffer.h
+// ============
+// lock-free hand over of the newest value from one thread to another
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+
+/***********************************************************
+ *  TripleBuffer
+ *
+ *  This template passes values from one writing thread to
+ *  one reading thread without locks.  There are three slots -
+ *  the writer fills the back slot, the reader uses the front
+ *  slot, and the slot in the middle holds the newest value
+ *  that was published.  Publishing and taking a value are
+ *  each one atomic exchange with the middle slot, so neither
+ *  thread ever waits for the other, and a value is never
+ *  changed while the reader uses it.  The reader always takes
+ *  the newest value, and a value it did not take in time is
+ *  written over.
+ ***********************************************************/
+template<typename T>
+class TripleBuffer
+{
+public:
+    // constructor
+    TripleBuffer()
+        : m_back(0), m_middle(1), m_front(2)
+    {
+    }
+
+    // slot the writer fills before publishing it
+    T& GetBack()
+    {
+        return(m_slots[m_back]);
+    }
+
+    // hand the back slot over to the reader, and take the
+    // middle slot as the next back slot
+    void Publish()
+    {
+        m_back = m_middle.exchange(m_back | NEW_VALUE) & SLOT_MASK;
+    }
+
+    // the writer published a value the reader has not taken
+    bool HasNewValue() const
+    {
+        return((m_middle.load() & NEW_VALUE) != 0);
+    }
+
+    // take the newest published value as the front slot,
+    // returns false when there is no new value
+    bool TakeNewValue()
+    {
+        if (HasNewValue() == false)
+        {
+            return(false);
+        }
+
+        m_front = m_middle.exchange(m_front) & SLOT_MASK;
+        return(true);
+    }
+
+    // slot the reader uses, which the writer never changes
+    const T& GetFront() const
+    {
+        return(m_slots[m_front]);
+    }
+
+private:
+    // the slot index is in the low bits of the middle slot,
+    // with a flag that is set while its value is new
+    static const unsigned int SLOT_MASK = 3;
+    static const unsigned int NEW_VALUE = 4;
+
+    T m_slots[3];
+    // only used by the writer
+    unsigned int m_back;
+    // exchanged by both threads
+    std::atomic<unsigned int> m_middle;
+    // only used by the reader
+    unsigned int m_front;
+};
@@ -22,8 +22,13 @@ namespace
     // Variables for window width and height
     const int WINDOW_WIDTH = 1000;
     const int WINDOW_HEIGHT = 800;
-    const char* g_ViewName = "view";
-    const char* g_ProjectionName = "projection";
+    const char* g_CameraBlockName = "CameraBlock";
+    // uniform buffer binding point shared by every shader program
+    const GLuint CAMERA_BLOCK_BINDING = 0;
+
+    // current size of the window framebuffer
+    int gWindowWidth = WINDOW_WIDTH;
+    int gWindowHeight = WINDOW_HEIGHT;
 
     // camera object used for viewing and interacting with
     // the 3D scene
@@ -41,6 +46,10 @@ namespace
     // the following variable is false when orthographic projection
     // is off and true when it is on
     bool bOrthographicProjection = false;
+
+    // records the input events, or replays them instead of
+    // the live input
+    InputRecorder* g_pInputRecorder = nullptr;
 }
 
 bool ViewManager::keys[1024] = { false };
@@ -58,6 +67,11 @@ ViewManager::ViewManager(ShaderManager* pShaderManager)
 {
     // initialize the member variables
     m_pWindow = NULL;
+    m_cameraUBO = 0;
+    m_projectionZoom = 0.0f;
+    m_bProjectionOrtho = false;
+    m_projectionWidth = 0;
+    m_projectionHeight = 0;
     g_pCamera = new Camera(glm::vec3(0.0f, 5.0f, 12.0f));
 }
 
@@ -71,6 +85,11 @@ ViewManager::~ViewManager()
     // free up allocated memory
     m_pShaderManager = NULL;
     m_pWindow = NULL;
+    if (0 != m_cameraUBO)
+    {
+        glDeleteBuffers(1, &m_cameraUBO);
+        m_cameraUBO = 0;
+    }
     if (NULL != g_pCamera)
     {
         delete g_pCamera;
@@ -78,6 +97,167 @@ ViewManager::~ViewManager()
     }
 }
 
+/***********************************************************
+ *  BindCameraBlock()
+ *
+ *  This method is used for attaching the CameraBlock uniform
+ *  block of the passed in shader program to the shared camera
+ *  binding point.  Every program bound this way reads the
+ *  same camera buffer, so the camera data is uploaded once
+ *  per frame no matter how many programs are used.
+ ***********************************************************/
+void ViewManager::BindCameraBlock(GLuint programID)
+{
+    GLuint blockIndex = glGetUniformBlockIndex(programID, g_CameraBlockName);
+
+    if (GL_INVALID_INDEX != blockIndex)
+    {
+        glUniformBlockBinding(programID, blockIndex, CAMERA_BLOCK_BINDING);
+    }
+}
+
+/***********************************************************
+ *  GetCameraBlock()
+ *
+ *  This method returns the camera data of the most recently
+ *  prepared frame.
+ ***********************************************************/
+const ViewManager::CAMERA_BLOCK& ViewManager::GetCameraBlock() const
+{
+    return(m_cameraBlock);
+}
+
+/***********************************************************
+ *  GetViewportSize()
+ *
+ *  This method returns the current size of the display
+ *  window framebuffer.
+ ***********************************************************/
+void ViewManager::GetViewportSize(int& width, int& height) const
+{
+    width = gWindowWidth;
+    height = gWindowHeight;
+}
+
+/***********************************************************
+ *  SetViewportSize()
+ *
+ *  This method is used for setting the size of the viewport
+ *  when the scene is rendered into an offscreen framebuffer,
+ *  which has no window to report its size.
+ ***********************************************************/
+void ViewManager::SetViewportSize(int width, int height)
+{
+    if ((width <= 0) || (height <= 0))
+    {
+        return;
+    }
+
+    gWindowWidth = width;
+    gWindowHeight = height;
+    GetGLStateCache().Viewport(0, 0, width, height);
+}
+
+/***********************************************************
+ *  SetCameraLookAt()
+ *
+ *  This method is used for placing the camera at a position
+ *  and turning it towards a target, for camera paths that are
+ *  scripted instead of driven by the mouse and keyboard.
+ ***********************************************************/
+void ViewManager::SetCameraLookAt(const glm::vec3& position, const glm::vec3& target)
+{
+    glm::vec3 direction = target - position;
+
+    if (glm::length(direction) <= 0.0f)
+    {
+        return;
+    }
+
+    direction = glm::normalize(direction);
+    g_pCamera->SetPose(
+        position,
+        glm::degrees(atan2f(direction.z, direction.x)),
+        glm::degrees(asinf(glm::clamp(direction.y, -1.0f, 1.0f))));
+}
+
+/***********************************************************
+ *  SetInputRecorder()
+ *
+ *  This method is used for setting the recorder that keeps
+ *  the input events of the window while it records, or whose
+ *  events drive the camera at a fixed timestep while it
+ *  replays.  The live input is ignored during a replay, except
+ *  for the escape key.
+ ***********************************************************/
+void ViewManager::SetInputRecorder(InputRecorder* pRecorder)
+{
+    g_pInputRecorder = pRecorder;
+}
+
+/***********************************************************
+ *  IsReplaying()
+ *
+ *  This method returns whether the input comes from a replay.
+ ***********************************************************/
+bool ViewManager::IsReplaying()
+{
+    return((NULL != g_pInputRecorder) && (g_pInputRecorder->GetMode() == InputRecorder::MODE_REPLAY));
+}
+
+/***********************************************************
+ *  CreateCameraBlock()
+ *
+ *  This method is used for creating the uniform buffer that
+ *  holds the per-frame camera data and binding it to the
+ *  shared camera binding point.  The shaders are loaded after
+ *  this object is created, so it runs on the first frame.
+ ***********************************************************/
+void ViewManager::CreateCameraBlock()
+{
+    glGenBuffers(1, &m_cameraUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_cameraUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(CAMERA_BLOCK), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // the buffer stays bound to the binding point for the
+    // lifetime of the application
+    glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, m_cameraUBO);
+
+    BindCameraBlock(GetActiveShaderProgram());
+}
+
+/***********************************************************
+ *  SetPerspectiveProjection()
+ *
+ *  This method is used for rebuilding the cached perspective
+ *  projection matrix from the camera zoom and window size.
+ ***********************************************************/
+void ViewManager::SetPerspectiveProjection()
+{
+    m_cameraBlock.projection = glm::perspective(
+        glm::radians(g_pCamera->Zoom),
+        (GLfloat)gWindowWidth / (GLfloat)gWindowHeight,
+        0.1f, 100.0f);
+}
+
+/***********************************************************
+ *  SetOrthographicProjection()
+ *
+ *  This method is used for rebuilding the cached orthographic
+ *  projection matrix from the window size.
+ ***********************************************************/
+void ViewManager::SetOrthographicProjection()
+{
+    float aspect = (float)gWindowWidth / (float)gWindowHeight;
+    float orthoHeight = 10.0f; // adjust this value as needed
+
+    m_cameraBlock.projection = glm::ortho(
+        -aspect * orthoHeight, aspect * orthoHeight,
+        -orthoHeight, orthoHeight,
+        0.1f, 100.0f);
+}
+
 /***********************************************************
  *  CreateDisplayWindow()
  *
@@ -113,9 +293,12 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
     // this callback is used to receive keyboard events
     glfwSetKeyCallback(window, &ViewManager::Key_Callback);
 
+    // this callback is used to receive window resize events
+    glfwSetFramebufferSizeCallback(window, &ViewManager::Framebuffer_Size_Callback);
+
     // enable blending for supporting tranparent rendering
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GetGLStateCache().Enable(GL_BLEND);
+    GetGLStateCache().BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     m_pWindow = window;
 
@@ -129,6 +312,26 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
  *  the mouse is moved within the active GLFW display window.
  ***********************************************************/
 void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos)
+{
+    if (IsReplaying())
+    {
+        return;
+    }
+    if (NULL != g_pInputRecorder)
+    {
+        g_pInputRecorder->RecordCursor(glfwGetTime(), xMousePos, yMousePos);
+    }
+
+    ApplyCursorEvent(xMousePos, yMousePos);
+}
+
+/***********************************************************
+ *  ApplyCursorEvent()
+ *
+ *  This method is used for turning the camera by the
+ *  movement of the mouse since the last cursor position.
+ ***********************************************************/
+void ViewManager::ApplyCursorEvent(double xMousePos, double yMousePos)
 {
     if (firstMouse)
     {
@@ -154,6 +357,26 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
  *  display window.
  ***********************************************************/
 void ViewManager::Mouse_Scroll_Callback(GLFWwindow* window, double xoffset, double yoffset)
+{
+    if (IsReplaying())
+    {
+        return;
+    }
+    if (NULL != g_pInputRecorder)
+    {
+        g_pInputRecorder->RecordScroll(glfwGetTime(), xoffset, yoffset);
+    }
+
+    ApplyScrollEvent(xoffset, yoffset);
+}
+
+/***********************************************************
+ *  ApplyScrollEvent()
+ *
+ *  This method is used for zooming the camera by a scroll of
+ *  the mouse wheel.
+ ***********************************************************/
+void ViewManager::ApplyScrollEvent(double xoffset, double yoffset)
 {
     g_pCamera->ProcessMouseScroll(yoffset);
 }
@@ -166,6 +389,33 @@ void ViewManager::Mouse_Scroll_Callback(GLFWwindow* window, double xoffset, doub
  ***********************************************************/
 void ViewManager::Key_Callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
+    // the escape key still closes the window during a replay
+    if (IsReplaying() && (key != GLFW_KEY_ESCAPE))
+    {
+        return;
+    }
+    if ((NULL != g_pInputRecorder) && (action != GLFW_REPEAT))
+    {
+        g_pInputRecorder->RecordKey(glfwGetTime(), key, action);
+    }
+
+    ApplyKeyEvent(key, action);
+}
+
+/***********************************************************
+ *  ApplyKeyEvent()
+ *
+ *  This method is used for keeping the state of a pressed or
+ *  released key and switching the projection.  Keys that
+ *  GLFW does not know are skipped.
+ ***********************************************************/
+void ViewManager::ApplyKeyEvent(int key, int action)
+{
+    if ((key < 0) || (key >= 1024))
+    {
+        return;
+    }
+
     if (action == GLFW_PRESS)
         keys[key] = true;
     else if (action == GLFW_RELEASE)
@@ -184,6 +434,28 @@ void ViewManager::Key_Callback(GLFWwindow* window, int key, int scancode, int ac
     }
 }
 
+/***********************************************************
+ *  Framebuffer_Size_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  the framebuffer of the display window is resized.  The
+ *  callback runs on the thread of the window, which may not
+ *  own the OpenGL context, so the viewport is set by the
+ *  thread that renders the frames of the new size.
+ ***********************************************************/
+void ViewManager::Framebuffer_Size_Callback(GLFWwindow* window, int width, int height)
+{
+    // a minimized window reports a zero size, which would
+    // produce an invalid projection matrix
+    if ((width <= 0) || (height <= 0))
+    {
+        return;
+    }
+
+    gWindowWidth = width;
+    gWindowHeight = height;
+}
+
 /***********************************************************
  *  ProcessKeyboardEvents()
  *
@@ -222,42 +494,110 @@ void ViewManager::ProcessKeyboardEvents(float deltaTime)
  ***********************************************************/
 void ViewManager::PrepareSceneView()
 {
-    glm::mat4 view;
-    glm::mat4 projection;
-
-    // per-frame timing
-    float currentFrame = glfwGetTime();
-    gDeltaTime = currentFrame - gLastFrame;
-    gLastFrame = currentFrame;
-
-    // process any keyboard events that may be waiting in the 
-    // event queue
-    ProcessKeyboardEvents(gDeltaTime);
-
-    // get the current view matrix from the camera
-    view = g_pCamera->GetViewMatrix();
+    UpdateCameraView();
+    UploadCameraBlock(m_cameraBlock);
+}
 
-    if (bOrthographicProjection)
+/***********************************************************
+ *  UpdateCameraView()
+ *
+ *  This method is used for moving the camera with the input
+ *  of the frame and building the camera data of the frame.
+ *  It makes no OpenGL calls, so it can run on the thread of
+ *  the window while another thread renders.
+ ***********************************************************/
+void ViewManager::UpdateCameraView()
+{
+    // the camera is only driven by the input of a window, an
+    // offscreen view is placed with SetCameraLookAt()
+    if (NULL != m_pWindow)
     {
-        // define the current orthographic projection matrix
-        float aspect = (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT;
-        float orthoHeight = 10.0f; // adjust this value as needed
-        projection = glm::ortho(-aspect * orthoHeight, aspect * orthoHeight, -orthoHeight, orthoHeight, 0.1f, 100.0f);
+        if (IsReplaying())
+        {
+            // a replay moves by a fixed step every frame and
+            // applies the recorded events of that step, so the
+            // frames do not depend on how long they take
+            g_pInputRecorder->AdvanceReplay(m_replayEvents);
+            for (size_t i = 0; i < m_replayEvents.size(); i++)
+            {
+                const InputRecorder::INPUT_EVENT& event = m_replayEvents[i];
+
+                if (event.type == InputRecorder::EVENT_KEY)
+                {
+                    ApplyKeyEvent(event.key, event.action);
+                }
+                else if (event.type == InputRecorder::EVENT_CURSOR)
+                {
+                    ApplyCursorEvent(event.x, event.y);
+                }
+                else if (event.type == InputRecorder::EVENT_SCROLL)
+                {
+                    ApplyScrollEvent(event.x, event.y);
+                }
+            }
+            gDeltaTime = 1.0f / (float)InputRecorder::REPLAY_RATE;
+
+            if (g_pInputRecorder->IsReplayFinished())
+            {
+                glfwSetWindowShouldClose(m_pWindow, true);
+            }
+        }
+        else
+        {
+            // per-frame timing
+            float currentFrame = glfwGetTime();
+            gDeltaTime = currentFrame - gLastFrame;
+            gLastFrame = currentFrame;
+        }
+
+        // process any keyboard events that may be waiting in the 
+        // event queue
+        ProcessKeyboardEvents(gDeltaTime);
     }
-    else
+
+    // the projection matrix only changes with the camera zoom,
+    // the projection mode, or the size of the window
+    if ((m_projectionZoom != g_pCamera->Zoom) ||
+        (m_bProjectionOrtho != bOrthographicProjection) ||
+        (m_projectionWidth != gWindowWidth) ||
+        (m_projectionHeight != gWindowHeight))
     {
-        // define the current perspective projection matrix
-        projection = glm::perspective(glm::radians(g_pCamera->Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
+        if (bOrthographicProjection)
+        {
+            SetOrthographicProjection();
+        }
+        else
+        {
+            SetPerspectiveProjection();
+        }
+
+        m_projectionZoom = g_pCamera->Zoom;
+        m_bProjectionOrtho = bOrthographicProjection;
+        m_projectionWidth = gWindowWidth;
+        m_projectionHeight = gWindowHeight;
     }
 
-    // if the shader manager object is valid
-    if (NULL != m_pShaderManager)
+    // get the current view matrix and position from the camera
+    m_cameraBlock.view = g_pCamera->GetViewMatrix();
+    m_cameraBlock.viewPosition = glm::vec4(g_pCamera->Position, 1.0f);
+}
+
+/***********************************************************
+ *  UploadCameraBlock()
+ *
+ *  This method is used for writing the camera data of a frame
+ *  into the camera uniform buffer, which is created the first
+ *  time.  It must be called on the thread of the context.
+ ***********************************************************/
+void ViewManager::UploadCameraBlock(const CAMERA_BLOCK& cameraBlock)
+{
+    if (0 == m_cameraUBO)
     {
-        // set the view matrix into the shader for proper rendering
-        m_pShaderManager->setMat4Value(g_ViewName, view);
-        // set the view matrix into the shader for proper rendering
-        m_pShaderManager->setMat4Value(g_ProjectionName, projection);
-        // set the view position of the camera into the shader for proper rendering
-        m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+        CreateCameraBlock();
     }
+
+    // upload all of the camera data with a single buffer write
+    glBindBuffer(GL_UNIFORM_BUFFER, m_cameraUBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CAMERA_BLOCK), &cameraBlock);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 }
\ No newline at end of file
@@ -10,8 +10,12 @@
 #pragma once
 
 #include "ShaderManager.h"
+#include "ShaderUniform.h"
+#include "InputRecorder.h"
 #include "camera.h"
 
+#include <vector>
+
 // GLFW library
 #include "GLFW/glfw3.h" 
 
@@ -36,9 +40,39 @@ public:
 
     // prepare the conversion from 3D object display to 2D scene display
     void PrepareSceneView();
+    // move the camera and build the camera data of a frame
+    void UpdateCameraView();
 
     // keyboard callback
     static void Key_Callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+    // framebuffer resize callback
+    static void Framebuffer_Size_Callback(GLFWwindow* window, int width, int height);
+
+    // attach the camera uniform block of a shader program to
+    // the shared camera block binding point
+    static void BindCameraBlock(GLuint programID);
+
+    // per-frame camera data, laid out to match the std140
+    // CameraBlock uniform block declared in the shaders
+    struct CAMERA_BLOCK
+    {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::vec4 viewPosition;
+    };
+
+    // camera data of the most recently prepared frame
+    const CAMERA_BLOCK& GetCameraBlock() const;
+    // write the camera data of a frame into the uniform buffer
+    void UploadCameraBlock(const CAMERA_BLOCK& cameraBlock);
+    // current size of the display window framebuffer
+    void GetViewportSize(int& width, int& height) const;
+    // set the size of the viewport rendered without a window
+    void SetViewportSize(int width, int height);
+    // place the camera at a position looking at a target
+    void SetCameraLookAt(const glm::vec3& position, const glm::vec3& target);
+    // set the recorder that records or replays the input, or NULL
+    void SetInputRecorder(InputRecorder* pRecorder);
 
 private:
     // pointer to shader manager object
@@ -53,6 +87,30 @@ private:
     static bool firstMouse;
     bool orthographicView;
 
+    // uniform buffer holding the per-frame camera data
+    GLuint m_cameraUBO;
+    // CPU copy of the camera data written into the buffer
+    CAMERA_BLOCK m_cameraBlock;
+    // settings the cached projection matrix was built from
+    float m_projectionZoom;
+    bool m_bProjectionOrtho;
+    int m_projectionWidth;
+    int m_projectionHeight;
+
+    // events of the current step of a replay
+    std::vector<InputRecorder::INPUT_EVENT> m_replayEvents;
+
+    // create the camera uniform buffer and bind it
+    void CreateCameraBlock();
+    // rebuild the cached projection matrix
     void SetPerspectiveProjection();
     void SetOrthographicProjection();
+
+    // apply an input event to the key states and the camera,
+    // from the window callbacks or from a replay
+    static void ApplyKeyEvent(int key, int action);
+    static void ApplyCursorEvent(double xMousePos, double yMousePos);
+    static void ApplyScrollEvent(double xoffset, double yoffset);
+    // set while the live input is replaced by a replay
+    static bool IsReplaying();
 };
\ No newline at end of file
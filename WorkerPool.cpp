@@ -0,0 +1,133 @@
+///////////////////////////////////////////////////////////////////////////////
+// workerpool.cpp
+// ============
+// pool of worker threads that run tasks in the background
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "WorkerPool.h"
+
+/***********************************************************
+ *  WorkerPool()
+ *
+ *  The constructor for the class.  Without a thread count,
+ *  one thread is started for every core except the one of
+ *  the main thread, and at least one thread.
+ ***********************************************************/
+WorkerPool::WorkerPool(unsigned int threadCount)
+{
+    m_unfinishedTasks = 0;
+    m_bStopping = false;
+
+    if (threadCount == 0)
+    {
+        unsigned int cores = std::thread::hardware_concurrency();
+        threadCount = (cores > 1) ? (cores - 1) : 1;
+    }
+
+    for (unsigned int i = 0; i < threadCount; i++)
+    {
+        m_threads.push_back(std::thread(&WorkerPool::WorkerLoop, this));
+    }
+}
+
+/***********************************************************
+ *  ~WorkerPool()
+ *
+ *  The destructor for the class.  The queued tasks are
+ *  finished before the threads exit.
+ ***********************************************************/
+WorkerPool::~WorkerPool()
+{
+    Wait();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bStopping = true;
+    }
+    m_taskQueued.notify_all();
+
+    for (size_t i = 0; i < m_threads.size(); i++)
+    {
+        m_threads[i].join();
+    }
+}
+
+/***********************************************************
+ *  Submit()
+ *
+ *  This method is used for queueing a task, which is run by
+ *  the next thread that is free.
+ ***********************************************************/
+void WorkerPool::Submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+        m_unfinishedTasks++;
+    }
+    m_taskQueued.notify_one();
+}
+
+/***********************************************************
+ *  Wait()
+ *
+ *  This method is used for blocking the calling thread until
+ *  all of the submitted tasks have finished.
+ ***********************************************************/
+void WorkerPool::Wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    m_tasksDone.wait(lock, [this]() { return(m_unfinishedTasks == 0); });
+}
+
+/***********************************************************
+ *  GetThreadCount()
+ *
+ *  This method returns the number of threads in the pool.
+ ***********************************************************/
+unsigned int WorkerPool::GetThreadCount() const
+{
+    return((unsigned int)m_threads.size());
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is run by every thread of the pool.  It takes
+ *  the oldest queued task and runs it without holding the
+ *  lock, until the pool stops.
+ ***********************************************************/
+void WorkerPool::WorkerLoop()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            m_taskQueued.wait(lock, [this]() { return(m_bStopping || (m_tasks.empty() == false)); });
+            if (m_tasks.empty())
+            {
+                return;
+            }
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+
+        task();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            m_unfinishedTasks--;
+            if (m_unfinishedTasks == 0)
+            {
+                m_tasksDone.notify_all();
+            }
+        }
+    }
+}
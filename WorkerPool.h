@@ -0,0 +1,57 @@
+///////////////////////////////////////////////////////////////////////////////
+// workerpool.h
+// ============
+// pool of worker threads that run tasks in the background
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  WorkerPool
+ *
+ *  This class keeps a fixed number of threads that take tasks
+ *  from a shared queue, so the CPU work of loading a scene is
+ *  spread over the cores while the main thread keeps the
+ *  OpenGL context.  The tasks must not make OpenGL calls.
+ ***********************************************************/
+class WorkerPool
+{
+public:
+    // constructor, zero threads uses one for each other core
+    WorkerPool(unsigned int threadCount = 0);
+    // destructor
+    ~WorkerPool();
+
+    // queue a task to run on one of the threads
+    void Submit(std::function<void()> task);
+    // block until every submitted task has finished
+    void Wait();
+    // number of threads in the pool
+    unsigned int GetThreadCount() const;
+
+private:
+    std::vector<std::thread> m_threads;
+    // tasks that no thread has taken yet
+    std::deque<std::function<void()>> m_tasks;
+    // tasks that are queued or running
+    size_t m_unfinishedTasks;
+    // set when the threads must exit
+    bool m_bStopping;
+
+    std::mutex m_mutex;
+    // signaled when a task is queued or the pool stops
+    std::condition_variable m_taskQueued;
+    // signaled when the last unfinished task is done
+    std::condition_variable m_tasksDone;
+
+    // take and run tasks until the pool stops
+    void WorkerLoop();
+};
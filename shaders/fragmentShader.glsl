@@ -0,0 +1,157 @@
+#version 460 core
+
+///////////////////////////////////////////////////////////////////////////////
+// fragmentShader.glsl
+// ============
+// shade the scene fragments with textures, materials and lights
+///////////////////////////////////////////////////////////////////////////////
+
+// object material, packed to match the material storage buffer
+struct Material
+{
+    vec4 ambientColorStrength;  // rgb ambient color, w ambient strength
+    vec4 diffuseColor;          // rgb diffuse color
+    vec4 specularShininess;     // rgb specular color, w shininess
+};
+
+// scene light, packed to match the light storage buffer
+struct LightSource
+{
+    vec4 positionRange;         // xyz position, w range
+    vec4 ambientFocal;          // rgb ambient color, w focal strength
+    vec4 diffuseIntensity;      // rgb diffuse color, w specular intensity
+    vec4 specularColor;         // rgb specular color
+};
+
+in vec3 fragmentPosition;
+in vec3 fragmentVertexNormal;
+in vec2 fragmentTextureCoordinate;
+// per-instance values passed through by the vertex shader
+flat in vec4 fragmentObjectColor;
+flat in uint fragmentMaterialIndex;
+flat in uint fragmentTextureLayer;
+
+out vec4 outFragmentColor;
+
+// per-frame camera data shared by every shader program
+layout (std140) uniform CameraBlock
+{
+    mat4 view;
+    mat4 projection;
+    vec4 viewPosition;
+};
+
+uniform bool bUseLighting = false;
+// texture array of the draw, an instance selects its layer
+uniform sampler2DArray objectTextures;
+
+// texture layer of the instances drawn with their color
+const uint NO_TEXTURE_LAYER = 0xFFFFFFFFu;
+
+// every scene light
+layout (std430, binding = 0) readonly buffer LightBuffer
+{
+    LightSource lights[];
+};
+
+// offset and count into the light index list for each cluster
+layout (std430, binding = 1) readonly buffer ClusterBuffer
+{
+    uvec2 clusters[];
+};
+
+// light indices of all clusters, stored one cluster after another
+layout (std430, binding = 2) readonly buffer LightIndexBuffer
+{
+    uint lightIndices[];
+};
+
+// every object material, uploaded once when the scene is prepared
+layout (std430, binding = 3) readonly buffer MaterialBuffer
+{
+    Material materials[];
+};
+
+// cluster grid settings, bound to binding point 1 by the scene
+layout (std140) uniform ClusterBlock
+{
+    uvec4 gridSize;
+    float sliceScale;
+    float sliceBias;
+    vec2 tileSize;
+};
+
+// calculate the phong lighting contribution of one light source
+vec3 CalcLightSource(LightSource light, Material material, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
+{
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+
+    // fade the light out smoothly towards the end of its range,
+    // so it does not pop at the edge of the clusters it covers
+    vec3 lightOffset = light.positionRange.xyz - vertexPosition;
+    float distanceRatio = length(lightOffset) / light.positionRange.w;
+    float falloff = clamp(1.0f - pow(distanceRatio, 4.0f), 0.0f, 1.0f);
+    falloff = falloff * falloff;
+
+    // ambient lighting
+    ambient = light.ambientFocal.rgb * material.ambientColorStrength.rgb * material.ambientColorStrength.w;
+
+    // diffuse lighting
+    vec3 lightDirection = normalize(lightOffset);
+    float impact = max(dot(lightNormal, lightDirection), 0.0f);
+    diffuse = impact * light.diffuseIntensity.rgb * material.diffuseColor.rgb;
+
+    // specular lighting
+    vec3 reflectDir = reflect(-lightDirection, lightNormal);
+    float specularComponent = pow(max(dot(viewDirection, reflectDir), 0.0f), light.ambientFocal.w);
+    specular = light.diffuseIntensity.w * specularComponent * light.specularColor.rgb * material.specularShininess.rgb;
+
+    return((ambient + diffuse + specular) * falloff);
+}
+
+// find the index of the cluster that holds this fragment
+uint FindCluster()
+{
+    float viewDepth = -(view * vec4(fragmentPosition, 1.0f)).z;
+    uvec3 cluster;
+
+    cluster.xy = uvec2(gl_FragCoord.xy / tileSize);
+    cluster.z = uint(max(log(viewDepth) * sliceScale + sliceBias, 0.0f));
+    cluster = min(cluster, gridSize.xyz - uvec3(1));
+
+    return(cluster.x + gridSize.x * (cluster.y + gridSize.y * cluster.z));
+}
+
+void main()
+{
+    vec4 baseColor = fragmentObjectColor;
+
+    if (fragmentTextureLayer != NO_TEXTURE_LAYER)
+    {
+        baseColor = texture(objectTextures, vec3(fragmentTextureCoordinate, float(fragmentTextureLayer)));
+    }
+
+    if (bUseLighting == true)
+    {
+        vec3 lightNormal = normalize(fragmentVertexNormal);
+        vec3 viewDirection = normalize(viewPosition.xyz - fragmentPosition);
+        vec3 phongResult = vec3(0.0f);
+        Material material = materials[fragmentMaterialIndex];
+
+        // only the lights binned into this cluster can reach it
+        uvec2 cluster = clusters[FindCluster()];
+        for (uint i = 0; i < cluster.y; i++)
+        {
+            LightSource light = lights[lightIndices[cluster.x + i]];
+            phongResult += CalcLightSource(light, material, lightNormal, fragmentPosition, viewDirection);
+        }
+
+        outFragmentColor = vec4(phongResult * baseColor.xyz, baseColor.w);
+    }
+    else
+    {
+        outFragmentColor = baseColor;
+    }
+}
@@ -0,0 +1,61 @@
+#version 460 core
+
+///////////////////////////////////////////////////////////////////////////////
+// vertexShader.glsl
+// ============
+// transform the scene vertices into clip space
+///////////////////////////////////////////////////////////////////////////////
+
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 1) in vec3 inVertexNormal;
+layout (location = 2) in vec2 inTextureCoordinate;
+
+// per-instance data, packed to match the instance storage buffer
+struct Instance
+{
+    mat4 model;
+    vec4 color;
+    vec2 UVscale;
+    uint materialIndex;
+    uint textureLayer;
+};
+
+out vec3 fragmentPosition;
+out vec3 fragmentVertexNormal;
+out vec2 fragmentTextureCoordinate;
+flat out vec4 fragmentObjectColor;
+flat out uint fragmentMaterialIndex;
+flat out uint fragmentTextureLayer;
+
+// per-frame camera data shared by every shader program, the
+// block is bound to binding point 0 by the view manager
+layout (std140) uniform CameraBlock
+{
+    mat4 view;
+    mat4 projection;
+    vec4 viewPosition;
+};
+
+// instance data of every draw of the frame, a draw command
+// starts at its base instance
+layout (std430, binding = 4) readonly buffer InstanceBuffer
+{
+    Instance instances[];
+};
+
+void main()
+{
+    Instance instance = instances[gl_BaseInstance + gl_InstanceID];
+
+    // transform the vertex position into world space
+    fragmentPosition = vec3(instance.model * vec4(inVertexPosition, 1.0f));
+    // transform the vertex normal into world space
+    fragmentVertexNormal = mat3(transpose(inverse(instance.model))) * inVertexNormal;
+    // the UV scale is linear, so it can be applied per vertex
+    fragmentTextureCoordinate = inTextureCoordinate * instance.UVscale;
+    fragmentObjectColor = instance.color;
+    fragmentMaterialIndex = instance.materialIndex;
+    fragmentTextureLayer = instance.textureLayer;
+
+    gl_Position = projection * view * vec4(fragmentPosition, 1.0f);
+}